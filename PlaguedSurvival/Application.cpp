@@ -1,6 +1,8 @@
 #include "Application.hpp"
 
+#include "CommandDispatcher.hpp"
 #include "GameOverState.hpp"
+#include "SpatialGrid.hpp"
 #include "State.hpp"
 #include "StateID.hpp"
 #include "TitleState.hpp"
@@ -98,9 +100,19 @@ void Application::UpdateStatistics(sf::Time elapsed_time)
 
 	if (m_statistics_updatetime >= sf::seconds(1.0f))
 	{
+		std::size_t queries;
+		std::size_t candidates;
+		SpatialGrid::Instance().TakeQueryStatistics(queries, candidates);
+
+		std::size_t commands;
+		std::size_t visited;
+		CommandDispatcher::Instance().TakeStatistics(commands, visited);
+
 		m_statistics_text.setString(
 			"Frames / Second = " + std::to_string(m_statistics_numframes) + "\n" +
-			"Time / Update = " + std::to_string(m_statistics_updatetime.asMicroseconds() / m_statistics_numframes) + "us");
+			"Time / Update = " + std::to_string(m_statistics_updatetime.asMicroseconds() / m_statistics_numframes) + "us\n" +
+			"Collision Candidates = " + std::to_string(candidates) + " in " + std::to_string(queries) + " queries\n" +
+			"Command Nodes Visited / Frame = " + std::to_string(visited / m_statistics_numframes) + " for " + std::to_string(commands / m_statistics_numframes) + " commands");
 
 		m_statistics_updatetime -= sf::seconds(1.0f);
 		m_statistics_numframes = 0;
@@ -141,6 +153,7 @@ void Application::RegisterStates()
 	m_stack.RegisterState<GameState>(StateID::kGame);
 	m_stack.RegisterState<MultiplayerGameState>(StateID::kHostGame, true);
 	m_stack.RegisterState<MultiplayerGameState>(StateID::kJoinGame, false);
+	m_stack.RegisterState<MultiplayerGameState>(StateID::kSpectateGame, false, true);
 	m_stack.RegisterState<PauseState>(StateID::kPause);
 	m_stack.RegisterState<PauseState>(StateID::kNetworkPause, true);
 	m_stack.RegisterState<SettingsState>(StateID::kSettings);
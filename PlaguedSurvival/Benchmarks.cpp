@@ -0,0 +1,1428 @@
+#include "Benchmarks.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <queue>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <SFML/Network/IpAddress.hpp>
+#include <SFML/Network/Packet.hpp>
+#include <SFML/Network/TcpListener.hpp>
+#include <SFML/Network/TcpSocket.hpp>
+#include <SFML/System/Clock.hpp>
+#include <SFML/System/Sleep.hpp>
+#include <SFML/System/Vector2.hpp>
+
+#include "CommandQueue.hpp"
+#include "Entity.hpp"
+#include "GameServer.hpp"
+#include "HeldDirections.hpp"
+#include "JobSystem.hpp"
+#include "NetworkProtocol.hpp"
+#include "PacketFraming.hpp"
+#include "ParallelSceneUpdate.hpp"
+#include "RangeCoder.hpp"
+#include "SceneNode.hpp"
+#include "SnapshotCodec.hpp"
+#include "SpatialGrid.hpp"
+#include "TileGrid.hpp"
+#include "Utility.hpp"
+
+/**
+ * Vilandas Morrissey - D00218436
+ */
+
+namespace
+{
+	//Two local players and six remote proxies each pushing their held actions every frame
+	const int CommandsPerFrame = 8 * 3;
+	const int Frames = 200000;
+
+	const int SceneFrames = 2000;
+	const int MovingEntities = 1000;
+
+	//A map many times the size of the default level's population
+	const int LargeMapEntities = 20000;
+	const int LargeMapFrames = 200;
+	const std::size_t WorkerCounts[] = { 0, 1, 3, 7 };
+
+	//A player sized box swept over the whole world
+	const sf::Vector2f QuerySize(40.f, 100.f);
+	const float QueryStep = 8.f;
+	const int LookupRepeats = 20;
+
+	//A full lobby sending a snapshot to every client each 50ms tick
+	const int SnapshotPlayers = 16;
+	const int TrainingSnapshots = 1000;
+	const int TimedSnapshots = 20000;
+	const float TickSeconds = 1.f / 20.f;
+
+	//Lobbies where every peer has one player and is sent its own snapshot each tick
+	const std::size_t EncodePeerCounts[] = { 16, 64, 256 };
+	const int EncodeTicks = 200;
+
+	//Loopback clients sending input once a frame, then far past the server's rate limits
+	const std::size_t FloodPeers = 32;
+	const int NormalInputsPerSecond = 60;
+	const int FloodInputsPerSecond = 1000;
+	const int FloodSeconds = 5;
+	const sf::Time ConnectTimeout = sf::seconds(5.f);
+
+	//Loopback peers each sending a tick's worth of 60Hz input, which the server relays to every peer
+	const std::size_t LoopbackPeerCounts[] = { 4, 16, 64 };
+	const std::size_t LoopbackInputsPerTick = 3;
+	const int LoopbackTicks = 200;
+	const std::size_t LoopbackChunk = 16384;
+
+	//Lobbies of simulated players up to MAX_LOBBY_PLAYERS, each snapshot positioning every one of them
+	const std::size_t LobbySizes[] = { 100, MAX_LOBBY_PLAYERS };
+	const std::size_t LobbyLocalPlayers = 2;
+	const int LobbySnapshots = 2000;
+	const float LobbyPacketAge = 0.01f;
+
+	//Each entity holds a direction for HeldFrames then lets go for ReleasedFrames
+	const int HeldFrames = 30;
+	const int ReleasedFrames = 10;
+
+	//The queue CommandQueue replaced, a std::queue of commands holding std::function
+	struct FunctionCommand
+	{
+		std::function<void(SceneNode&, sf::Time)> action;
+		unsigned int category;
+	};
+
+	//The same size as the player input functors once DerivedAction has wrapped them
+	struct InputAction
+	{
+		sf::Vector2i m_direction;
+		int m_identifier;
+		int* m_counter;
+
+		void operator()(SceneNode&, sf::Time) const
+		{
+			*m_counter += m_direction.x + m_identifier;
+		}
+	};
+
+	template<typename Queue, typename Binding>
+	double TimeQueue(Queue& queue, const Binding& binding, SceneNode& node)
+	{
+		const sf::Time dt = sf::seconds(1.f / 60.f);
+		sf::Clock clock;
+
+		for (int frame = 0; frame < Frames; ++frame)
+		{
+			for (int i = 0; i < CommandsPerFrame; ++i)
+			{
+				queue.push(binding);
+			}
+
+			while (!queue.empty())
+			{
+				queue.front().action(node, dt);
+				queue.pop();
+			}
+		}
+
+		return static_cast<double>(clock.getElapsedTime().asMicroseconds()) * 1000.0 / (static_cast<double>(Frames) * CommandsPerFrame);
+	}
+
+	//Gives CommandQueue the std::queue names TimeQueue uses
+	struct CommandQueueAdapter
+	{
+		void push(const Command& command) { m_queue.Push(command); }
+		bool empty() const { return m_queue.IsEmpty(); }
+		Command& front() { m_front = m_queue.Pop(); return m_front; }
+		void pop() {}
+
+		CommandQueue m_queue;
+		Command m_front;
+	};
+
+	sf::Vector2i GetHeldDirection(int entity, int frame)
+	{
+		const int phase = (frame + entity) % (HeldFrames + ReleasedFrames);
+		if (phase >= HeldFrames)
+		{
+			return {};
+		}
+		return (frame + entity) / (HeldFrames + ReleasedFrames) % 2 == 0 ? sf::Vector2i(1, 0) : sf::Vector2i(-1, 0);
+	}
+
+	//The direction state HeldDirections replaced, as it was in Entity
+	struct MapDirections
+	{
+		struct Hash
+		{
+			size_t operator()(const sf::Vector2i vector) const
+			{
+				const size_t hash1 = std::hash<int>{}(vector.x);
+				const size_t hash2 = std::hash<int>{}(vector.y);
+
+				return hash1 ^ (hash2 + 0x9e3779b9 + (hash1 << 6) + (hash1 >> 2));
+			}
+		};
+
+		void Add(sf::Vector2i direction)
+		{
+			m_directions[direction] = 0;
+			UpdateUnit();
+		}
+
+		void Update(float dt)
+		{
+			std::queue<sf::Vector2i> remove_queue;
+
+			for (auto it = m_directions.begin(); it != m_directions.end(); ++it)
+			{
+				it->second += dt;
+
+				if (it->second > 0.02f)
+				{
+					remove_queue.emplace(it->first);
+				}
+			}
+
+			while (!remove_queue.empty())
+			{
+				m_directions.erase(remove_queue.front());
+				remove_queue.pop();
+				UpdateUnit();
+			}
+		}
+
+		void UpdateUnit()
+		{
+			sf::Vector2i direction;
+			for (const auto& pair : m_directions)
+			{
+				direction += pair.first;
+			}
+			m_unit = Utility::UnitVector(direction);
+		}
+
+		std::unordered_map<sf::Vector2i, float, Hash> m_directions;
+		sf::Vector2f m_unit;
+	};
+
+	//HeldDirections used the way Entity uses it
+	struct FixedDirections
+	{
+		void Add(sf::Vector2i direction)
+		{
+			m_directions.Add(direction);
+			m_unit = m_directions.GetUnit();
+		}
+
+		void Update(float dt)
+		{
+			if (m_directions.Update(dt))
+			{
+				m_unit = m_directions.GetUnit();
+			}
+		}
+
+		HeldDirections m_directions;
+		sf::Vector2f m_unit;
+	};
+
+	/// <returns>Nanoseconds per entity per frame</returns>
+	template<typename Directions>
+	double TimeDirections(float& checksum)
+	{
+		std::vector<Directions> entities(MovingEntities);
+		const float dt = 1.f / 60.f;
+		sf::Clock clock;
+
+		for (int frame = 0; frame < SceneFrames; ++frame)
+		{
+			for (int i = 0; i < MovingEntities; ++i)
+			{
+				const sf::Vector2i direction = GetHeldDirection(i, frame);
+				if (direction != sf::Vector2i())
+				{
+					entities[i].Add(direction);
+				}
+				entities[i].Update(dt);
+				checksum += entities[i].m_unit.x;
+			}
+		}
+
+		return static_cast<double>(clock.getElapsedTime().asMicroseconds()) * 1000.0 / (static_cast<double>(SceneFrames) * MovingEntities);
+	}
+
+	/// <returns>Microseconds per frame</returns>
+	double TimeMovingEntities(float& checksum)
+	{
+		SceneNode::SceneLayers layers{};
+		SceneNode root(layers);
+		std::vector<Entity*> entities;
+
+		for (int i = 0; i < MovingEntities; ++i)
+		{
+			std::unique_ptr<Entity> entity(new Entity(layers, 1, 400, sf::Vector2f(200, 200), 800, 0));
+			entities.emplace_back(entity.get());
+			root.AttachChild(std::move(entity));
+		}
+
+		CommandQueue commands;
+		const sf::Time dt = sf::seconds(1.f / 60.f);
+		sf::Clock clock;
+
+		for (int frame = 0; frame < SceneFrames; ++frame)
+		{
+			for (int i = 0; i < MovingEntities; ++i)
+			{
+				const sf::Vector2i direction = GetHeldDirection(i, frame);
+				if (direction != sf::Vector2i())
+				{
+					entities[i]->AddDirection(direction);
+				}
+			}
+			root.Update(dt, commands);
+		}
+
+		const double elapsed = static_cast<double>(clock.getElapsedTime().asMicroseconds()) / SceneFrames;
+		for (Entity* entity : entities)
+		{
+			checksum += entity->getPosition().x;
+		}
+		return elapsed;
+	}
+
+	//An entity that looks up the tiles around it every step, as the player characters do
+	class BroadPhaseEntity : public Entity
+	{
+	public:
+		explicit BroadPhaseEntity(const SceneLayers& scene_layers)
+			: Entity(scene_layers, 1, 400, sf::Vector2f(200, 200), 800, 200)
+		{
+		}
+
+	private:
+		void Integrate(sf::Time dt) override
+		{
+			const sf::Vector2f position = getPosition();
+			SpatialGrid::Instance().Query(sf::FloatRect(position.x, position.y, WorldInfo::TILE_SIZE, WorldInfo::TILE_SIZE),
+				Layers::kActivePlatforms, m_candidates);
+
+			//Keeps the entities falling through the same stretch of the map
+			if (position.y > WorldInfo::WORLD_HEIGHT)
+			{
+				SetVelocity(GetVelocity().x, 0.f);
+				setPosition(position.x, 0.f);
+				return;
+			}
+
+			Entity::Integrate(dt);
+		}
+
+	private:
+		std::vector<int> m_candidates;
+	};
+
+	/// <param name="updater">Null to update the scene graph on the calling thread as it was</param>
+	/// <returns>Microseconds per frame</returns>
+	double TimeLargeMap(ParallelSceneUpdate* updater, float& checksum)
+	{
+		SceneNode::SceneLayers layers{};
+		SceneNode root(layers);
+		SceneNode::Ptr layer(new SceneNode(layers));
+		std::vector<Entity*> entities;
+
+		for (int i = 0; i < LargeMapEntities; ++i)
+		{
+			std::unique_ptr<Entity> entity(new BroadPhaseEntity(layers));
+			entity->setPosition((i % TileGrid::COLUMNS) * WorldInfo::TILE_SIZE, (i / TileGrid::COLUMNS % TileGrid::ROWS) * WorldInfo::TILE_SIZE);
+			entities.emplace_back(entity.get());
+			layer->AttachChild(std::move(entity));
+		}
+		root.AttachChild(std::move(layer));
+
+		CommandQueue commands;
+		const sf::Time dt = sf::seconds(1.f / 60.f);
+		sf::Clock clock;
+
+		for (int frame = 0; frame < LargeMapFrames; ++frame)
+		{
+			for (int i = 0; i < LargeMapEntities; ++i)
+			{
+				const sf::Vector2i direction = GetHeldDirection(i, frame);
+				if (direction != sf::Vector2i())
+				{
+					entities[i]->AddDirection(direction);
+				}
+			}
+
+			if (updater != nullptr)
+			{
+				updater->Update(root, dt, commands);
+			}
+			else
+			{
+				root.Update(dt, commands);
+			}
+		}
+
+		const double elapsed = static_cast<double>(clock.getElapsedTime().asMicroseconds()) / LargeMapFrames;
+		for (Entity* entity : entities)
+		{
+			checksum += entity->getPosition().x + entity->getPosition().y;
+		}
+		return elapsed;
+	}
+
+	/// <summary>
+	/// The tiles of the default level that can be collided with, by the same rules TileMap uses:
+	/// the top of each column and any tile with air beside it
+	/// </summary>
+	void GetActiveCells(const TileGrid& grid, std::vector<int>& cells)
+	{
+		for (int cell = 0; cell < TileGrid::CELL_COUNT; ++cell)
+		{
+			if (grid.GetHitPoints(cell) == 0)
+			{
+				continue;
+			}
+
+			const int column = TileGrid::GetColumn(cell);
+			const bool air_left = column == 0 || grid.GetHitPoints(cell - 1) == 0;
+			const bool air_right = column == TileGrid::COLUMNS - 1 || grid.GetHitPoints(cell + 1) == 0;
+			if (grid.GetTopCell(column) == cell || air_left || air_right)
+			{
+				cells.emplace_back(cell);
+			}
+		}
+	}
+
+	//The lookup SpatialGrid replaced, as WorldChunks was: one chunk per column of tiles, and a query
+	//takes every tile in the chunk under the centre of the box and the chunks either side of it
+	struct ColumnScan
+	{
+		explicit ColumnScan(const std::vector<int>& cells)
+			: m_columns(TileGrid::COLUMNS)
+		{
+			for (const int cell : cells)
+			{
+				m_columns[TileGrid::GetColumn(cell)].emplace_back(cell);
+			}
+		}
+
+		void Query(const sf::FloatRect& bounds, std::vector<int>& candidates) const
+		{
+			const float column = std::floor((bounds.left + bounds.width / 2) / WorldInfo::TILE_SIZE);
+			std::size_t index = static_cast<std::size_t>(std::max(0.f, std::min(column, static_cast<float>(TileGrid::COLUMNS - 1))));
+			std::size_t iterations = 3;
+
+			if (index == 0)
+			{
+				iterations--;
+			}
+			else if (index >= m_columns.size() - 2)
+			{
+				iterations--;
+				index = m_columns.size() - 2;
+			}
+			else
+			{
+				index--;
+			}
+
+			candidates.clear();
+			for (std::size_t i = 0; i < iterations; i++)
+			{
+				const std::vector<int>& chunk = m_columns[index + i];
+				candidates.insert(candidates.end(), chunk.begin(), chunk.end());
+			}
+		}
+
+		std::vector<std::vector<int>> m_columns;
+	};
+
+	/// <summary>
+	/// Sweeps the box over the world and queries wherever it touches at least one tile
+	/// </summary>
+	/// <param name="candidates_per_query">The mean number of candidates each query returned</param>
+	/// <returns>Nanoseconds per query</returns>
+	template<typename Lookup>
+	double TimeLookup(const Lookup& lookup, const std::vector<sf::FloatRect>& boxes, double& candidates_per_query)
+	{
+		std::vector<int> candidates;
+		std::size_t total = 0;
+		sf::Clock clock;
+
+		for (int repeat = 0; repeat < LookupRepeats; ++repeat)
+		{
+			for (const sf::FloatRect& box : boxes)
+			{
+				lookup(box, candidates);
+				total += candidates.size();
+			}
+		}
+
+		const double queries = static_cast<double>(boxes.size()) * LookupRepeats;
+		candidates_per_query = static_cast<double>(total) / queries;
+		return static_cast<double>(clock.getElapsedTime().asMicroseconds()) * 1000.0 / queries;
+	}
+
+	/// <summary>
+	/// Every player running and jumping across the level, one snapshot of them all per tick.
+	/// A fixed seed keeps the payloads the same from run to run.
+	/// </summary>
+	void BuildSnapshots(int count, std::vector<std::vector<SnapshotCodec::Entry>>& snapshots)
+	{
+		unsigned seed = 12345;
+		const auto random = [&seed](float range)
+		{
+			seed = seed * 1103515245u + 12345u;
+			return (static_cast<float>((seed >> 16) & 0x7FFF) / 0x7FFF * 2.f - 1.f) * range;
+		};
+
+		std::vector<SnapshotCodec::Entry> players(SnapshotPlayers);
+		std::vector<sf::Vector2f> velocities(SnapshotPlayers);
+		for (int i = 0; i < SnapshotPlayers; ++i)
+		{
+			players[i].m_identifier = static_cast<opt::PlayerIdentifier>(i * 3 + 1);
+			players[i].m_position = sf::Vector2f(200.f * i + 100.f, 300.f);
+		}
+
+		snapshots.clear();
+		for (int tick = 0; tick < count; ++tick)
+		{
+			for (int i = 0; i < SnapshotPlayers; ++i)
+			{
+				velocities[i].x = std::max(-200.f, std::min(200.f, velocities[i].x + random(60.f)));
+				velocities[i].y = tick % 40 == i % 40 ? -300.f : std::min(400.f, velocities[i].y + 200.f * TickSeconds);
+				players[i].m_position += velocities[i] * TickSeconds;
+			}
+			snapshots.emplace_back(players);
+		}
+	}
+
+	//Trained the way recorded matches train snapshot_model.txt
+	RangeModel TrainSnapshotModel()
+	{
+		std::vector<std::vector<SnapshotCodec::Entry>> snapshots;
+		std::vector<sf::Uint8> payload;
+		BuildSnapshots(TrainingSnapshots, snapshots);
+
+		RangeModel::Histogram histogram{};
+		SnapshotCodec training_codec;
+		for (std::vector<SnapshotCodec::Entry>& snapshot : snapshots)
+		{
+			payload.clear();
+			training_codec.Encode(snapshot, payload);
+			for (const sf::Uint8 byte : payload)
+			{
+				histogram[byte]++;
+			}
+		}
+		return RangeModel(histogram);
+	}
+
+	/// <summary>
+	/// A client that joins a local server and sends it input. What the server sends back is read and thrown away,
+	/// apart from SpawnSelf, which gives the player the input is for.
+	/// </summary>
+	class FloodClient
+	{
+	public:
+		FloodClient()
+			: m_receive_offset(0)
+			, m_identifier(0)
+			, m_tick(0)
+			, m_sent(0)
+		{
+		}
+
+		bool Connect(const sf::Clock& clock)
+		{
+			//The server's network thread may not be listening yet
+			while (m_socket.connect(sf::IpAddress::LocalHost, SERVER_PORT, sf::seconds(1.f)) != sf::Socket::Done)
+			{
+				if (clock.getElapsedTime() > ConnectTimeout)
+				{
+					return false;
+				}
+				sf::sleep(sf::milliseconds(10));
+			}
+
+			m_socket.setBlocking(false);
+			sf::Packet join;
+			join << static_cast<opt::ClientPacket>(Client::PacketType::Join) << opt::SessionToken(0) << false;
+			PacketFraming::Append(join, m_send_buffer);
+			return true;
+		}
+
+		bool HasJoined() const
+		{
+			return m_identifier != 0;
+		}
+
+		//Sends inputs until it has sent as many as the rate calls for by now
+		void SendInputs(int inputs_per_second, sf::Time elapsed)
+		{
+			const std::size_t due = static_cast<std::size_t>(elapsed.asSeconds() * inputs_per_second);
+			for (; m_sent < due; ++m_sent)
+			{
+				sf::Packet input;
+				input << static_cast<opt::ClientPacket>(Client::PacketType::PlayerInput) << m_identifier << ++m_tick
+					<< sf::Uint8(1) << opt::InputMask(m_tick % 2) << sf::Int64(-1);
+				PacketFraming::Append(input, m_send_buffer);
+			}
+		}
+
+		void ResetInputs()
+		{
+			m_sent = 0;
+		}
+
+		void Flush()
+		{
+			if (!m_send_buffer.empty())
+			{
+				std::size_t sent = 0;
+				m_socket.send(m_send_buffer.data(), m_send_buffer.size(), sent);
+				m_send_buffer.erase(m_send_buffer.begin(), m_send_buffer.begin() + sent);
+			}
+
+			char chunk[16384];
+			std::size_t received = 0;
+			while (m_socket.receive(chunk, sizeof(chunk), received) == sf::Socket::Done)
+			{
+				if (HasJoined())
+				{
+					continue;
+				}
+
+				m_receive_buffer.insert(m_receive_buffer.end(), chunk, chunk + received);
+				sf::Packet packet;
+				while (!HasJoined() && PacketFraming::Extract(m_receive_buffer, m_receive_offset, packet) == PacketFraming::Result::kPacket)
+				{
+					opt::ServerPacket type;
+					if (packet >> type && static_cast<Server::PacketType>(type) == Server::PacketType::SpawnSelf)
+					{
+						packet >> m_identifier;
+					}
+				}
+			}
+		}
+
+	private:
+		sf::TcpSocket m_socket;
+		std::vector<char> m_send_buffer;
+		std::vector<char> m_receive_buffer;
+		std::size_t m_receive_offset;
+		opt::PlayerIdentifier m_identifier;
+		opt::InputTick m_tick;
+		std::size_t m_sent;
+	};
+
+	/// <summary>
+	/// One entity per standing tile of the default level, the way the tiles were built as TileNodes
+	/// </summary>
+	/// <returns>Microseconds per frame</returns>
+	double TimeTileEntities(float gravity)
+	{
+		SceneNode::SceneLayers layers{};
+		SceneNode root(layers);
+		const TileGrid grid;
+
+		for (int cell = 0; cell < TileGrid::CELL_COUNT; ++cell)
+		{
+			if (grid.GetHitPoints(cell) > 0)
+			{
+				std::unique_ptr<Entity> tile(new Entity(layers, grid.GetHitPoints(cell), 1, sf::Vector2f(1, 1), 1, gravity));
+				tile->setPosition(TileGrid::GetColumn(cell) * WorldInfo::TILE_SIZE, TileGrid::GetRow(cell) * WorldInfo::TILE_SIZE);
+				root.AttachChild(std::move(tile));
+			}
+		}
+
+		CommandQueue commands;
+		const sf::Time dt = sf::seconds(1.f / 60.f);
+		sf::Clock clock;
+
+		for (int frame = 0; frame < SceneFrames; ++frame)
+		{
+			root.Update(dt, commands);
+		}
+
+		return static_cast<double>(clock.getElapsedTime().asMicroseconds()) / SceneFrames;
+	}
+
+	//The lookups UpdateClientState made before World kept a map, a scan of the characters and one of the local identifiers
+	struct ScanLobby
+	{
+		void Add(opt::PlayerIdentifier identifier, Entity* character, bool local)
+		{
+			m_characters.emplace_back(character);
+			if (local)
+			{
+				m_local_identifiers.emplace_back(identifier);
+			}
+		}
+
+		Entity* GetPlayer(opt::PlayerIdentifier identifier) const
+		{
+			for (Entity* a : m_characters)
+			{
+				if (a->GetIdentifier() == identifier)
+				{
+					return a;
+				}
+			}
+			return nullptr;
+		}
+
+		Entity* GetRemotePlayer(opt::PlayerIdentifier identifier) const
+		{
+			Entity* player = GetPlayer(identifier);
+			const bool is_local = std::find(m_local_identifiers.begin(), m_local_identifiers.end(), identifier) != m_local_identifiers.end();
+			return player && !is_local ? player : nullptr;
+		}
+
+		std::vector<Entity*> m_characters;
+		std::vector<opt::PlayerIdentifier> m_local_identifiers;
+	};
+
+	//World's identifier map and the lobby's player map as UpdateClientState uses them now
+	struct MapLobby
+	{
+		void Add(opt::PlayerIdentifier identifier, Entity* character, bool local)
+		{
+			m_players[identifier] = local;
+			m_player_lookup[identifier] = character;
+		}
+
+		Entity* GetPlayer(opt::PlayerIdentifier identifier) const
+		{
+			const auto found = m_player_lookup.find(identifier);
+			return found != m_player_lookup.end() ? found->second : nullptr;
+		}
+
+		Entity* GetRemotePlayer(opt::PlayerIdentifier identifier) const
+		{
+			const auto found = m_players.find(identifier);
+			if (found == m_players.end() || found->second)
+			{
+				return nullptr;
+			}
+			return GetPlayer(identifier);
+		}
+
+		std::unordered_map<opt::PlayerIdentifier, bool> m_players;
+		std::unordered_map<opt::PlayerIdentifier, Entity*> m_player_lookup;
+	};
+
+	struct LobbyTimes
+	{
+		double m_get_player_ns;
+		double m_update_us;
+	};
+
+	template<typename Lobby>
+	LobbyTimes TimeLobby(std::size_t players, float& checksum)
+	{
+		SceneNode::SceneLayers layers{};
+		SceneNode root(layers);
+		Lobby lobby;
+		std::vector<SnapshotCodec::Entry> entries;
+
+		//The server writes its players in identifier order, the order they joined in
+		for (std::size_t i = 0; i < players; ++i)
+		{
+			const opt::PlayerIdentifier identifier = static_cast<opt::PlayerIdentifier>(i + 1);
+			std::unique_ptr<Entity> character(new Entity(layers, 1, 400, sf::Vector2f(200, 200), 800, 0));
+			character->SetIdentifier(identifier);
+			lobby.Add(identifier, character.get(), i < LobbyLocalPlayers);
+			root.AttachChild(std::move(character));
+			entries.push_back({ identifier, sf::Vector2f(WorldInfo::TILE_SIZE * identifier, 64.f) });
+		}
+
+		LobbyTimes times;
+		sf::Clock clock;
+		for (int snapshot = 0; snapshot < LobbySnapshots; ++snapshot)
+		{
+			for (const SnapshotCodec::Entry& entry : entries)
+			{
+				checksum += lobby.GetPlayer(entry.m_identifier) != nullptr ? 1.f : 0.f;
+			}
+		}
+		times.m_get_player_ns = static_cast<double>(clock.restart().asMicroseconds()) * 1000.0 / (static_cast<double>(LobbySnapshots) * players);
+
+		//The body of the UpdateClientState handler once the snapshot is decoded
+		for (int snapshot = 0; snapshot < LobbySnapshots; ++snapshot)
+		{
+			for (const SnapshotCodec::Entry& entry : entries)
+			{
+				Entity* player = lobby.GetRemotePlayer(entry.m_identifier);
+				if (player)
+				{
+					const sf::Vector2f player_position = entry.m_position + player->GetVelocity() * LobbyPacketAge;
+					player->setPosition(player->getPosition() + (player_position - player->getPosition()) * 0.1f);
+				}
+			}
+		}
+		times.m_update_us = static_cast<double>(clock.getElapsedTime().asMicroseconds()) / LobbySnapshots;
+
+		for (const SnapshotCodec::Entry& entry : entries)
+		{
+			checksum += lobby.GetPlayer(entry.m_identifier)->getPosition().x;
+		}
+		return times;
+	}
+
+	//Both ends of a loopback connection. Only the calls on the server's end are counted
+	struct LoopbackPeer
+	{
+		LoopbackPeer() : m_receive_offset(0) {}
+
+		sf::TcpSocket m_server;
+		sf::TcpSocket m_client;
+		std::vector<char> m_send_buffer;
+		std::vector<char> m_receive_buffer;
+		std::size_t m_receive_offset;
+	};
+
+	struct SocketCalls
+	{
+		SocketCalls() : m_packets_sent(0), m_send_calls(0), m_packets_received(0), m_receive_calls(0), m_bytes(0), m_seconds(0) {}
+
+		std::size_t m_packets_sent;
+		std::size_t m_send_calls;
+		std::size_t m_packets_received;
+		std::size_t m_receive_calls;
+		std::size_t m_bytes;
+		double m_seconds;
+	};
+
+	//Batched is the QueuePacket/FlushPeer and ReadSocket path, otherwise every packet is its own sf::TcpSocket call
+	bool TimeLoopback(std::size_t peer_count, bool batched, SocketCalls& calls)
+	{
+		sf::TcpListener listener;
+		if (listener.listen(sf::Socket::AnyPort, sf::IpAddress::LocalHost) != sf::Socket::Done)
+		{
+			return false;
+		}
+
+		std::vector<std::unique_ptr<LoopbackPeer>> peers;
+		for (std::size_t i = 0; i < peer_count; ++i)
+		{
+			std::unique_ptr<LoopbackPeer> peer(new LoopbackPeer());
+			if (peer->m_client.connect(sf::IpAddress::LocalHost, listener.getLocalPort()) != sf::Socket::Done ||
+				listener.accept(peer->m_server) != sf::Socket::Done)
+			{
+				return false;
+			}
+			peers.emplace_back(std::move(peer));
+		}
+
+		std::vector<sf::Packet> inputs(peer_count * LoopbackInputsPerTick);
+		std::vector<char> framed;
+		std::vector<char> chunk(LoopbackChunk);
+		calls = SocketCalls();
+		sf::Clock clock;
+
+		for (int tick = 0; tick < LoopbackTicks; ++tick)
+		{
+			//Every client sends its inputs for the tick in one call
+			for (std::size_t i = 0; i < peer_count; ++i)
+			{
+				framed.clear();
+				for (std::size_t k = 0; k < LoopbackInputsPerTick; ++k)
+				{
+					sf::Packet input;
+					input << static_cast<opt::ClientPacket>(Client::PacketType::PlayerInput) << static_cast<opt::PlayerIdentifier>(i + 1)
+						<< opt::InputTick(tick * LoopbackInputsPerTick + k) << sf::Uint8(1) << opt::InputMask(k % 2) << sf::Int64(-1);
+					PacketFraming::Append(input, framed);
+				}
+				peers[i]->m_client.send(framed.data(), framed.size());
+			}
+
+			//The server reads every peer's inputs
+			std::size_t relay_bytes = 0;
+			for (std::size_t i = 0; i < peer_count; ++i)
+			{
+				LoopbackPeer& peer = *peers[i];
+				for (std::size_t k = 0; k < LoopbackInputsPerTick; ++k)
+				{
+					sf::Packet& input = inputs[i * LoopbackInputsPerTick + k];
+					if (batched)
+					{
+						while (PacketFraming::Extract(peer.m_receive_buffer, peer.m_receive_offset, input) != PacketFraming::Result::kPacket)
+						{
+							std::size_t received = 0;
+							if (peer.m_server.receive(chunk.data(), chunk.size(), received) != sf::Socket::Done)
+							{
+								return false;
+							}
+							peer.m_receive_buffer.insert(peer.m_receive_buffer.end(), chunk.data(), chunk.data() + received);
+							calls.m_receive_calls++;
+						}
+					}
+					else
+					{
+						if (peer.m_server.receive(input) != sf::Socket::Done)
+						{
+							return false;
+						}
+						calls.m_receive_calls++;
+					}
+					calls.m_packets_received++;
+					calls.m_bytes += input.getDataSize();
+					relay_bytes += PacketFraming::HEADER_BYTES + input.getDataSize();
+				}
+				peer.m_receive_buffer.erase(peer.m_receive_buffer.begin(), peer.m_receive_buffer.begin() + peer.m_receive_offset);
+				peer.m_receive_offset = 0;
+			}
+
+			//and relays all of them to every peer, whose client reads them back out
+			for (const std::unique_ptr<LoopbackPeer>& peer : peers)
+			{
+				for (sf::Packet& input : inputs)
+				{
+					if (batched)
+					{
+						PacketFraming::Append(input, peer->m_send_buffer);
+					}
+					else
+					{
+						peer->m_server.send(input);
+						calls.m_send_calls++;
+					}
+					calls.m_packets_sent++;
+					calls.m_bytes += input.getDataSize();
+				}
+
+				if (batched)
+				{
+					peer->m_server.send(peer->m_send_buffer.data(), peer->m_send_buffer.size());
+					peer->m_send_buffer.clear();
+					calls.m_send_calls++;
+				}
+
+				for (std::size_t received_bytes = 0; received_bytes < relay_bytes;)
+				{
+					std::size_t received = 0;
+					if (peer->m_client.receive(chunk.data(), chunk.size(), received) != sf::Socket::Done)
+					{
+						return false;
+					}
+					received_bytes += received;
+				}
+			}
+		}
+
+		calls.m_seconds = clock.getElapsedTime().asSeconds();
+		return true;
+	}
+}
+
+/// <returns>False if there is no benchmark with that name</returns>
+bool Benchmarks::Run(const std::string& name, std::ostream& output)
+{
+	if (name == "command-queue")
+	{
+		RunCommandQueue(output);
+		return true;
+	}
+	if (name == "scene-update")
+	{
+		RunSceneUpdate(output);
+		return true;
+	}
+	if (name == "entities")
+	{
+		RunEntities(output);
+		return true;
+	}
+	if (name == "parallel-update")
+	{
+		RunParallelUpdate(output);
+		return true;
+	}
+	if (name == "spatial-grid")
+	{
+		RunSpatialGrid(output);
+		return true;
+	}
+	if (name == "snapshot-codec")
+	{
+		RunSnapshotCodec(output);
+		return true;
+	}
+	if (name == "inbound-flood")
+	{
+		RunInboundFlood(output);
+		return true;
+	}
+	if (name == "snapshot-encode")
+	{
+		RunSnapshotEncode(output);
+		return true;
+	}
+	if (name == "socket-calls")
+	{
+		RunSocketCalls(output);
+		return true;
+	}
+	if (name == "large-lobby")
+	{
+		RunLargeLobby(output);
+		return true;
+	}
+
+	output << "Benchmarks: command-queue, scene-update, entities, parallel-update, spatial-grid, snapshot-codec, snapshot-encode, inbound-flood, socket-calls, large-lobby" << std::endl;
+	return false;
+}
+
+/// <summary>
+/// Pushes copies of a bound input command every frame and pops and runs them, as the players do
+/// </summary>
+void Benchmarks::RunCommandQueue(std::ostream& output)
+{
+	SceneNode::SceneLayers layers{};
+	SceneNode node(layers);
+	int counter = 0;
+	const InputAction input{ sf::Vector2i(1, 0), 1, &counter };
+
+	FunctionCommand function_command;
+	function_command.action = [input](SceneNode& target, sf::Time dt) { input(target, dt); };
+	function_command.category = Category::kPlayerCharacter;
+	std::queue<FunctionCommand> function_queue;
+
+	Command command;
+	command.action = [input](SceneNode& target, sf::Time dt) { input(target, dt); };
+	command.category = Category::kPlayerCharacter;
+	CommandQueueAdapter command_queue;
+
+	output << "queue,ns_per_command\n";
+	output << "std::queue<std::function>," << TimeQueue(function_queue, function_command, node) << '\n';
+	output << "CommandQueue," << TimeQueue(command_queue, command, node) << '\n';
+	output << "checksum," << counter << std::endl;
+}
+
+/// <summary>
+/// Updates the scene graph with a node per tile. The old tiles had gravity so were never at rest,
+/// tiles without it sleep after their first update.
+/// </summary>
+void Benchmarks::RunSceneUpdate(std::ostream& output)
+{
+	output << "tiles,us_per_frame\n";
+	output << "awake," << TimeTileEntities(1.f) << '\n';
+	output << "asleep," << TimeTileEntities(0.f) << std::endl;
+}
+
+/// <summary>
+/// Moves entities left and right with input that is held and let go, as players do
+/// </summary>
+void Benchmarks::RunEntities(std::ostream& output)
+{
+	float checksum = 0.f;
+
+	output << "directions,ns_per_entity\n";
+	output << "unordered_map," << TimeDirections<MapDirections>(checksum) << '\n';
+	output << "HeldDirections," << TimeDirections<FixedDirections>(checksum) << '\n';
+	output << "entities,us_per_frame\n";
+	output << "Entity," << TimeMovingEntities(checksum) << '\n';
+	output << "checksum," << checksum << std::endl;
+}
+
+/// <summary>
+/// Updates a large map of falling, moving entities that query the tiles around them, on the calling thread
+/// and then split across more and more workers. The checksums match when the results do not depend on the workers.
+/// </summary>
+void Benchmarks::RunParallelUpdate(std::ostream& output)
+{
+	const TileGrid grid;
+	SpatialGrid::Instance().Clear();
+	for (int cell = 0; cell < TileGrid::CELL_COUNT; ++cell)
+	{
+		if (grid.GetHitPoints(cell) > 0)
+		{
+			SpatialGrid::Instance().Insert(cell, sf::FloatRect(TileGrid::GetColumn(cell) * WorldInfo::TILE_SIZE,
+				TileGrid::GetRow(cell) * WorldInfo::TILE_SIZE, WorldInfo::TILE_SIZE, WorldInfo::TILE_SIZE), Layers::kActivePlatforms);
+		}
+	}
+
+	output << "workers,us_per_frame,checksum\n";
+
+	float checksum = 0.f;
+	const double serial = TimeLargeMap(nullptr, checksum);
+	output << "serial," << serial << ',' << checksum << '\n';
+
+	for (const std::size_t workers : WorkerCounts)
+	{
+		if (workers > 0 && workers >= std::thread::hardware_concurrency())
+		{
+			break;
+		}
+
+		ParallelSceneUpdate updater(workers);
+		checksum = 0.f;
+		const double elapsed = TimeLargeMap(&updater, checksum);
+		output << workers << ',' << elapsed << ',' << checksum << '\n';
+	}
+
+	SpatialGrid::Instance().Clear();
+	output.flush();
+}
+
+/// <summary>
+/// Sweeps a player sized box over the default level and counts the collision candidates each lookup returns
+/// </summary>
+void Benchmarks::RunSpatialGrid(std::ostream& output)
+{
+	const TileGrid grid;
+	std::vector<int> active_cells;
+	GetActiveCells(grid, active_cells);
+
+	SpatialGrid& spatial_grid = SpatialGrid::Instance();
+	spatial_grid.Clear();
+	for (const int cell : active_cells)
+	{
+		spatial_grid.Insert(cell, sf::FloatRect(TileGrid::GetColumn(cell) * WorldInfo::TILE_SIZE,
+			TileGrid::GetRow(cell) * WorldInfo::TILE_SIZE, WorldInfo::TILE_SIZE, WorldInfo::TILE_SIZE), Layers::kActivePlatforms);
+	}
+
+	std::vector<int> candidates;
+	std::vector<sf::FloatRect> boxes;
+	for (float y = 0.f; y + QuerySize.y <= WorldInfo::WORLD_HEIGHT; y += QueryStep)
+	{
+		for (float x = 0.f; x + QuerySize.x <= WorldInfo::WORLD_WIDTH; x += QueryStep)
+		{
+			const sf::FloatRect box(sf::Vector2f(x, y), QuerySize);
+			spatial_grid.Query(box, Layers::kActivePlatforms, candidates);
+			if (!candidates.empty())
+			{
+				boxes.emplace_back(box);
+			}
+		}
+	}
+
+	const ColumnScan column_scan(active_cells);
+	double column_candidates;
+	double grid_candidates;
+	const double column_time = TimeLookup([&](const sf::FloatRect& box, std::vector<int>& out) { column_scan.Query(box, out); }, boxes, column_candidates);
+	const double grid_time = TimeLookup([&](const sf::FloatRect& box, std::vector<int>& out) { spatial_grid.Query(box, Layers::kActivePlatforms, out); }, boxes, grid_candidates);
+
+	output << "lookup,candidates_per_query,ns_per_query\n";
+	output << "column scan," << column_candidates << ',' << column_time << '\n';
+	output << "SpatialGrid," << grid_candidates << ',' << grid_time << '\n';
+	output << "queries," << boxes.size() << std::endl;
+
+	spatial_grid.Clear();
+}
+
+/// <summary>
+/// Encodes a stream of full lobby snapshots as the server does for one client, and decodes them as that client does,
+/// with a model trained on the same kind of traffic. Throughput is of the uncoded payload.
+/// </summary>
+void Benchmarks::RunSnapshotCodec(std::ostream& output)
+{
+	std::vector<std::vector<SnapshotCodec::Entry>> snapshots;
+	std::vector<SnapshotCodec::Entry> entries;
+	std::vector<sf::Uint8> payload;
+	std::vector<sf::Uint8> coded;
+
+	const RangeModel model = TrainSnapshotModel();
+
+	BuildSnapshots(TimedSnapshots, snapshots);
+	std::vector<sf::Packet> packets(snapshots.size());
+	std::size_t payload_bytes = 0;
+	std::size_t coded_bytes = 0;
+
+	SnapshotCodec server_codec;
+	sf::Clock clock;
+	for (std::size_t i = 0; i < snapshots.size(); ++i)
+	{
+		payload.clear();
+		server_codec.Encode(snapshots[i], payload);
+		coded_bytes += SnapshotCodec::WritePayload(&model, payload, coded, packets[i]);
+		payload_bytes += payload.size();
+	}
+	const sf::Int64 encode_time = clock.restart().asMicroseconds();
+
+	SnapshotCodec client_codec;
+	std::vector<sf::Uint8> data;
+	std::size_t mismatches = 0;
+	for (std::size_t i = 0; i < packets.size(); ++i)
+	{
+		if (!SnapshotCodec::ReadPayload(model, packets[i], data, payload) || !client_codec.Decode(payload, entries))
+		{
+			mismatches++;
+			continue;
+		}
+
+		for (std::size_t j = 0; j < entries.size(); ++j)
+		{
+			if (entries[j].m_position != snapshots[i][j].m_position)
+			{
+				mismatches++;
+			}
+		}
+	}
+	const sf::Int64 decode_time = clock.getElapsedTime().asMicroseconds();
+
+	const auto report = [&](const char* stage, sf::Int64 microseconds)
+	{
+		const double per_snapshot = static_cast<double>(microseconds) / snapshots.size();
+		output << stage << ','
+			<< static_cast<double>(payload_bytes) / std::max<sf::Int64>(1, microseconds) << ','
+			<< per_snapshot << ','
+			<< 100.0 * per_snapshot * SnapshotPlayers / (TickSeconds * 1000000.0) << '\n';
+	};
+
+	output << "stage,MB_per_s,us_per_snapshot,tick_percent_for_" << SnapshotPlayers << "_clients\n";
+	report("Encode+WritePayload", encode_time);
+	report("ReadPayload+Decode", decode_time);
+	output << "payload_bytes_per_snapshot," << static_cast<double>(payload_bytes) / snapshots.size() << '\n';
+	output << "coded_bytes_per_snapshot," << static_cast<double>(coded_bytes) / snapshots.size() << '\n';
+	output << "mismatches," << mismatches << std::endl;
+}
+
+/// <summary>
+/// Encodes a snapshot for every peer of larger and larger lobbies with GameServer::EncodeSnapshot, on the calling thread
+/// and then split across more and more workers as UpdateClientState does. Every peer acks straight away, as simulated
+/// viewers do. The packets are hashed in peer order and must come out byte for byte the same for every worker count.
+/// </summary>
+void Benchmarks::RunSnapshotEncode(std::ostream& output)
+{
+	const RangeModel model = TrainSnapshotModel();
+
+	const auto run = [&model](std::size_t peers, JobSystem& jobs, std::size_t& bytes, sf::Uint32& hash)
+	{
+		std::vector<SnapshotScheduler::Candidate> candidates(peers);
+		std::vector<std::vector<opt::PlayerIdentifier>> own_players(peers);
+		std::vector<SnapshotScheduler> schedulers(peers);
+		std::vector<SnapshotCodec> codecs(peers);
+		std::vector<GameServer::SnapshotJob> snapshot_jobs(peers);
+
+		for (std::size_t i = 0; i < peers; ++i)
+		{
+			candidates[i].m_identifier = static_cast<opt::PlayerIdentifier>(i + 1);
+			candidates[i].m_position = sf::Vector2f(WorldInfo::WORLD_WIDTH * (i + 0.5f) / peers, 300.f);
+			candidates[i].m_velocity = sf::Vector2f();
+			own_players[i].emplace_back(candidates[i].m_identifier);
+
+			GameServer::SnapshotJob& job = snapshot_jobs[i];
+			job.m_peer = static_cast<sf::Uint32>(i + 1);
+			job.m_scheduler = &schedulers[i];
+			job.m_codec = &codecs[i];
+			job.m_own_players = &own_players[i];
+		}
+
+		unsigned seed = 12345;
+		const auto random = [&seed](float range)
+		{
+			seed = seed * 1103515245u + 12345u;
+			return (static_cast<float>((seed >> 16) & 0x7FFF) / 0x7FFF * 2.f - 1.f) * range;
+		};
+
+		const sf::Time dt = sf::seconds(TickSeconds);
+		sf::Time encode_time;
+		bytes = 0;
+		hash = 2166136261u;
+
+		for (int tick = 0; tick < EncodeTicks; ++tick)
+		{
+			for (SnapshotScheduler::Candidate& candidate : candidates)
+			{
+				candidate.m_velocity.x = std::max(-200.f, std::min(200.f, candidate.m_velocity.x + random(60.f)));
+				candidate.m_position.x = std::max(0.f, std::min(WorldInfo::WORLD_WIDTH, candidate.m_position.x + candidate.m_velocity.x * TickSeconds));
+			}
+
+			const sf::Time now = dt * static_cast<sf::Int64>(tick);
+			sf::Clock clock;
+			jobs.ParallelFor(peers, 1, [&](std::size_t i)
+				{
+					GameServer::EncodeSnapshot(snapshot_jobs[i], candidates, &model, dt, now);
+				});
+			encode_time += clock.getElapsedTime();
+
+			//FNV-1a over every packet in peer order
+			for (GameServer::SnapshotJob& job : snapshot_jobs)
+			{
+				job.m_scheduler->OnAck(job.m_decision.m_sequence, now);
+
+				const sf::Uint8* data = static_cast<const sf::Uint8*>(job.m_packet.getData());
+				for (std::size_t i = 0; i < job.m_packet.getDataSize(); ++i)
+				{
+					hash = (hash ^ data[i]) * 16777619u;
+				}
+				bytes += job.m_packet.getDataSize();
+			}
+		}
+
+		return static_cast<double>(encode_time.asMicroseconds()) / EncodeTicks;
+	};
+
+	output << "peers,workers,us_per_tick,bytes_per_tick,identical\n";
+	for (const std::size_t peers : EncodePeerCounts)
+	{
+		std::size_t serial_bytes = 0;
+		sf::Uint32 serial_hash = 0;
+
+		for (const std::size_t workers : WorkerCounts)
+		{
+			if (workers > 0 && workers >= std::thread::hardware_concurrency())
+			{
+				break;
+			}
+
+			JobSystem jobs(workers);
+			std::size_t bytes = 0;
+			sf::Uint32 hash = 0;
+			const double elapsed = run(peers, jobs, bytes, hash);
+			if (workers == 0)
+			{
+				serial_bytes = bytes;
+				serial_hash = hash;
+			}
+
+			output << peers << ',' << workers << ',' << elapsed << ',' << bytes / EncodeTicks << ','
+				<< (bytes == serial_bytes && hash == serial_hash ? "yes" : "no") << '\n';
+		}
+	}
+	output.flush();
+}
+
+/// <summary>
+/// Runs a server on this machine with a lobby of loopback clients, first sending input once a frame each and then
+/// flooding it. Every input that gets past the rate limits is relayed to all the other clients, so both of the
+/// queues between the server's threads are loaded. Each row is one second of the simulation thread's timings.
+/// </summary>
+void Benchmarks::RunInboundFlood(std::ostream& output)
+{
+	GameServer server(FloodPeers, 0, 0, false, false, 0);
+	std::vector<std::unique_ptr<FloodClient>> clients;
+	sf::Clock clock;
+
+	for (std::size_t i = 0; i < FloodPeers; ++i)
+	{
+		clients.emplace_back(new FloodClient());
+		if (!clients.back()->Connect(clock))
+		{
+			output << "Could not connect to the server" << std::endl;
+			return;
+		}
+	}
+
+	const auto all_joined = [&clients]()
+	{
+		return std::all_of(clients.begin(), clients.end(), [](const std::unique_ptr<FloodClient>& client) { return client->HasJoined(); });
+	};
+	while (!all_joined())
+	{
+		if (clock.getElapsedTime() > ConnectTimeout)
+		{
+			output << "Not every client was given a player" << std::endl;
+			return;
+		}
+
+		for (std::unique_ptr<FloodClient>& client : clients)
+		{
+			client->Flush();
+		}
+		sf::sleep(sf::milliseconds(1));
+	}
+
+	output << "phase,second,steps,avg_jitter_us,max_jitter_us,max_inbound_us,max_simulation_us,max_broadcast_us,received,deferred,dropped\n";
+
+	const int rates[] = { NormalInputsPerSecond, FloodInputsPerSecond };
+	for (const int rate : rates)
+	{
+		for (std::unique_ptr<FloodClient>& client : clients)
+		{
+			client->ResetInputs();
+		}
+
+		//The server publishes its timings once a second, the first second is still settling
+		clock.restart();
+		for (int second = 0; second <= FloodSeconds; ++second)
+		{
+			while (clock.getElapsedTime() < sf::seconds(static_cast<float>(second + 1)))
+			{
+				for (std::unique_ptr<FloodClient>& client : clients)
+				{
+					client->SendInputs(rate, clock.getElapsedTime());
+					client->Flush();
+				}
+				sf::sleep(sf::milliseconds(1));
+			}
+
+			if (second == 0)
+			{
+				continue;
+			}
+
+			const GameServer::TickStatistics tick = server.GetTickStatistics();
+			const GameServer::NetworkStatistics network = server.GetNetworkStatistics();
+			output << (rate == FloodInputsPerSecond ? "flood," : "normal,") << second << ','
+				<< tick.m_steps << ','
+				<< tick.m_average_jitter.asMicroseconds() << ','
+				<< tick.m_max_jitter.asMicroseconds() << ','
+				<< tick.m_max_inbound_time.asMicroseconds() << ','
+				<< tick.m_max_simulation_time.asMicroseconds() << ','
+				<< tick.m_max_broadcast_time.asMicroseconds() << ','
+				<< network.m_received << ','
+				<< network.m_deferred << ','
+				<< network.m_dropped << '\n';
+		}
+	}
+
+	output << "peers," << FloodPeers << std::endl;
+}
+
+/// <summary>
+/// Relays every peer's input to every peer over loopback connections, first with a socket call per packet as
+/// sf::TcpSocket::send/receive(Packet) need and then with the framed buffers the network thread now uses.
+/// The sockets block, so every call moves data and none are spent on an empty socket.
+/// </summary>
+void Benchmarks::RunSocketCalls(std::ostream& output)
+{
+	output << "path,peers,packets_sent,send_calls,packets_received,receive_calls,packets_per_s,MB_per_s\n";
+	for (const std::size_t peers : LoopbackPeerCounts)
+	{
+		for (const bool batched : { false, true })
+		{
+			SocketCalls calls;
+			if (!TimeLoopback(peers, batched, calls))
+			{
+				output << "Could not connect " << peers << " loopback peers" << std::endl;
+				return;
+			}
+
+			output << (batched ? "FlushPeer," : "send(Packet),") << peers << ','
+				<< calls.m_packets_sent << ',' << calls.m_send_calls << ','
+				<< calls.m_packets_received << ',' << calls.m_receive_calls << ','
+				<< (calls.m_packets_sent + calls.m_packets_received) / calls.m_seconds << ','
+				<< calls.m_bytes / calls.m_seconds / 1000000.0 << '\n';
+		}
+	}
+	output.flush();
+}
+
+/// <summary>
+/// Applies snapshots of large lobbies the way UpdateClientState does, with the scans it used to make and with the maps.
+/// World needs a window, so its lookup is copied onto plain entities. The checksums match when both find the same players.
+/// </summary>
+void Benchmarks::RunLargeLobby(std::ostream& output)
+{
+	output << "lookup,players,GetPlayer_ns,UpdateClientState_us,checksum\n";
+	for (const std::size_t players : LobbySizes)
+	{
+		float checksum = 0.f;
+		const LobbyTimes scan = TimeLobby<ScanLobby>(players, checksum);
+		output << "scan," << players << ',' << scan.m_get_player_ns << ',' << scan.m_update_us << ',' << checksum << '\n';
+
+		checksum = 0.f;
+		const LobbyTimes map = TimeLobby<MapLobby>(players, checksum);
+		output << "map," << players << ',' << map.m_get_player_ns << ',' << map.m_update_us << ',' << checksum << '\n';
+	}
+	output.flush();
+}
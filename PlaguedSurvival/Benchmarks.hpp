@@ -0,0 +1,29 @@
+#pragma once
+#include <iosfwd>
+#include <string>
+
+/**
+ * Vilandas Morrissey - D00218436
+ */
+
+/// <summary>
+/// Headless microbenchmarks, run with "benchmark [name]". Each one times the current implementation
+/// against a copy of the one it replaced and writes the results as text.
+/// </summary>
+class Benchmarks
+{
+public:
+	static bool Run(const std::string& name, std::ostream& output);
+
+private:
+	static void RunCommandQueue(std::ostream& output);
+	static void RunSceneUpdate(std::ostream& output);
+	static void RunEntities(std::ostream& output);
+	static void RunParallelUpdate(std::ostream& output);
+	static void RunSpatialGrid(std::ostream& output);
+	static void RunSnapshotCodec(std::ostream& output);
+	static void RunSnapshotEncode(std::ostream& output);
+	static void RunInboundFlood(std::ostream& output);
+	static void RunSocketCalls(std::ostream& output);
+	static void RunLargeLobby(std::ostream& output);
+};
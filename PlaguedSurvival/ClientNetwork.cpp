@@ -0,0 +1,250 @@
+#include "ClientNetwork.hpp"
+
+#include <algorithm>
+#include <SFML/System/Sleep.hpp>
+
+#include "NetworkProtocol.hpp"
+
+/**
+ * Vilandas Morrissey - D00218436
+ */
+
+namespace
+{
+	const sf::Time ClockSyncInterval = sf::seconds(0.5f);
+}
+
+ClientNetwork::ClientNetwork(const sf::IpAddress& address, unsigned short port)
+	: m_thread(&ClientNetwork::ExecutionThread, this)
+	, m_address(address)
+	, m_port(port)
+	, m_inbound(QUEUE_CAPACITY)
+	, m_outbound(QUEUE_CAPACITY)
+	, m_has_partial_packet(false)
+	, m_clock_sample_count(0)
+	, m_clock_offset(0)
+	, m_clock_synced(false)
+	, m_status(Status::kConnecting)
+	, m_last_packet_time(0)
+	, m_waiting_thread_end(false)
+{
+	m_thread.launch();
+}
+
+ClientNetwork::~ClientNetwork()
+{
+	m_waiting_thread_end = true;
+	m_thread.wait();
+}
+
+ClientNetwork::Status ClientNetwork::GetStatus() const
+{
+	return m_status;
+}
+
+bool ClientNetwork::IsConnected() const
+{
+	return m_status == Status::kConnected;
+}
+
+/// <summary>
+/// Queue a packet for the network thread. Safe to call before the connection is established.
+/// </summary>
+/// <returns>False if the outbound queue is full and the packet was dropped</returns>
+bool ClientNetwork::Send(const sf::Packet& packet)
+{
+	return m_outbound.Push(packet);
+}
+
+/// <summary>
+/// Take the oldest received packet. The packet type has already been read by the network thread.
+/// </summary>
+bool ClientNetwork::PollPacket(ReceivedPacket& out)
+{
+	return m_inbound.Pop(out);
+}
+
+sf::Time ClientNetwork::Now() const
+{
+	return m_clock.getElapsedTime();
+}
+
+sf::Time ClientNetwork::GetTimeSinceLastPacket() const
+{
+	return Now() - sf::microseconds(m_last_packet_time);
+}
+
+bool ClientNetwork::IsClockSynced() const
+{
+	return m_clock_synced;
+}
+
+sf::Time ClientNetwork::GetServerTime() const
+{
+	return ToServerTime(Now());
+}
+
+sf::Time ClientNetwork::ToServerTime(sf::Time local_time) const
+{
+	return local_time + sf::microseconds(m_clock_offset);
+}
+
+void ClientNetwork::ExecutionThread()
+{
+	if (!Connect())
+	{
+		m_status = Status::kFailed;
+		return;
+	}
+
+	m_socket.setBlocking(false);
+	m_selector.add(m_socket);
+	m_last_packet_time = Now().asMicroseconds();
+	m_status = Status::kConnected;
+
+	while (!m_waiting_thread_end && m_status == Status::kConnected)
+	{
+		SendPendingPackets();
+
+		//The socket stays readable while the game thread is behind, so waiting on it would spin
+		if (m_inbound.IsFull())
+		{
+			sf::sleep(sf::milliseconds(1));
+			continue;
+		}
+
+		//Wake as soon as data arrives, or every millisecond to flush outbound packets
+		if (m_selector.wait(sf::milliseconds(1)))
+		{
+			ReceivePackets();
+		}
+	}
+
+	//Flush anything queued during shutdown, such as the Quit packet
+	SendPendingPackets();
+	m_socket.disconnect();
+}
+
+bool ClientNetwork::Connect()
+{
+	//The host's server thread may not be listening yet, so keep retrying for a while
+	const sf::Time connect_timeout = sf::seconds(5.f);
+
+	while (!m_waiting_thread_end && Now() < connect_timeout)
+	{
+		if (m_socket.connect(m_address, m_port, connect_timeout - Now()) == sf::Socket::Done)
+		{
+			return true;
+		}
+
+		sf::sleep(sf::milliseconds(100));
+	}
+
+	return false;
+}
+
+void ClientNetwork::SendPendingPackets()
+{
+	while (true)
+	{
+		//Sent from here rather than queued, the outbound queue only has the game thread as its producer
+		if (!m_has_partial_packet && Now() >= m_next_clock_sync)
+		{
+			m_partial_packet.clear();
+			m_partial_packet << static_cast<opt::ClientPacket>(Client::PacketType::ClockSync) << Now().asMicroseconds();
+			m_has_partial_packet = true;
+			m_next_clock_sync = Now() + ClockSyncInterval;
+		}
+
+		if (!m_has_partial_packet)
+		{
+			if (!m_outbound.Pop(m_partial_packet))
+			{
+				return;
+			}
+			m_has_partial_packet = true;
+		}
+
+		const sf::Socket::Status status = m_socket.send(m_partial_packet);
+		if (status == sf::Socket::Partial || status == sf::Socket::NotReady)
+		{
+			//Socket buffer full, try again next loop
+			return;
+		}
+
+		m_has_partial_packet = false;
+
+		if (status == sf::Socket::Disconnected)
+		{
+			m_status = Status::kDisconnected;
+			return;
+		}
+	}
+}
+
+void ClientNetwork::ReceivePackets()
+{
+	ReceivedPacket received;
+
+	//Leave data in the socket while the game thread is behind rather than dropping it
+	while (!m_inbound.IsFull())
+	{
+		received.m_packet.clear();
+		const sf::Socket::Status status = m_socket.receive(received.m_packet);
+
+		if (status == sf::Socket::Disconnected || status == sf::Socket::Error)
+		{
+			m_status = Status::kDisconnected;
+			return;
+		}
+
+		if (status != sf::Socket::Done)
+		{
+			return;
+		}
+
+		received.m_arrival_time = Now();
+		received.m_packet >> received.m_type;
+		m_last_packet_time = received.m_arrival_time.asMicroseconds();
+
+		if (static_cast<Server::PacketType>(received.m_type) == Server::PacketType::ClockSync)
+		{
+			HandleClockSync(received.m_packet, received.m_arrival_time);
+			continue;
+		}
+
+		m_inbound.Push(received);
+	}
+}
+
+/// <summary>
+/// The server stamps its clock when it answers, which is assumed to be halfway through the round trip.
+/// Of the last few samples the one with the shortest round trip is used, it had the least queueing to skew it.
+/// </summary>
+void ClientNetwork::HandleClockSync(sf::Packet& packet, sf::Time arrival_time)
+{
+	sf::Int64 sent_time;
+	sf::Int64 server_time;
+	packet >> sent_time >> server_time;
+	if (!packet)
+	{
+		return;
+	}
+
+	ClockSample& sample = m_clock_samples[m_clock_sample_count++ % m_clock_samples.size()];
+	sample.m_round_trip = arrival_time - sf::microseconds(sent_time);
+	sample.m_offset = sf::microseconds(server_time) - (sf::microseconds(sent_time) + sample.m_round_trip / 2.f);
+
+	const std::size_t count = std::min(m_clock_sample_count, m_clock_samples.size());
+	const ClockSample* best = &m_clock_samples[0];
+	for (std::size_t i = 1; i < count; ++i)
+	{
+		if (m_clock_samples[i].m_round_trip < best->m_round_trip)
+		{
+			best = &m_clock_samples[i];
+		}
+	}
+
+	m_clock_offset = best->m_offset.asMicroseconds();
+	m_clock_synced = true;
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <SFML/Network/IpAddress.hpp>
+#include <SFML/Network/Packet.hpp>
+#include <SFML/Network/SocketSelector.hpp>
+#include <SFML/Network/TcpSocket.hpp>
+#include <SFML/System/Clock.hpp>
+#include <SFML/System/Thread.hpp>
+
+#include "NetworkOptimisations.hpp"
+#include "SpscQueue.hpp"
+
+/**
+ * Vilandas Morrissey - D00218436
+ */
+
+/// <summary>
+/// Owns the client socket on a dedicated thread so a slow frame never delays
+/// packets. The game thread exchanges packets with it through lock-free queues.
+/// </summary>
+class ClientNetwork
+{
+public:
+	enum class Status
+	{
+		kConnecting,
+		kConnected,
+		kFailed,
+		kDisconnected
+	};
+
+	struct ReceivedPacket
+	{
+		opt::ServerPacket m_type;
+		sf::Packet m_packet;
+		sf::Time m_arrival_time;
+	};
+
+public:
+	ClientNetwork(const sf::IpAddress& address, unsigned short port);
+	~ClientNetwork();
+
+	Status GetStatus() const;
+	bool IsConnected() const;
+
+	bool Send(const sf::Packet& packet);
+	bool PollPacket(ReceivedPacket& out);
+
+	sf::Time Now() const;
+	sf::Time GetTimeSinceLastPacket() const;
+
+	//The server's clock as estimated from ClockSync round trips, for comparing times across machines
+	bool IsClockSynced() const;
+	sf::Time GetServerTime() const;
+	sf::Time ToServerTime(sf::Time local_time) const;
+
+private:
+	struct ClockSample
+	{
+		sf::Time m_round_trip;
+		sf::Time m_offset;
+	};
+
+private:
+	void ExecutionThread();
+	bool Connect();
+	void SendPendingPackets();
+	void ReceivePackets();
+	void HandleClockSync(sf::Packet& packet, sf::Time arrival_time);
+
+private:
+	static constexpr std::size_t QUEUE_CAPACITY = 1024;
+
+	sf::Thread m_thread;
+	sf::Clock m_clock;
+	sf::IpAddress m_address;
+	unsigned short m_port;
+	sf::TcpSocket m_socket;
+	sf::SocketSelector m_selector;
+
+	SpscQueue<ReceivedPacket> m_inbound;
+	SpscQueue<sf::Packet> m_outbound;
+
+	//A packet the socket only partially sent, retried before anything else
+	sf::Packet m_partial_packet;
+	bool m_has_partial_packet;
+
+	//Network thread only, the offset is published through the atomics
+	sf::Time m_next_clock_sync;
+	std::array<ClockSample, 8> m_clock_samples;
+	std::size_t m_clock_sample_count;
+	std::atomic<sf::Int64> m_clock_offset;
+	std::atomic<bool> m_clock_synced;
+
+	std::atomic<Status> m_status;
+	std::atomic<sf::Int64> m_last_packet_time;
+	std::atomic<bool> m_waiting_thread_end;
+};
@@ -1,11 +1,24 @@
 #include "Collision.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
 #include "Utility.hpp"
 
 /**
  * Vilandas Morrissey - D00218436
  */
 
+namespace
+{
+	//A move is split at most this many times, enough to land, slide into a wall and stop
+	const int MaxSlides = 3;
+
+	//Float error can leave a resting box this far inside what it rests on, it still counts as touching
+	const float Skin = 0.01f;
+}
+
 /// <summary>
 /// Tests for an intersection between two SceneNodes. Predicts if two nodes will collide.
 /// </summary>
@@ -28,9 +41,15 @@ bool Collision::Intersects(SceneNode& a, SceneNode& b)
 /// <returns>CollisionLocation/returns>
 CollisionLocation Collision::CollisionLocation(SceneNode& a, SceneNode& b)
 {
-	const sf::FloatRect a_bounds = PredictMove(a);
-	const sf::FloatRect b_bounds = PredictMove(b);
+	return CollisionLocation(PredictMove(a), PredictMove(b));
+}
 
+/// <summary>
+/// Tests for the intersection location between two bounding boxes that have already been moved
+/// </summary>
+/// <returns>Where b is relative to a</returns>
+CollisionLocation Collision::CollisionLocation(const sf::FloatRect& a_bounds, const sf::FloatRect& b_bounds)
+{
 	if (a_bounds.intersects(b_bounds))
 	{
 		const float total_half_width = (a_bounds.width + b_bounds.width) / 2;
@@ -72,3 +91,137 @@ sf::FloatRect Collision::PredictMove(const SceneNode& node)
 	return PredictMove(bounds, velocity);
 }
 
+/// <summary>
+/// Moves bounds along motion, stopping at the first obstacle in the way and sliding along it for the rest of the move.
+/// Obstacles are tested over the whole move, so nothing is passed through however far the bounds move.
+/// Obstacles the bounds already overlap are ignored so they can be moved out of.
+/// </summary>
+/// <param name="moved">How far the bounds actually moved</param>
+/// <returns>CollisionLocation flags for each side that ran into an obstacle</returns>
+unsigned Collision::Sweep(const sf::FloatRect& bounds, sf::Vector2f motion, const std::vector<sf::FloatRect>& obstacles, sf::Vector2f& moved)
+{
+	unsigned contacts = 0;
+	sf::FloatRect current = bounds;
+	moved = sf::Vector2f();
+
+	for (int i = 0; i < MaxSlides && (motion.x != 0.f || motion.y != 0.f); ++i)
+	{
+		float time = 1.f;
+		::CollisionLocation location = CollisionLocation::kNone;
+
+		for (const sf::FloatRect& obstacle : obstacles)
+		{
+			float obstacle_time;
+			::CollisionLocation obstacle_location;
+			if (TimeOfImpact(current, motion, obstacle, obstacle_time, obstacle_location) && obstacle_time < time)
+			{
+				time = obstacle_time;
+				location = obstacle_location;
+			}
+		}
+
+		const sf::Vector2f step = motion * time;
+		current.left += step.x;
+		current.top += step.y;
+		moved += step;
+
+		if (location == CollisionLocation::kNone)
+		{
+			break;
+		}
+
+		//Whatever is left of the move carries on along the surface that was hit
+		contacts |= static_cast<unsigned>(location);
+		motion -= step;
+		if (static_cast<unsigned>(location) & static_cast<unsigned>(CollisionLocation::kXAxis))
+		{
+			motion.x = 0.f;
+		}
+		else
+		{
+			motion.y = 0.f;
+		}
+	}
+
+	return contacts;
+}
+
+/// <summary>
+/// Finds when during motion bounds a first touches bounds b, as a fraction of the motion
+/// </summary>
+/// <param name="location">The side of a that touches b</param>
+/// <returns>False if they do not meet during the motion</returns>
+bool Collision::TimeOfImpact(const sf::FloatRect& a_bounds, const sf::Vector2f& motion, const sf::FloatRect& b_bounds, float& time, ::CollisionLocation& location)
+{
+	float entry_x, exit_x, entry_y, exit_y;
+	if (!GetAxisTimes(a_bounds.left, a_bounds.left + a_bounds.width, b_bounds.left, b_bounds.left + b_bounds.width, motion.x, entry_x, exit_x) ||
+		!GetAxisTimes(a_bounds.top, a_bounds.top + a_bounds.height, b_bounds.top, b_bounds.top + b_bounds.height, motion.y, entry_y, exit_y))
+	{
+		return false;
+	}
+
+	const float entry = std::max(entry_x, entry_y);
+	const float exit = std::min(exit_x, exit_y);
+
+	//Already overlapping, missing, or only grazing a corner
+	if (entry < 0.f || entry > 1.f || entry >= exit)
+	{
+		return false;
+	}
+
+	if (entry_x > entry_y)
+	{
+		location = motion.x > 0 ? CollisionLocation::kRight : CollisionLocation::kLeft;
+	}
+	else
+	{
+		location = motion.y > 0 ? CollisionLocation::kBottom : CollisionLocation::kTop;
+	}
+
+	time = entry;
+	return true;
+}
+
+/// <summary>
+/// Everything the bounds pass over during motion, for finding the obstacles to sweep against
+/// </summary>
+sf::FloatRect Collision::GetSweptBounds(const sf::FloatRect& bounds, const sf::Vector2f& motion)
+{
+	return {
+		bounds.left + std::min(motion.x, 0.f),
+		bounds.top + std::min(motion.y, 0.f),
+		bounds.width + std::abs(motion.x),
+		bounds.height + std::abs(motion.y)
+	};
+}
+
+/// <summary>
+/// When the two ranges start and stop overlapping along one axis, as fractions of the motion.
+/// Without motion they either always overlap or never do.
+/// </summary>
+bool Collision::GetAxisTimes(float a_min, float a_max, float b_min, float b_max, float motion, float& entry, float& exit)
+{
+	if (motion == 0.f)
+	{
+		if (a_max <= b_min + Skin || a_min >= b_max - Skin)
+		{
+			return false;
+		}
+
+		entry = -std::numeric_limits<float>::infinity();
+		exit = std::numeric_limits<float>::infinity();
+		return true;
+	}
+
+	float near_distance = motion > 0 ? b_min - a_max : a_min - b_max;
+	const float far_distance = motion > 0 ? b_max - a_min : a_max - b_min;
+
+	if (near_distance < 0.f && near_distance > -Skin)
+	{
+		near_distance = 0.f;
+	}
+
+	entry = near_distance / std::abs(motion);
+	exit = far_distance / std::abs(motion);
+	return true;
+}
@@ -1,4 +1,5 @@
 #pragma once
+#include <vector>
 #include <SFML/Graphics/Rect.hpp>
 
 #include "CollisionLocation.hpp"
@@ -13,6 +14,14 @@ class Collision
 public:
 	static bool Intersects(SceneNode& a, SceneNode& b);
 	static CollisionLocation CollisionLocation(SceneNode& a, SceneNode& b);
+	static ::CollisionLocation CollisionLocation(const sf::FloatRect& a_bounds, const sf::FloatRect& b_bounds);
 	static sf::FloatRect PredictMove(const sf::FloatRect& bounds, const sf::Vector2f& velocity);
 	static sf::FloatRect PredictMove(const SceneNode& node);
+
+	static unsigned Sweep(const sf::FloatRect& bounds, sf::Vector2f motion, const std::vector<sf::FloatRect>& obstacles, sf::Vector2f& moved);
+	static bool TimeOfImpact(const sf::FloatRect& a_bounds, const sf::Vector2f& motion, const sf::FloatRect& b_bounds, float& time, ::CollisionLocation& location);
+	static sf::FloatRect GetSweptBounds(const sf::FloatRect& bounds, const sf::Vector2f& motion);
+
+private:
+	static bool GetAxisTimes(float a_min, float a_max, float b_min, float b_max, float motion, float& entry, float& exit);
 };
@@ -0,0 +1,202 @@
+#include "CollisionTestScene.hpp"
+
+#include <cmath>
+#include <ostream>
+#include <SFML/System/Clock.hpp>
+
+#include "Collision.hpp"
+#include "SpatialGrid.hpp"
+#include "TileGrid.hpp"
+#include "TileMap.hpp"
+
+/**
+ * Vilandas Morrissey - D00218436
+ */
+
+namespace
+{
+	//Matches the Doc character: gravity while falling, fastest fall, run speed and size at half scale
+	const float Gravity = 800.f;
+	const float MaxFallSpeed = 800.f;
+	const float RunSpeed = 300.f;
+	const sf::Vector2f BodySize(40.f, 100.f);
+
+	const int PlatformRow = 10;
+	const int PlatformFirstColumn = 2;
+	const int PlatformLastColumn = 10;
+	const int FloorRow = 20;
+	const int WallColumn = 30;
+
+	const float Tolerance = 0.1f;
+	const sf::Time SceneDuration = sf::seconds(3.f);
+	const sf::Time StepSizes[] = { sf::seconds(1.f / 60.f), sf::seconds(1.f / 30.f), sf::seconds(1.f / 15.f), sf::seconds(1.f / 8.f), sf::seconds(1.f / 4.f) };
+
+	const int BenchmarkBodies = 1000;
+	const int BenchmarkSteps = 600;
+}
+
+/// <returns>False if the swept solver let a box through a tile</returns>
+bool CollisionTestScene::Run(std::ostream& output)
+{
+	CollisionTestScene scene;
+	bool passed = true;
+
+	//Negative distances are boxes that went into or through the surface
+	output << "step_ms,swept_drop,swept_wall,overlap_drop,overlap_wall\n";
+	for (const sf::Time dt : StepSizes)
+	{
+		const float swept_drop = scene.Drop(dt, true);
+		const float swept_wall = scene.RunIntoWall(dt, true);
+		passed = passed && std::abs(swept_drop) < Tolerance && std::abs(swept_wall) < Tolerance;
+
+		output << dt.asMilliseconds() << ',' << swept_drop << ',' << swept_wall << ','
+			<< scene.Drop(dt, false) << ',' << scene.RunIntoWall(dt, false) << '\n';
+	}
+
+	output << "\nmethod,us_per_body_step\n";
+	output << "swept," << scene.TimeSteps(true) << '\n';
+	output << "overlap," << scene.TimeSteps(false) << '\n';
+
+	SpatialGrid::Instance().Clear();
+	return passed;
+}
+
+CollisionTestScene::CollisionTestScene()
+{
+	SpatialGrid& grid = SpatialGrid::Instance();
+	grid.Clear();
+
+	for (int column = 0; column < TileGrid::COLUMNS; ++column)
+	{
+		const int cell = TileGrid::GetCell(column, FloorRow);
+		grid.Insert(cell, TileMap::GetCellBounds(cell), Layers::kActivePlatforms);
+	}
+
+	for (int column = PlatformFirstColumn; column <= PlatformLastColumn; ++column)
+	{
+		const int cell = TileGrid::GetCell(column, PlatformRow);
+		grid.Insert(cell, TileMap::GetCellBounds(cell), Layers::kActivePlatforms);
+	}
+
+	for (int row = PlatformRow; row < FloorRow; ++row)
+	{
+		const int cell = TileGrid::GetCell(WallColumn, row);
+		grid.Insert(cell, TileMap::GetCellBounds(cell), Layers::kActivePlatforms);
+	}
+}
+
+/// <summary>
+/// One step of character movement, either swept or the old way of testing where the box will be
+/// and stopping against anything it would overlap
+/// </summary>
+void CollisionTestScene::Step(Body& body, sf::Time dt, bool swept)
+{
+	body.m_velocity.y = std::min(body.m_velocity.y + Gravity * dt.asSeconds(), MaxFallSpeed);
+	const sf::Vector2f motion = body.m_velocity * dt.asSeconds();
+
+	if (swept)
+	{
+		SpatialGrid::Instance().Query(Collision::GetSweptBounds(body.m_bounds, motion), Layers::kActivePlatforms, m_candidates);
+		m_boxes.clear();
+		for (const int cell : m_candidates)
+		{
+			m_boxes.emplace_back(TileMap::GetCellBounds(cell));
+		}
+
+		sf::Vector2f moved;
+		const unsigned contacts = Collision::Sweep(body.m_bounds, motion, m_boxes, moved);
+		if (contacts & static_cast<unsigned>(CollisionLocation::kXAxis))
+		{
+			body.m_velocity.x = 0.f;
+		}
+		if (contacts & static_cast<unsigned>(CollisionLocation::kYAxis))
+		{
+			body.m_velocity.y = 0.f;
+		}
+
+		body.m_bounds.left += moved.x;
+		body.m_bounds.top += moved.y;
+		return;
+	}
+
+	const sf::FloatRect predicted = Collision::PredictMove(body.m_bounds, motion);
+	SpatialGrid::Instance().Query(predicted, Layers::kActivePlatforms, m_candidates);
+	for (const int cell : m_candidates)
+	{
+		switch (Collision::CollisionLocation(predicted, TileMap::GetCellBounds(cell)))
+		{
+		case CollisionLocation::kLeft:
+		case CollisionLocation::kRight:
+			body.m_velocity.x = 0.f;
+			break;
+		case CollisionLocation::kTop:
+		case CollisionLocation::kBottom:
+			body.m_velocity.y = 0.f;
+			break;
+		default:
+			break;
+		}
+	}
+
+	body.m_bounds.left += body.m_velocity.x * dt.asSeconds();
+	body.m_bounds.top += body.m_velocity.y * dt.asSeconds();
+}
+
+/// <returns>How far above the platform a box dropped from the top of the world ends up</returns>
+float CollisionTestScene::Drop(sf::Time dt, bool swept)
+{
+	Body body{ sf::FloatRect(sf::Vector2f(PlatformFirstColumn * WorldInfo::TILE_SIZE + 100.f, 0.f), BodySize), sf::Vector2f() };
+
+	for (sf::Time time; time < SceneDuration; time += dt)
+	{
+		Step(body, dt, swept);
+	}
+
+	return PlatformRow * WorldInfo::TILE_SIZE - (body.m_bounds.top + body.m_bounds.height);
+}
+
+/// <returns>How far short of the wall a box running along the floor ends up</returns>
+float CollisionTestScene::RunIntoWall(sf::Time dt, bool swept)
+{
+	Body body{ sf::FloatRect(sf::Vector2f((WallColumn - 8) * WorldInfo::TILE_SIZE, FloorRow * WorldInfo::TILE_SIZE - BodySize.y), BodySize), sf::Vector2f(RunSpeed, 0.f) };
+
+	for (sf::Time time; time < SceneDuration; time += dt)
+	{
+		body.m_velocity.x = RunSpeed;
+		Step(body, dt, swept);
+	}
+
+	return WallColumn * WorldInfo::TILE_SIZE - (body.m_bounds.left + body.m_bounds.width);
+}
+
+/// <summary>
+/// Boxes spread over the scene, falling and running back and forth, stepped at the game's rate
+/// </summary>
+/// <returns>Average microseconds per box per step</returns>
+double CollisionTestScene::TimeSteps(bool swept)
+{
+	std::vector<Body> bodies;
+	for (int i = 0; i < BenchmarkBodies; ++i)
+	{
+		const float x = static_cast<float>((i * 37) % (TileGrid::COLUMNS - 1)) * WorldInfo::TILE_SIZE;
+		const float y = static_cast<float>((i * 11) % (FloorRow - 2)) * WorldInfo::TILE_SIZE;
+		bodies.push_back({ sf::FloatRect(sf::Vector2f(x, y), BodySize), sf::Vector2f(i % 2 == 0 ? RunSpeed : -RunSpeed, 0.f) });
+	}
+
+	const sf::Time dt = sf::seconds(1.f / 60.f);
+	sf::Clock clock;
+
+	for (int step = 0; step < BenchmarkSteps; ++step)
+	{
+		for (Body& body : bodies)
+		{
+			if (body.m_velocity.x == 0.f)
+			{
+				body.m_velocity.x = step % 2 == 0 ? RunSpeed : -RunSpeed;
+			}
+			Step(body, dt, swept);
+		}
+	}
+
+	return static_cast<double>(clock.getElapsedTime().asMicroseconds()) / (static_cast<double>(BenchmarkBodies) * BenchmarkSteps);
+}
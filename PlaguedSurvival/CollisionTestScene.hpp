@@ -0,0 +1,39 @@
+#pragma once
+#include <iosfwd>
+#include <vector>
+#include <SFML/Graphics/Rect.hpp>
+#include <SFML/System/Time.hpp>
+
+/**
+ * Vilandas Morrissey - D00218436
+ */
+
+/// <summary>
+/// A fixed scene for checking character collisions without a window: boxes are dropped onto a thin
+/// platform and run into a wall at increasing step sizes, once with the swept solver and once with the
+/// old overlap test, then both are timed over many boxes. The results are written as CSV, with how far
+/// each box ended up from the surface it should be resting against.
+/// </summary>
+class CollisionTestScene
+{
+public:
+	static bool Run(std::ostream& output);
+
+private:
+	struct Body
+	{
+		sf::FloatRect m_bounds;
+		sf::Vector2f m_velocity;
+	};
+
+	CollisionTestScene();
+
+	void Step(Body& body, sf::Time dt, bool swept);
+	float Drop(sf::Time dt, bool swept);
+	float RunIntoWall(sf::Time dt, bool swept);
+	double TimeSteps(bool swept);
+
+private:
+	std::vector<int> m_candidates;
+	std::vector<sf::FloatRect> m_boxes;
+};
@@ -1,4 +1,84 @@
 #include "Command.hpp"
+
+CommandAction::CommandAction()
+	: m_storage()
+	, m_operations(nullptr)
+{
+}
+
+CommandAction::CommandAction(const CommandAction& other)
+	: m_operations(other.m_operations)
+{
+	if (m_operations)
+	{
+		m_operations->m_copy(&m_storage, &other.m_storage);
+	}
+}
+
+CommandAction::CommandAction(CommandAction&& other) noexcept
+	: m_operations(other.m_operations)
+{
+	if (m_operations)
+	{
+		m_operations->m_move(&m_storage, &other.m_storage);
+		other.Reset();
+	}
+}
+
+CommandAction& CommandAction::operator=(const CommandAction& other)
+{
+	if (this != &other)
+	{
+		Reset();
+		if (other.m_operations)
+		{
+			other.m_operations->m_copy(&m_storage, &other.m_storage);
+			m_operations = other.m_operations;
+		}
+	}
+	return *this;
+}
+
+CommandAction& CommandAction::operator=(CommandAction&& other) noexcept
+{
+	if (this != &other)
+	{
+		Reset();
+		if (other.m_operations)
+		{
+			other.m_operations->m_move(&m_storage, &other.m_storage);
+			m_operations = other.m_operations;
+			other.Reset();
+		}
+	}
+	return *this;
+}
+
+CommandAction::~CommandAction()
+{
+	Reset();
+}
+
+void CommandAction::operator()(SceneNode& node, sf::Time dt) const
+{
+	assert(m_operations != nullptr);
+	m_operations->m_invoke(&m_storage, node, dt);
+}
+
+CommandAction::operator bool() const
+{
+	return m_operations != nullptr;
+}
+
+void CommandAction::Reset()
+{
+	if (m_operations)
+	{
+		m_operations->m_destroy(&m_storage);
+		m_operations = nullptr;
+	}
+}
+
 Command::Command()
 	: action()
 	, category(Category::kNone)
@@ -1,20 +1,61 @@
 #pragma once
 #include "Category.hpp"
 #include <SFML/System/Time.hpp>
-#include <functional>
 #include <cassert>
+#include <cstddef>
+#include <type_traits>
 
 class SceneNode;
 
+/// <summary>
+/// A void(SceneNode&, sf::Time) callable kept inside the command itself instead of on the heap.
+/// Anything larger than the storage fails to compile, so creating, copying and moving commands never allocates.
+/// </summary>
+class CommandAction
+{
+public:
+	static constexpr std::size_t STORAGE_SIZE = 32;
+
+public:
+	CommandAction();
+	template<typename Function, typename = typename std::enable_if<!std::is_same<typename std::decay<Function>::type, CommandAction>::value>::type>
+	CommandAction(Function fn);
+	CommandAction(const CommandAction& other);
+	CommandAction(CommandAction&& other) noexcept;
+	CommandAction& operator=(const CommandAction& other);
+	CommandAction& operator=(CommandAction&& other) noexcept;
+	~CommandAction();
+
+	void operator()(SceneNode& node, sf::Time dt) const;
+	explicit operator bool() const;
+
+private:
+	struct Operations
+	{
+		void (*m_invoke)(const void* storage, SceneNode& node, sf::Time dt);
+		void (*m_copy)(void* destination, const void* source);
+		void (*m_move)(void* destination, void* source);
+		void (*m_destroy)(void* storage);
+	};
+
+	template<typename Function>
+	static const Operations* GetOperations();
+	void Reset();
+
+private:
+	typename std::aligned_storage<STORAGE_SIZE, alignof(std::max_align_t)>::type m_storage;
+	const Operations* m_operations;
+};
+
 struct Command
 {
 	Command();
-	std::function<void(SceneNode&, sf::Time)> action;
+	CommandAction action;
 	unsigned int category;
 };
 
 template<typename GameObject, typename Function>
-std::function<void(SceneNode&, sf::Time)> DerivedAction(Function fn)
+CommandAction DerivedAction(Function fn)
 {
 	return [=](SceneNode& node, sf::Time dt)
 	{
@@ -24,4 +65,6 @@ std::function<void(SceneNode&, sf::Time)> DerivedAction(Function fn)
 		//Downcast node and invoke the function
 		fn(static_cast<GameObject&>(node), dt);
 	};
-}
\ No newline at end of file
+}
+
+#include "Command.inl"
\ No newline at end of file
@@ -0,0 +1,37 @@
+#include <new>
+#include <utility>
+
+template<typename Function, typename>
+CommandAction::CommandAction(Function fn)
+	: m_operations(GetOperations<Function>())
+{
+	static_assert(sizeof(Function) <= STORAGE_SIZE, "Command actions must fit in CommandAction::STORAGE_SIZE");
+	static_assert(alignof(Function) <= alignof(std::max_align_t), "Command actions cannot be over-aligned");
+	new (&m_storage) Function(std::move(fn));
+}
+
+//One table of operations per callable type, shared by every action holding that type
+template<typename Function>
+const CommandAction::Operations* CommandAction::GetOperations()
+{
+	static const Operations operations =
+	{
+		[](const void* storage, SceneNode& node, sf::Time dt)
+		{
+			(*static_cast<const Function*>(storage))(node, dt);
+		},
+		[](void* destination, const void* source)
+		{
+			new (destination) Function(*static_cast<const Function*>(source));
+		},
+		[](void* destination, void* source)
+		{
+			new (destination) Function(std::move(*static_cast<Function*>(source)));
+		},
+		[](void* storage)
+		{
+			static_cast<Function*>(storage)->~Function();
+		}
+	};
+	return &operations;
+}
@@ -0,0 +1,159 @@
+#include "CommandDispatcher.hpp"
+
+#include <algorithm>
+#include <bitset>
+
+#include "SceneNode.hpp"
+
+/**
+ * Vilandas Morrissey - D00218436
+ */
+
+CommandDispatcher CommandDispatcher::m_instance;
+
+CommandDispatcher::CommandDispatcher()
+	: m_subscribers()
+	, m_dispatching(false)
+	, m_deferred_removals()
+	, m_commands(0)
+	, m_visited(0)
+{
+}
+
+//Nodes still subscribed keep their slots, Unsubscribe ignores slots that no longer hold the node
+void CommandDispatcher::Clear()
+{
+	for (std::vector<Subscriber>& subscribers : m_subscribers)
+	{
+		subscribers.clear();
+	}
+	m_deferred_removals.clear();
+}
+
+void CommandDispatcher::Subscribe(SceneNode* node, unsigned int category, Slots& slots)
+{
+	slots.clear();
+
+	for (int bit = 0; bit < CATEGORY_BITS; ++bit)
+	{
+		if (category & (1u << bit))
+		{
+			slots.emplace_back(m_subscribers[bit].size());
+			m_subscribers[bit].push_back({ node, category, &slots });
+		}
+	}
+}
+
+/// <summary>
+/// Constant time per category bit, the last subscriber takes the removed one's place.
+/// During a Dispatch the subscriber is only emptied and removed once the command has been delivered,
+/// so the subscribers the command has not reached yet do not move.
+/// </summary>
+void CommandDispatcher::Unsubscribe(SceneNode* node, unsigned int category, Slots& slots)
+{
+	for (int bit = 0; bit < CATEGORY_BITS; ++bit)
+	{
+		if ((category & (1u << bit)) == 0)
+		{
+			continue;
+		}
+
+		std::vector<Subscriber>& subscribers = m_subscribers[bit];
+		const std::size_t index = slots[GetSlot(category, bit)];
+		if (index >= subscribers.size() || subscribers[index].m_node != node)
+		{
+			continue;
+		}
+
+		if (m_dispatching)
+		{
+			subscribers[index].m_node = nullptr;
+			m_deferred_removals.push_back({ bit, index });
+		}
+		else
+		{
+			RemoveAt(bit, index);
+		}
+	}
+
+	slots.clear();
+}
+
+/// <summary>
+/// Costs one call per matching node. A node in several of the command's categories only receives it once.
+/// </summary>
+void CommandDispatcher::Dispatch(const Command& command, sf::Time dt)
+{
+	m_commands++;
+	m_dispatching = true;
+
+	for (int bit = 0; bit < CATEGORY_BITS; ++bit)
+	{
+		const unsigned int category = 1u << bit;
+		if ((command.category & category) == 0)
+		{
+			continue;
+		}
+
+		//Actions can attach and detach nodes. Nodes detached during the command are skipped,
+		//nodes subscribed during it are left until the next one.
+		const std::vector<Subscriber>& subscribers = m_subscribers[bit];
+		const std::size_t count = subscribers.size();
+
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			const Subscriber subscriber = subscribers[i];
+			if (subscriber.m_node == nullptr || subscriber.m_category & command.category & (category - 1))
+			{
+				continue;
+			}
+
+			m_visited++;
+			command.action(*subscriber.m_node, dt);
+		}
+	}
+
+	m_dispatching = false;
+
+	//Highest index first, so the subscriber moved into each freed slot is never one still waiting to be removed
+	std::sort(m_deferred_removals.begin(), m_deferred_removals.end(), [](const DeferredRemoval& lhs, const DeferredRemoval& rhs)
+		{
+			return lhs.m_index > rhs.m_index;
+		});
+
+	for (const DeferredRemoval& removal : m_deferred_removals)
+	{
+		RemoveAt(removal.m_bit, removal.m_index);
+	}
+	m_deferred_removals.clear();
+}
+
+/// <summary>
+/// Number of commands dispatched and the nodes they were delivered to since the last call
+/// </summary>
+void CommandDispatcher::TakeStatistics(std::size_t& commands, std::size_t& visited)
+{
+	commands = m_commands;
+	visited = m_visited;
+	m_commands = 0;
+	m_visited = 0;
+}
+
+//The position of bit's slot among the slots of a node subscribed under category
+std::size_t CommandDispatcher::GetSlot(unsigned int category, int bit)
+{
+	return std::bitset<CATEGORY_BITS>(category & ((1u << bit) - 1)).count();
+}
+
+void CommandDispatcher::RemoveAt(int bit, std::size_t index)
+{
+	std::vector<Subscriber>& subscribers = m_subscribers[bit];
+
+	if (index != subscribers.size() - 1)
+	{
+		subscribers[index] = subscribers.back();
+		const Subscriber& moved = subscribers[index];
+		(*moved.m_slots)[GetSlot(moved.m_category, bit)] = index;
+	}
+	subscribers.pop_back();
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <array>
+#include <vector>
+#include <SFML/System/Time.hpp>
+
+#include "Command.hpp"
+
+/**
+ * Vilandas Morrissey - D00218436
+ */
+
+class SceneNode;
+
+/// <summary>
+/// Delivers commands straight to the nodes in the command's categories instead of walking the scene graph.
+/// Scene nodes subscribe under every bit of their category when they join a subscribed graph and
+/// unsubscribe when they leave it or are destroyed, so a node's category must not change while it is attached.
+/// </summary>
+class CommandDispatcher
+{
+public:
+	//Where a node is in the subscriber list of each bit of its category, lowest bit first
+	typedef std::vector<std::size_t> Slots;
+
+public:
+	CommandDispatcher(const CommandDispatcher&) = delete;
+
+	static CommandDispatcher& Instance()
+	{
+		return m_instance;
+	}
+
+	void Clear();
+	void Subscribe(SceneNode* node, unsigned int category, Slots& slots);
+	void Unsubscribe(SceneNode* node, unsigned int category, Slots& slots);
+
+	void Dispatch(const Command& command, sf::Time dt);
+	void TakeStatistics(std::size_t& commands, std::size_t& visited);
+
+private:
+	struct Subscriber
+	{
+		SceneNode* m_node;
+		unsigned int m_category;
+		Slots* m_slots;
+	};
+
+	struct DeferredRemoval
+	{
+		int m_bit;
+		std::size_t m_index;
+	};
+
+	static constexpr int CATEGORY_BITS = sizeof(unsigned int) * 8;
+
+private:
+	CommandDispatcher();
+
+	static std::size_t GetSlot(unsigned int category, int bit);
+	void RemoveAt(int bit, std::size_t index);
+
+private:
+	static CommandDispatcher m_instance;
+
+	std::array<std::vector<Subscriber>, CATEGORY_BITS> m_subscribers;
+	bool m_dispatching;
+	std::vector<DeferredRemoval> m_deferred_removals;
+	std::size_t m_commands;
+	std::size_t m_visited;
+};
@@ -1,18 +1,67 @@
 #include "CommandQueue.hpp"
 
+#include <cassert>
+#include <utility>
+
+namespace
+{
+	//A frame's input and emitter commands fit many times over, must be a power of two
+	const std::size_t InitialCapacity = 256;
+}
+
+CommandQueue::CommandQueue()
+	: m_slots(InitialCapacity)
+	, m_head(0)
+	, m_count(0)
+{
+}
+
 void CommandQueue::Push(const Command& command)
 {
-	m_queue.push(command);
+	NextSlot() = command;
+}
+
+void CommandQueue::Push(Command&& command)
+{
+	NextSlot() = std::move(command);
 }
 
 Command CommandQueue::Pop()
 {
-	Command command = m_queue.front();
-	m_queue.pop();
+	assert(m_count > 0);
+
+	Command command = std::move(m_slots[m_head]);
+	m_head = (m_head + 1) & (m_slots.size() - 1);
+	m_count--;
 	return command;
 }
 
 bool CommandQueue::IsEmpty() const
 {
-	return m_queue.empty();
+	return m_count == 0;
+}
+
+Command& CommandQueue::NextSlot()
+{
+	if (m_count == m_slots.size())
+	{
+		Grow();
+	}
+
+	Command& slot = m_slots[(m_head + m_count) & (m_slots.size() - 1)];
+	m_count++;
+	return slot;
+}
+
+//Doubles the slots, unwrapping the queued commands to the front
+void CommandQueue::Grow()
+{
+	std::vector<Command> slots(m_slots.size() * 2);
+	for (std::size_t i = 0; i < m_count; ++i)
+	{
+		slots[i] = std::move(m_slots[(m_head + i) & (m_slots.size() - 1)]);
+	}
+
+	m_slots.swap(slots);
+	m_head = 0;
 }
\ No newline at end of file
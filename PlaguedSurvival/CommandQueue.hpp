@@ -1,14 +1,28 @@
 #pragma once
 #include "Command.hpp"
-#include <queue>
+#include <vector>
 // TODO Make CommandQueue class a Singleton
+
+/// <summary>
+/// Ring buffer of commands. Slots are reused frame to frame, so pushing and popping never allocate
+/// unless a frame pushes more commands than have ever been queued at once.
+/// </summary>
 class CommandQueue
 {
 public:
+	CommandQueue();
+
 	void Push(const Command& command);
+	void Push(Command&& command);
 	Command Pop();
 	bool IsEmpty() const;
 
 private:
-	std::queue<Command> m_queue;
+	Command& NextSlot();
+	void Grow();
+
+private:
+	std::vector<Command> m_slots;
+	std::size_t m_head;
+	std::size_t m_count;
 };
\ No newline at end of file
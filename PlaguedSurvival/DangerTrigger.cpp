@@ -1,5 +1,7 @@
 #include "DangerTrigger.hpp"
 
+#include <algorithm>
+
 #include "Utility.hpp"
 
 /**
@@ -31,7 +33,7 @@ void DangerTrigger::AddDangerObject(Dangerous* danger)
 
 void DangerTrigger::RemoveDangerObject(const Dangerous* danger)
 {
-	m_dangers.erase(std::find(m_dangers.begin(), m_dangers.end(), danger));
+	m_dangers.erase(std::remove(m_dangers.begin(), m_dangers.end(), danger), m_dangers.end());
 }
 
 void DangerTrigger::Update(sf::Time dt)
@@ -49,19 +51,44 @@ void DangerTrigger::Update(float dt_as_seconds)
 	{
 		m_danger_time -= 1;
 
-		int dps = static_cast<int>(m_dangers_per_second);
+		std::size_t dps = static_cast<std::size_t>(m_dangers_per_second);
 
-		if (dps > m_dangers.size())
+		if (dps > CountDangers())
 		{
-			dps = m_dangers.size();
+			dps = CountDangers();
 		}
 
-		for (int i = 0; i < dps; i++)
+		//Triggering a danger can change how many there are, so they are counted again for every pick
+		for (std::size_t i = 0; i < dps; i++)
 		{
-			const int chosenIndex = Utility::RandomInt(m_dangers.size());
-			m_dangers[chosenIndex]->Trigger();
+			const std::size_t total = CountDangers();
+			if (total == 0)
+			{
+				break;
+			}
+
+			std::size_t chosen_index = Utility::RandomInt(static_cast<int>(total));
+			for (Dangerous* danger : m_dangers)
+			{
+				if (chosen_index < danger->GetDangerCount())
+				{
+					danger->Trigger(chosen_index);
+					break;
+				}
+				chosen_index -= danger->GetDangerCount();
+			}
 		}
 	}
 
 	m_dangers_per_second += m_danger_increment_per_second * dt_as_seconds;
 }
+
+std::size_t DangerTrigger::CountDangers() const
+{
+	std::size_t total = 0;
+	for (const Dangerous* danger : m_dangers)
+	{
+		total += danger->GetDangerCount();
+	}
+	return total;
+}
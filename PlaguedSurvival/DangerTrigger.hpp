@@ -26,6 +26,7 @@ public:
 
 private:
 	DangerTrigger();
+	std::size_t CountDangers() const;
 
 	const float DEFAULT_DPS = 0.8f;
 	const float DEFAULT_IPS = 0.1f;
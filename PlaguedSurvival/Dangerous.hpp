@@ -1,11 +1,14 @@
 #pragma once
+#include <cstddef>
 
 /**
  * Vilandas Morrissey - D00218436
  */
 
+//A source of dangers, DangerTrigger picks one of its GetDangerCount() dangers at random to trigger
 class Dangerous
 {
 public:
-	virtual void Trigger() = 0;
+	virtual std::size_t GetDangerCount() const = 0;
+	virtual void Trigger(std::size_t index) = 0;
 };
\ No newline at end of file
@@ -1,6 +1,6 @@
 #include "Entity.hpp"
 
-#include "Utility.hpp"
+#include <algorithm>
 
 /**
  * Vilandas Morrissey - D00218436
@@ -29,7 +29,6 @@ Entity::Entity(
 	, m_deceleration(deceleration)
 	, m_gravity(gravity)
 	, m_delta_time_in_seconds(0)
-	, m_is_marked_for_removal(false)
 {
 }
 
@@ -40,6 +39,7 @@ Entity::Entity(
 void Entity::SetVelocity(sf::Vector2f velocity)
 {
 	m_velocity = velocity;
+	Wake();
 }
 
 /// <summary>
@@ -49,6 +49,7 @@ void Entity::SetVelocity(sf::Vector2f velocity)
 void Entity::SetGravity(float gravity)
 {
 	m_gravity = gravity;
+	Wake();
 }
 
 /// <summary>
@@ -60,6 +61,7 @@ void Entity::SetVelocity(float vx, float vy)
 {
 	m_velocity.x = vx;
 	m_velocity.y = vy;
+	Wake();
 }
 
 /// <summary>
@@ -69,6 +71,7 @@ void Entity::SetVelocity(float vx, float vy)
 void Entity::AddVelocity(sf::Vector2f velocity)
 {
 	m_velocity += velocity;
+	Wake();
 }
 
 
@@ -81,6 +84,7 @@ void Entity::AddVelocity(float vx, float vy)
 {
 	m_velocity.x += vx;
 	m_velocity.y += vy;
+	Wake();
 }
 
 /// <summary>
@@ -89,8 +93,9 @@ void Entity::AddVelocity(float vx, float vy)
 /// <param name="direction">Direction to add to list</param>
 void Entity::AddDirection(sf::Vector2i direction)
 {
-	m_directions[direction] = 0;
+	m_directions.Add(direction);
 	UpdateDirectionUnit();
+	Wake();
 }
 
 /// <summary>
@@ -99,7 +104,7 @@ void Entity::AddDirection(sf::Vector2i direction)
 /// <param name="direction">Direction to remove from list</param>
 void Entity::RemoveDirection(sf::Vector2i direction)
 {
-	m_directions.erase(direction);
+	m_directions.Remove(direction);
 	UpdateDirectionUnit();
 }
 
@@ -142,7 +147,6 @@ void Entity::UpdateCurrent(sf::Time dt, CommandQueue& commands)
 
 	if (IsDestroyed())
 	{
-		m_is_marked_for_removal = true;
 		return;
 	}
 
@@ -156,31 +160,34 @@ void Entity::UpdateCurrent(sf::Time dt, CommandQueue& commands)
 	}
 
 	ValidateVelocity();
-	HandleCollisions();
+	Integrate(dt);
 
-	move(m_velocity * dt.asSeconds());
+	if (IsAtRest())
+	{
+		Sleep();
+	}
 }
 
+/// <summary>
+/// Drops the directions that are no longer being held
+/// </summary>
+/// <param name="dt">Delta time</param>
 void Entity::UpdateDirections(sf::Time dt)
 {
-	std::queue<sf::Vector2i> remove_queue;
-
-	for (auto it = m_directions.begin(); it != m_directions.end(); ++it)
+	if (m_directions.Update(dt.asSeconds()))
 	{
-		it->second += dt.asSeconds();
-
-		if (it->second > 0.02f)
-		{
-			remove_queue.emplace(it->first);
-		}
+		UpdateDirectionUnit();
 	}
+}
 
-	while (!remove_queue.empty())
-	{
-		const sf::Vector2i to_remove = remove_queue.front();
-		remove_queue.pop();
-		RemoveDirection(to_remove);
-	}
+/// <summary>
+/// Moves the entity by its velocity, after letting collisions change that velocity
+/// </summary>
+/// <param name="dt">Delta time</param>
+void Entity::Integrate(sf::Time dt)
+{
+	HandleCollisions();
+	move(m_velocity * dt.asSeconds());
 }
 
 /// <summary>
@@ -263,14 +270,15 @@ void Entity::ValidateVelocity()
 /// </summary>
 void Entity::UpdateDirectionUnit()
 {
-	sf::Vector2i new_direction;
-
-	for (const auto& pair : m_directions)
-	{
-		new_direction += pair.first;
-	}
+	m_direction_unit = m_directions.GetUnit();
+}
 
-	m_direction_unit = Utility::UnitVector(new_direction);
+/// <summary>
+/// Nothing would change if it was updated again, so the entity can sleep until something moves or damages it
+/// </summary>
+bool Entity::IsAtRest() const
+{
+	return m_velocity == sf::Vector2f() && m_directions.IsEmpty() && m_gravity == 0.f;
 }
 
 void Entity::OnDamage()
@@ -308,14 +316,30 @@ void Entity::Damage(unsigned int points)
 	}
 
 	OnDamage();
+
+	if (IsDestroyed())
+	{
+		MarkForRemoval();
+	}
+	else
+	{
+		Wake();
+	}
 }
 
 void Entity::Destroy()
 {
 	m_hitpoints = 0;
+	MarkForRemoval();
 }
 
 bool Entity::IsDestroyed() const
 {
 	return m_hitpoints <= 0;
 }
+
+//Moving only changes the entity itself, derived entities that reach other nodes must say otherwise
+bool Entity::CanUpdateConcurrently() const
+{
+	return true;
+}
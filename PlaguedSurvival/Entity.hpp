@@ -1,9 +1,7 @@
 #pragma once
-#include <unordered_map>
-
 #include "CommandQueue.hpp"
+#include "HeldDirections.hpp"
 #include "SceneNode.hpp"
-#include "Vector2iHash.hpp"
 
 /**
  * Vilandas Morrissey - D00218436
@@ -40,6 +38,7 @@ public:
 	virtual void Destroy();
 	void SetGravity(float gravity);
 	bool IsDestroyed() const override;
+	bool CanUpdateConcurrently() const override;
 
 protected:
 	void UpdateCurrent(sf::Time dt, CommandQueue& commands) override;
@@ -48,10 +47,12 @@ protected:
 	virtual void Accelerate(sf::Time dt);
 	virtual void Decelerate(sf::Time dt);
 	virtual void ApplyGravity(sf::Time dt);
+	virtual void Integrate(sf::Time dt);
 	virtual void ValidateVelocity();
 	virtual void UpdateDirectionUnit();
 
 private:
+	bool IsAtRest() const;
 	virtual void OnDamage();
 
 private:
@@ -61,10 +62,8 @@ private:
 	float m_deceleration;
 	float m_gravity;
 	sf::Vector2f m_velocity;
-	std::unordered_map<sf::Vector2i, float, Vector2iHash> m_directions;
+	HeldDirections m_directions;
 	sf::Vector2f m_direction_unit;
 	float m_delta_time_in_seconds;
-
-	bool m_is_marked_for_removal;
 	int m_identifier;
 };
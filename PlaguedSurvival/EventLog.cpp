@@ -0,0 +1,270 @@
+#include "EventLog.hpp"
+
+#include <algorithm>
+#include <istream>
+#include <ostream>
+#include <SFML/System/Sleep.hpp>
+
+/**
+ * Vilandas Morrissey - D00218436
+ */
+
+namespace
+{
+	const char FileMagic[4] = { 'P', 'S', 'E', 'L' };
+	const sf::Uint8 FileVersion = 1;
+
+	//Records are written once a block fills or has waited this long, so a crash loses at most a second
+	const std::size_t BlockRecords = 4096;
+	const sf::Time BlockInterval = sf::seconds(1.f);
+	const sf::Time DrainInterval = sf::milliseconds(20);
+
+	const char* EventNames[] = { "records_dropped", "connection_accepted", "peer_ready", "peer_dropped", "join",
+		"session_suspended", "session_resumed", "session_expired", "match_started", "match_won", "player_died" };
+
+	void WriteVarint(sf::Uint64 value, std::vector<sf::Uint8>& out)
+	{
+		while (value >= 0x80)
+		{
+			out.emplace_back(static_cast<sf::Uint8>(value | 0x80));
+			value >>= 7;
+		}
+		out.emplace_back(static_cast<sf::Uint8>(value));
+	}
+
+	bool ReadVarint(std::istream& input, sf::Uint64& value)
+	{
+		value = 0;
+		for (int shift = 0; shift < 64; shift += 7)
+		{
+			const int byte = input.get();
+			if (byte == std::char_traits<char>::eof())
+			{
+				return false;
+			}
+
+			value |= static_cast<sf::Uint64>(byte & 0x7F) << shift;
+			if ((byte & 0x80) == 0)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	sf::Uint64 ZigZag(sf::Int64 value)
+	{
+		return (static_cast<sf::Uint64>(value) << 1) ^ static_cast<sf::Uint64>(value >> 63);
+	}
+
+	sf::Int64 UnZigZag(sf::Uint64 value)
+	{
+		return static_cast<sf::Int64>(value >> 1) ^ -static_cast<sf::Int64>(value & 1);
+	}
+}
+
+EventLog::Channel::Channel(const EventLog& log, sf::Uint16 index, std::size_t capacity)
+	: m_log(log)
+	, m_index(index)
+	, m_records(capacity)
+	, m_dropped(0)
+	, m_reported_dropped(0)
+{
+}
+
+/// <summary>
+/// Only to be called from the thread the channel belongs to. The meaning of the values depends on the type.
+/// </summary>
+void EventLog::Channel::Log(EventType type, sf::Uint32 peer, sf::Uint64 a, sf::Uint64 b)
+{
+	Record record;
+	record.m_time = m_log.Now();
+	record.m_type = type;
+	record.m_channel = m_index;
+	record.m_peer = peer;
+	record.m_a = a;
+	record.m_b = b;
+
+	if (!m_records.Push(record))
+	{
+		m_dropped.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+EventLog::EventLog(const std::string& filename)
+	: m_file(filename, std::ios::out | std::ios::binary)
+	, m_thread(&EventLog::FlushThread, this)
+	, m_quit(false)
+	, m_started(false)
+	, m_last_time(0)
+{
+	m_file.write(FileMagic, sizeof(FileMagic));
+	m_file.put(static_cast<char>(FileVersion));
+}
+
+EventLog::~EventLog()
+{
+	m_quit = true;
+	if (m_started)
+	{
+		m_thread.wait();
+	}
+}
+
+/// <summary>
+/// Channels have to be added before Start, the flush thread reads the list without a lock
+/// </summary>
+EventLog::Channel& EventLog::AddChannel(std::size_t capacity)
+{
+	m_channels.emplace_back(new Channel(*this, static_cast<sf::Uint16>(m_channels.size()), capacity));
+	return *m_channels.back();
+}
+
+void EventLog::Start()
+{
+	if (!m_started && m_file.is_open())
+	{
+		m_started = true;
+		m_thread.launch();
+	}
+}
+
+sf::Int64 EventLog::Now() const
+{
+	return m_clock.getElapsedTime().asMicroseconds();
+}
+
+void EventLog::FlushThread()
+{
+	sf::Clock block_clock;
+
+	while (!m_quit)
+	{
+		sf::sleep(DrainInterval);
+		Drain();
+
+		if (m_block.size() >= BlockRecords || (!m_block.empty() && block_clock.getElapsedTime() >= BlockInterval))
+		{
+			WriteBlock();
+			block_clock.restart();
+		}
+	}
+
+	//Whatever was logged during shutdown
+	Drain();
+	WriteBlock();
+	m_file.flush();
+}
+
+void EventLog::Drain()
+{
+	Record record;
+	for (std::unique_ptr<Channel>& channel : m_channels)
+	{
+		while (channel->m_records.Pop(record))
+		{
+			m_block.emplace_back(record);
+		}
+
+		const sf::Uint64 dropped = channel->m_dropped.load(std::memory_order_relaxed);
+		if (dropped != channel->m_reported_dropped)
+		{
+			record.m_time = Now();
+			record.m_type = EventType::kRecordsDropped;
+			record.m_channel = channel->m_index;
+			record.m_peer = 0;
+			record.m_a = dropped - channel->m_reported_dropped;
+			record.m_b = 0;
+			m_block.emplace_back(record);
+
+			channel->m_reported_dropped = dropped;
+		}
+	}
+}
+
+/// <summary>
+/// A block is its record count followed by the records as varints, each time stored as the change from the
+/// record before. Sorting first keeps those changes small and positive, the zigzag covers a record that
+/// was logged just before an earlier block was drained.
+/// </summary>
+void EventLog::WriteBlock()
+{
+	if (m_block.empty())
+	{
+		return;
+	}
+
+	std::stable_sort(m_block.begin(), m_block.end(), [](const Record& a, const Record& b)
+		{
+			return a.m_time < b.m_time;
+		});
+
+	m_bytes.clear();
+	WriteVarint(m_block.size(), m_bytes);
+
+	for (const Record& record : m_block)
+	{
+		WriteVarint(static_cast<sf::Uint64>(record.m_type), m_bytes);
+		WriteVarint(record.m_channel, m_bytes);
+		WriteVarint(ZigZag(record.m_time - m_last_time), m_bytes);
+		WriteVarint(record.m_peer, m_bytes);
+		WriteVarint(record.m_a, m_bytes);
+		WriteVarint(record.m_b, m_bytes);
+		m_last_time = record.m_time;
+	}
+
+	m_file.write(reinterpret_cast<const char*>(m_bytes.data()), m_bytes.size());
+	m_block.clear();
+}
+
+/// <summary>
+/// Writes a log as CSV, one record per line
+/// </summary>
+/// <returns>False if the input is not an event log or ends part way through a block</returns>
+bool EventLog::Decode(std::istream& input, std::ostream& output)
+{
+	char magic[sizeof(FileMagic)];
+	input.read(magic, sizeof(magic));
+	const int version = input.get();
+	if (!input || !std::equal(magic, magic + sizeof(magic), FileMagic) || version != FileVersion)
+	{
+		return false;
+	}
+
+	output << "time_us,channel,event,peer,a,b\n";
+
+	sf::Int64 time = 0;
+	sf::Uint64 count;
+	while (ReadVarint(input, count))
+	{
+		for (sf::Uint64 i = 0; i < count; ++i)
+		{
+			sf::Uint64 type;
+			sf::Uint64 channel;
+			sf::Uint64 delta;
+			sf::Uint64 peer;
+			sf::Uint64 a;
+			sf::Uint64 b;
+			if (!ReadVarint(input, type) || !ReadVarint(input, channel) || !ReadVarint(input, delta) ||
+				!ReadVarint(input, peer) || !ReadVarint(input, a) || !ReadVarint(input, b))
+			{
+				return false;
+			}
+
+			time += UnZigZag(delta);
+
+			output << time << ',' << channel << ',';
+			if (type < static_cast<sf::Uint64>(EventType::kEventTypeCount))
+			{
+				output << EventNames[type];
+			}
+			else
+			{
+				output << type;
+			}
+			output << ',' << peer << ',' << a << ',' << b << '\n';
+		}
+	}
+
+	return true;
+}
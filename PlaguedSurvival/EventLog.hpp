@@ -0,0 +1,99 @@
+#pragma once
+#include <atomic>
+#include <fstream>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+#include <SFML/Config.hpp>
+#include <SFML/System/Clock.hpp>
+#include <SFML/System/Thread.hpp>
+
+#include "SpscQueue.hpp"
+
+/**
+ * Vilandas Morrissey - D00218436
+ */
+
+/// <summary>
+/// Binary log of server events. Every thread that logs gets its own channel, a lock-free ring of
+/// fixed-size records, so logging is a clock read and a copy with no locks, allocation or formatting.
+/// A background thread drains the channels, sorts the records by time and writes them in blocks,
+/// packed as variable length deltas. A full channel drops records and the drops are logged.
+/// Decode turns a log back into text offline.
+/// </summary>
+class EventLog
+{
+public:
+	//Appended only, the number of each type is stored in the file
+	enum class EventType : sf::Uint16
+	{
+		kRecordsDropped,
+		kConnectionAccepted,
+		kPeerReady,
+		kPeerDropped,
+		kJoin,
+		kSessionSuspended,
+		kSessionResumed,
+		kSessionExpired,
+		kMatchStarted,
+		kMatchWon,
+		kPlayerDied,
+		kEventTypeCount
+	};
+
+	struct Record
+	{
+		sf::Int64 m_time;
+		EventType m_type;
+		sf::Uint16 m_channel;
+		sf::Uint32 m_peer;
+		sf::Uint64 m_a;
+		sf::Uint64 m_b;
+	};
+
+	class Channel
+	{
+	public:
+		Channel(const EventLog& log, sf::Uint16 index, std::size_t capacity);
+		void Log(EventType type, sf::Uint32 peer = 0, sf::Uint64 a = 0, sf::Uint64 b = 0);
+
+	private:
+		friend class EventLog;
+
+		const EventLog& m_log;
+		sf::Uint16 m_index;
+		SpscQueue<Record> m_records;
+		std::atomic<sf::Uint64> m_dropped;
+		sf::Uint64 m_reported_dropped;
+	};
+
+public:
+	explicit EventLog(const std::string& filename);
+	~EventLog();
+
+	Channel& AddChannel(std::size_t capacity);
+	void Start();
+
+	static bool Decode(std::istream& input, std::ostream& output);
+
+private:
+	sf::Int64 Now() const;
+	void FlushThread();
+	void Drain();
+	void WriteBlock();
+
+private:
+	sf::Clock m_clock;
+	std::ofstream m_file;
+	//Channels are added before Start and never removed
+	std::vector<std::unique_ptr<Channel>> m_channels;
+	sf::Thread m_thread;
+	std::atomic<bool> m_quit;
+	bool m_started;
+
+	//Flush thread only
+	std::vector<Record> m_block;
+	std::vector<sf::Uint8> m_bytes;
+	sf::Int64 m_last_time;
+};
@@ -1,12 +1,18 @@
 #include "GameServer.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <random>
 #include <iostream>
+#include <thread>
 
 #include "NetworkProtocol.hpp"
 #include <SFML/System.hpp>
 
 #include <SFML/Network/Packet.hpp>
 
+#include "PacketFraming.hpp"
 #include "PlayerAction.hpp"
 #include "Utility.hpp"
 #include "WorldInfo.hpp"
@@ -15,162 +21,923 @@
  * Vilandas Morrissey - D00218436
  */
 
-GameServer::RemotePeer::RemotePeer() :m_ready(false), m_timed_out(false)
+namespace
+{
+	const sf::Time StepRate = sf::seconds(1.f / 60.f);
+	const sf::Time DangerRate = sf::seconds(1.f);
+
+	//Matches DangerTrigger's defaults: tiles damaged per second, and how fast that grows
+	const float DangerStartRate = 0.8f;
+	const float DangerRateIncrease = 0.1f;
+
+	//Connections that have not sent Join by then are dropped
+	const sf::Time JoinTimeout = sf::seconds(5.f);
+
+	//Network thread timers only have to be as fine as its 1ms wait allows, timeouts are measured in seconds
+	const sf::Time NetworkTimerResolution = sf::milliseconds(10);
+	const sf::Time StatisticsInterval = sf::seconds(1.f);
+
+	//Client state is broadcast every third step, 20 times a second
+	const std::size_t StepsPerTick = 3;
+
+	//Most packets read from one peer before moving on to the next
+	const std::size_t PacketsPerPeer = 8;
+	const std::size_t MaxDeferredPackets = 64;
+
+	//Bytes read per receive call, and how much may wait in the buffers before a peer is considered stuck
+	const std::size_t ReceiveChunk = 16384;
+	const std::size_t MaxReceiveBuffer = 65536;
+	const std::size_t MaxSendBuffer = 262144;
+
+	//Tokens per second and burst size for each message class. Input frames can arrive every frame for two local players
+	const float ControlRate = 20.f;
+	const float ControlBurst = 40.f;
+	const float RealtimeRate = 120.f;
+	const float RealtimeBurst = 30.f;
+	const float PositionRate = 30.f;
+	const float PositionBurst = 10.f;
+	const float AckRate = 30.f;
+	const float AckBurst = 10.f;
+
+	//Byte frequencies of snapshot payloads, trained from matches played with snapshot logging on
+	const std::string SnapshotModelFile = "snapshot_model.txt";
+
+	const std::string EventLogFile = "server_events.log";
+	const std::size_t EventChannelCapacity = 4096;
+
+	//Step durations in seconds, a step has 16.7ms before it delays the next one
+	const std::vector<double> StepDurationBuckets = { 0.0005, 0.001, 0.002, 0.004, 0.008, 0.0167, 0.033, 0.1 };
+
+	//Names for the metrics labels, in the order of NetworkProtocol.hpp
+	const char* ClientPacketNames[] = { "StillHereUpdate", "RequestStartGame", "PlayerInput", "RequestCoopPartner", "PositionUpdate",
+		"GameEvent", "UpdateGamesWon", "Quit", "Join", "SnapshotAck", "RequestWorldState", "ClockSync" };
+	const char* ServerPacketNames[] = { "BroadcastMessage", "InitialState", "StartGame", "PlayerInput", "PlayerConnect",
+		"PlayerDisconnect", "AcceptCoopPartner", "SpawnSelf", "UpdateClientState", "TileDamage", "GamesWonUpdated",
+		"PlayerDied", "MissionSuccess", "SnapshotModel", "ClockSync" };
+	const char* DisconnectReasonNames[] = { "timeout", "closed", "malformed", "send_overflow", "kicked" };
+
+	template <std::size_t N>
+	std::string PacketTypeLabel(const char* (&names)[N], std::size_t type)
+	{
+		return "type=\"" + (type < N ? std::string(names[type]) : std::to_string(type)) + "\"";
+	}
+}
+
+GameServer::TickStatistics::TickStatistics()
+	: m_steps(0)
+	, m_snapshot_peers(0)
+	, m_snapshot_workers(0)
+	, m_snapshot_raw_bytes(0)
+	, m_snapshot_coded_bytes(0)
+{
+}
+
+GameServer::NetworkStatistics::NetworkStatistics()
+	: m_received(0)
+	, m_deferred(0)
+	, m_dropped(0)
+	, m_receive_calls(0)
+	, m_sent(0)
+	, m_send_calls(0)
+{
+}
+
+GameServer::NetworkMetrics::NetworkMetrics()
+	: m_connections(0)
+	, m_deferred(0)
+	, m_dropped(0)
+{
+	m_packets_in.fill(0);
+	m_bytes_in.fill(0);
+	m_packets_out.fill(0);
+	m_bytes_out.fill(0);
+	m_disconnects.fill(0);
+}
+
+GameServer::SimulationMetrics::SimulationMetrics()
+	: m_players(0)
+	, m_alive_players(0)
+	, m_simulated_players(0)
+	, m_spectators(0)
+	, m_suspended_sessions(0)
+	, m_in_match(false)
+	, m_step_duration(StepDurationBuckets)
+{
+}
+
+GameServer::RemotePeer::RemotePeer(PeerId id)
+	:m_id(id), m_timeout_timer(0), m_receive_offset(0), m_ready(false), m_timed_out(false), m_disconnect_reason(DisconnectReason::kTimeout)
 {
 	m_socket.setBlocking(false);
+
+	m_rate_limits[static_cast<int>(MessageClass::kControl)] = TokenBucket(ControlRate, ControlBurst);
+	m_rate_limits[static_cast<int>(MessageClass::kRealtime)] = TokenBucket(RealtimeRate, RealtimeBurst);
+	m_rate_limits[static_cast<int>(MessageClass::kPosition)] = TokenBucket(PositionRate, PositionBurst);
+	m_rate_limits[static_cast<int>(MessageClass::kAck)] = TokenBucket(AckRate, AckBurst);
 }
 
-GameServer::GameServer()
-	: m_thread(&GameServer::ExecutionThread, this)
+GameServer::GameServer(std::size_t max_connected_players, std::size_t simulated_players, std::size_t simulated_viewers,
+	bool log_snapshots, bool compress_snapshots, unsigned short metrics_port)
+	: m_waiting_thread_end(false)
+	, m_event_log(EventLogFile)
+	, m_network_events(m_event_log.AddChannel(EventChannelCapacity))
+	, m_simulation_events(m_event_log.AddChannel(EventChannelCapacity))
+	, m_inbound(QUEUE_CAPACITY)
+	, m_outbound(QUEUE_CAPACITY)
+	, m_network_thread(&GameServer::NetworkThread, this)
 	, m_listening_state(false)
-	, m_lobby(true)
 	, m_client_timeout(sf::seconds(1.f))
-	, m_max_connected_players(15)
-	, m_connected_players(0)
+	, m_max_connected_players(max_connected_players > simulated_players ? max_connected_players - simulated_players : 1)
+	, m_pending_peer(new RemotePeer(1))
+	, m_next_peer_id(2)
+	, m_next_peer_index(0)
+	, m_network_timers(NetworkTimerResolution)
+	, m_metrics_port(metrics_port)
+	, m_simulation_thread(&GameServer::SimulationThread, this)
+	, m_simulation_timers(StepRate)
+	, m_lobby(true)
+	, m_winner_logged(false)
 	, m_player_count(0)
-	, m_peers(1)
-	, m_waiting_thread_end(false)
+	, m_simulated_players(simulated_players)
+	, m_simulated_viewers(std::min(simulated_viewers, MAX_SIMULATED_VIEWERS))
 	, m_alive_players()
+	, m_dangers_per_second(DangerStartRate)
+	, m_random(std::random_device()())
+	, m_compress_snapshots(compress_snapshots)
+	, m_snapshot_histogram()
+	//The game's main thread and the network thread keep a core each, the simulation thread works alongside the pool
+	, m_jobs(JobSystem::GetDefaultWorkerCount(2))
 {
+	//Without a trained model the coder falls back to its built in one
+	if (RangeModel::LoadHistogram(SnapshotModelFile, m_snapshot_histogram))
+	{
+		m_snapshot_model = RangeModel(m_snapshot_histogram);
+	}
+	else
+	{
+		m_snapshot_histogram.fill(0);
+	}
+
+	if (log_snapshots)
+	{
+		m_snapshot_log.open("snapshot_log.csv", std::fstream::out);
+		m_snapshot_log << "time_ms,peer,sequence,rtt_us,bandwidth,budget,bytes,candidates,sent,highest_skipped,packet_bytes\n";
+	}
+
 	m_listener_socket.setBlocking(false);
-	m_peers[0].reset(new RemotePeer());
-	m_thread.launch();
+	m_event_log.Start();
+	m_network_thread.launch();
+	m_simulation_thread.launch();
 }
 
 GameServer::~GameServer()
 {
 	m_waiting_thread_end = true;
-	m_thread.wait();
+	m_simulation_thread.wait();
+	m_network_thread.wait();
+
+	//The payloads seen while logging are added to the model the next server will use
+	if (m_snapshot_log.is_open())
+	{
+		RangeModel::SaveHistogram(SnapshotModelFile, m_snapshot_histogram);
+	}
 }
 
-//This is the same as SpawnSelf but indicate that a player from a different client is entering the world
+GameServer::TickStatistics GameServer::GetTickStatistics() const
+{
+	sf::Lock lock(m_statistics_mutex);
+	return m_tick_statistics;
+}
 
-void GameServer::NotifyPlayerSpawn(opt::PlayerIdentifier player_identifier)
+GameServer::NetworkStatistics GameServer::GetNetworkStatistics() const
 {
-	sf::Packet packet;
-	//First thing for every packet is what type of packet it is
-	packet << static_cast<opt::ServerPacket>(Server::PacketType::PlayerConnect);
-	packet << player_identifier << m_player_info[player_identifier].m_position.x << m_player_info[player_identifier].m_position.y;
-	for (std::size_t i = 0; i < m_connected_players; ++i)
+	sf::Lock lock(m_statistics_mutex);
+	return m_network_statistics;
+}
+
+sf::Time GameServer::Now() const
+{
+	return m_clock.getElapsedTime();
+}
+
+//Network thread: accepts connections, moves packets between the sockets and the queues and detects timeouts.
+//It never touches game state, so a burst of packets cannot delay the simulation tick.
+
+void GameServer::NetworkThread()
+{
+	SchedulePublishNetworkStatistics();
+
+	if (m_metrics_port != 0 && !m_metrics_endpoint.Listen(m_metrics_port))
+	{
+		std::cout << "Metrics could not listen on port " << m_metrics_port << std::endl;
+	}
+
+	while (!m_waiting_thread_end)
+	{
+		SetListening(m_peers.size() < m_max_connected_players);
+
+		HandleIncomingConnections();
+		HandleOutgoingMessages();
+		FlushInboundOverflow();
+		HandleIncomingPackets();
+		m_network_timers.Advance(Now());
+		HandleDisconnections();
+		m_metrics_endpoint.Serve([this]()
+			{
+				return RenderMetrics();
+			});
+
+		//Wake on socket activity, or every millisecond to flush outgoing messages
+		m_selector.wait(sf::milliseconds(1));
+	}
+
+	//Flush messages queued during shutdown
+	HandleOutgoingMessages();
+}
+
+void GameServer::SetListening(bool enable)
+{
+	//Check if the server listening socket is already listening
+	if (enable)
 	{
-		if (m_peers[i]->m_ready)
+		if (!m_listening_state)
 		{
-			m_peers[i]->m_socket.send(packet);
+			m_listening_state = (m_listener_socket.listen(SERVER_PORT) == sf::TcpListener::Done);
+			if (m_listening_state)
+			{
+				m_selector.add(m_listener_socket);
+			}
 		}
 	}
+	else if (m_listening_state)
+	{
+		m_selector.remove(m_listener_socket);
+		m_listener_socket.close();
+		m_listening_state = false;
+	}
+}
+
+void GameServer::HandleIncomingConnections()
+{
+	if (!m_listening_state)
+	{
+		return;
+	}
+
+	if (m_listener_socket.accept(m_pending_peer->m_socket) == sf::TcpListener::Done)
+	{
+		m_pending_peer->m_last_packet_time = Now();
+		m_selector.add(m_pending_peer->m_socket);
+		ScheduleTimeout(*m_pending_peer);
+		m_network_metrics.m_connections++;
+		m_network_events.Log(EventLog::EventType::kConnectionAccepted, m_pending_peer->m_id);
+
+		m_peers.emplace_back(std::move(m_pending_peer));
+		m_pending_peer.reset(new RemotePeer(m_next_peer_id++));
+	}
 }
 
-//This is the same as PlayerEvent, but for real-time actions. This means that we are changing an ongoing state to either true or false, so we add a Boolean value to the parameters
+void GameServer::HandleIncomingPackets()
+{
+	//Start with a different peer each loop so a busy peer cannot always be served first
+	for (std::size_t i = 0; i < m_peers.size(); ++i)
+	{
+		RemotePeer& peer = *m_peers[(m_next_peer_index + i) % m_peers.size()];
+		ReceiveFromPeer(peer);
+	}
+
+	m_next_peer_index++;
+}
 
-void GameServer::NotifyPlayerRealtimeChange(opt::PlayerIdentifier player_identifier, opt::Action action, bool action_enabled)
+/// <summary>
+/// Packets only move m_last_packet_time, so a busy peer costs nothing here. When the timer comes due
+/// it is either really timed out or is scheduled again for its new deadline.
+/// </summary>
+void GameServer::ScheduleTimeout(RemotePeer& peer)
 {
+	const sf::Time deadline = peer.m_last_packet_time + (peer.m_ready ? m_client_timeout : JoinTimeout);
+	peer.m_timeout_timer = m_network_timers.Schedule(deadline, [this, &peer]()
+		{
+			CheckTimeout(peer);
+		});
+}
+
+void GameServer::CheckTimeout(RemotePeer& peer)
+{
+	if (Now() > peer.m_last_packet_time + (peer.m_ready ? m_client_timeout : JoinTimeout))
+	{
+		DropPeer(peer, DisconnectReason::kTimeout);
+	}
+	else
+	{
+		ScheduleTimeout(peer);
+	}
+}
+
+void GameServer::ReceiveFromPeer(RemotePeer& peer)
+{
+	std::size_t budget = PacketsPerPeer;
+
+	//Packets held back by the rate limiter go first so their order is kept
+	while (budget > 0 && !peer.m_deferred.empty() && HasInboundRoom())
+	{
+		const MessageClass message_class = ClassifyPacket(peer.m_deferred.front());
+		if (!peer.m_rate_limits[static_cast<int>(message_class)].TryConsume(Now()))
+		{
+			break;
+		}
+
+		PushInbound(InboundMessage::Type::kPacket, peer.m_id, peer.m_deferred.front());
+		peer.m_deferred.pop_front();
+		budget--;
+	}
+
+	//If the simulation thread is behind, leave the data in the buffer or the socket rather than dropping it.
+	//Whatever is already buffered goes first, then one read picks up everything the socket has for this pass
 	sf::Packet packet;
-	//First thing for every packet is what type of packet it is
-	packet << static_cast<opt::ServerPacket>(Server::PacketType::PlayerRealtimeChange);
-	packet << player_identifier;
-	packet << action;
-	packet << action_enabled;
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		while (budget > 0 && HasInboundRoom() && ExtractPacket(peer, packet))
+		{
+			peer.m_last_packet_time = Now();
+			m_network_window.m_received++;
+			budget--;
+
+			AdmitPacket(peer, packet);
+		}
+
+		if (pass > 0 || budget == 0 || !HasInboundRoom() || !m_selector.isReady(peer.m_socket))
+		{
+			break;
+		}
+
+		ReadSocket(peer);
+	}
+
+	peer.m_receive_buffer.erase(peer.m_receive_buffer.begin(), peer.m_receive_buffer.begin() + peer.m_receive_offset);
+	peer.m_receive_offset = 0;
+}
+
+/// <summary>
+/// One receive call for as much as the socket has, instead of two or more calls for every packet.
+/// </summary>
+void GameServer::ReadSocket(RemotePeer& peer)
+{
+	std::vector<char>& buffer = peer.m_receive_buffer;
+	if (buffer.size() >= MaxReceiveBuffer)
+	{
+		return;
+	}
+
+	const std::size_t old_size = buffer.size();
+	buffer.resize(old_size + ReceiveChunk);
+
+	std::size_t received = 0;
+	const sf::Socket::Status status = peer.m_socket.receive(buffer.data() + old_size, ReceiveChunk, received);
+	buffer.resize(old_size + received);
+
+	m_network_window.m_receive_calls++;
+
+	//Otherwise the selector keeps waking for the closed socket until the timeout
+	if (status == sf::Socket::Disconnected || status == sf::Socket::Error)
+	{
+		DropPeer(peer, DisconnectReason::kClosed);
+	}
+}
+
+bool GameServer::ExtractPacket(RemotePeer& peer, sf::Packet& packet)
+{
+	switch (PacketFraming::Extract(peer.m_receive_buffer, peer.m_receive_offset, packet))
+	{
+	case PacketFraming::Result::kPacket:
+		if (packet.getDataSize() > 0)
+		{
+			const std::size_t type = static_cast<const sf::Uint8*>(packet.getData())[0];
+			m_network_metrics.m_packets_in[type]++;
+			m_network_metrics.m_bytes_in[type] += packet.getDataSize();
+		}
+		return true;
+
+	case PacketFraming::Result::kMalformed:
+		//The stream cannot be trusted after this
+		DropPeer(peer, DisconnectReason::kMalformed);
+		return false;
+
+	default:
+		return false;
+	}
+}
+
+void GameServer::AdmitPacket(RemotePeer& peer, const sf::Packet& packet)
+{
+	const MessageClass message_class = ClassifyPacket(packet);
+	TokenBucket& rate_limit = peer.m_rate_limits[static_cast<int>(message_class)];
 
-	for (std::size_t i = 0; i < m_connected_players; ++i)
+	//Positions and acks are superseded by the next one, so one over the limit is dropped
+	if (message_class == MessageClass::kPosition || message_class == MessageClass::kAck)
 	{
-		if (m_peers[i]->m_ready)
+		if (rate_limit.TryConsume(Now()))
+		{
+			if (!AnswerClockSync(peer, packet))
+			{
+				PushInbound(InboundMessage::Type::kPacket, peer.m_id, packet);
+			}
+		}
+		else
 		{
-			m_peers[i]->m_socket.send(packet);
+			m_network_window.m_dropped++;
+			m_network_metrics.m_dropped++;
 		}
+		return;
+	}
+
+	if (peer.m_deferred.empty() && rate_limit.TryConsume(Now()))
+	{
+		PushInbound(InboundMessage::Type::kPacket, peer.m_id, packet);
+	}
+	else if (peer.m_deferred.size() < MaxDeferredPackets)
+	{
+		peer.m_deferred.emplace_back(packet);
+		m_network_window.m_deferred++;
+		m_network_metrics.m_deferred++;
+	}
+	else
+	{
+		m_network_window.m_dropped++;
+		m_network_metrics.m_dropped++;
+	}
+}
+
+GameServer::MessageClass GameServer::ClassifyPacket(const sf::Packet& packet)
+{
+	if (packet.getDataSize() == 0)
+	{
+		return MessageClass::kControl;
+	}
+
+	//The first byte of every client packet is its type
+	switch (static_cast<Client::PacketType>(static_cast<const opt::ClientPacket*>(packet.getData())[0]))
+	{
+	case Client::PacketType::PlayerInput:
+		return MessageClass::kRealtime;
+
+	case Client::PacketType::PositionUpdate:
+		return MessageClass::kPosition;
+
+	case Client::PacketType::SnapshotAck:
+	case Client::PacketType::ClockSync:
+		return MessageClass::kAck;
+
+	default:
+		return MessageClass::kControl;
 	}
 }
 
-//This takes two sf::Int32 variables, the player identifier and the action identifier
-//as declared in the Player class. This is used to inform all peers that plane X has
-//triggered an action
+void GameServer::SchedulePublishNetworkStatistics()
+{
+	m_network_timers.Schedule(Now() + StatisticsInterval, [this]()
+		{
+			PublishNetworkStatistics();
+			SchedulePublishNetworkStatistics();
+		});
+}
 
-void GameServer::NotifyPlayerEvent(opt::PlayerIdentifier player_identifier, opt::Action action)
+/// <summary>
+/// Answered on the network thread, a trip through the simulation thread would add its queueing to the round trip
+/// the client measures. The reply carries the client's send time back with the server's clock.
+/// </summary>
+/// <returns>False if the packet is not a ClockSync</returns>
+bool GameServer::AnswerClockSync(RemotePeer& peer, const sf::Packet& packet)
 {
-	sf::Packet packet;
-	//First thing for every packet is what type of packet it is
-	packet << static_cast<opt::ServerPacket>(Server::PacketType::PlayerEvent);
-	packet << player_identifier;
-	packet << action;
+	if (static_cast<Client::PacketType>(static_cast<const opt::ClientPacket*>(packet.getData())[0]) != Client::PacketType::ClockSync)
+	{
+		return false;
+	}
 
-	for (std::size_t i = 0; i < m_connected_players; ++i)
+	sf::Packet request = packet;
+	opt::ClientPacket packet_type;
+	sf::Int64 client_time;
+	request >> packet_type >> client_time;
+
+	if (request)
+	{
+		sf::Packet reply;
+		reply << static_cast<opt::ServerPacket>(Server::PacketType::ClockSync) << client_time << Now().asMicroseconds();
+		QueuePacket(peer, reply);
+	}
+	return true;
+}
+
+void GameServer::PublishNetworkStatistics()
+{
+	sf::Lock lock(m_statistics_mutex);
+	m_network_statistics = m_network_window;
+	m_network_window = NetworkStatistics();
+}
+
+//Everything queued for a peer since the last pass goes out in a single send, so a broadcast
+//costs one call per peer per pass rather than one per packet
+
+void GameServer::HandleOutgoingMessages()
+{
+	OutboundMessage message;
+	while (m_outbound.Pop(message))
 	{
-		if (m_peers[i]->m_ready)
+		switch (message.m_type)
 		{
-			m_peers[i]->m_socket.send(packet);
+		case OutboundMessage::Type::kPacket:
+			if (message.m_peer == ALL_PEERS)
+			{
+				for (PeerPtr& peer : m_peers)
+				{
+					if (peer->m_ready && peer->m_id != message.m_exclude)
+					{
+						QueuePacket(*peer, message.m_packet);
+					}
+				}
+			}
+			else if (RemotePeer* peer = FindPeer(message.m_peer))
+			{
+				QueuePacket(*peer, message.m_packet);
+			}
+			break;
+
+		case OutboundMessage::Type::kReady:
+			if (RemotePeer* peer = FindPeer(message.m_peer))
+			{
+				peer->m_ready = true;
+				peer->m_last_packet_time = Now();
+				m_network_events.Log(EventLog::EventType::kPeerReady, peer->m_id);
+
+				//The deadline shrinks from the join timeout to the client timeout
+				m_network_timers.Cancel(peer->m_timeout_timer);
+				ScheduleTimeout(*peer);
+			}
+			break;
+
+		case OutboundMessage::Type::kKick:
+			if (RemotePeer* peer = FindPeer(message.m_peer))
+			{
+				DropPeer(*peer, DisconnectReason::kKicked);
+			}
+			break;
 		}
 	}
+
+	for (PeerPtr& peer : m_peers)
+	{
+		FlushPeer(*peer);
+	}
 }
 
-void GameServer::SetListening(bool enable)
+void GameServer::QueuePacket(RemotePeer& peer, const sf::Packet& packet)
 {
-	//Check if the server listening socket is already listening
-	if (enable)
+	PacketFraming::Append(packet, peer.m_send_buffer);
+	m_network_window.m_sent++;
+
+	if (packet.getDataSize() > 0)
 	{
-		if (!m_listening_state)
+		const std::size_t type = static_cast<const sf::Uint8*>(packet.getData())[0];
+		m_network_metrics.m_packets_out[type]++;
+		m_network_metrics.m_bytes_out[type] += packet.getDataSize();
+	}
+}
+
+/// <summary>
+/// Sends what the socket will take. The rest is kept for the next pass, so a partial send
+/// no longer cuts a packet in half, and a peer that stops reading is eventually dropped.
+/// </summary>
+void GameServer::FlushPeer(RemotePeer& peer)
+{
+	if (peer.m_send_buffer.empty())
+	{
+		return;
+	}
+
+	std::size_t sent = 0;
+	const sf::Socket::Status status = peer.m_socket.send(peer.m_send_buffer.data(), peer.m_send_buffer.size(), sent);
+	peer.m_send_buffer.erase(peer.m_send_buffer.begin(), peer.m_send_buffer.begin() + sent);
+
+	m_network_window.m_send_calls++;
+
+	if (status == sf::Socket::Disconnected || status == sf::Socket::Error)
+	{
+		DropPeer(peer, DisconnectReason::kClosed);
+	}
+	else if (peer.m_send_buffer.size() > MaxSendBuffer)
+	{
+		DropPeer(peer, DisconnectReason::kSendOverflow);
+	}
+}
+
+void GameServer::HandleDisconnections()
+{
+	for (auto itr = m_peers.begin(); itr != m_peers.end();)
+	{
+		if ((*itr)->m_timed_out)
 		{
-			m_listening_state = (m_listener_socket.listen(SERVER_PORT) == sf::TcpListener::Done);
+			m_network_timers.Cancel((*itr)->m_timeout_timer);
+			m_network_metrics.m_disconnects[static_cast<int>((*itr)->m_disconnect_reason)]++;
+			m_network_events.Log(EventLog::EventType::kPeerDropped, (*itr)->m_id, static_cast<sf::Uint64>((*itr)->m_disconnect_reason));
+			m_selector.remove((*itr)->m_socket);
+			PushInbound(InboundMessage::Type::kDisconnect, (*itr)->m_id);
+			itr = m_peers.erase(itr);
+		}
+		else
+		{
+			++itr;
 		}
 	}
-	else
+}
+
+//The first reason is the one counted, a peer often fails in several ways once its connection is gone
+
+void GameServer::DropPeer(RemotePeer& peer, DisconnectReason reason)
+{
+	if (!peer.m_timed_out)
 	{
-		m_listener_socket.close();
-		m_listening_state = false;
+		peer.m_timed_out = true;
+		peer.m_disconnect_reason = reason;
 	}
 }
 
-void GameServer::ExecutionThread()
+/// <summary>
+/// The metrics page in the Prometheus text format. Connection and traffic figures are the network thread's own,
+/// game figures are the last copy published by the simulation thread.
+/// </summary>
+std::string GameServer::RenderMetrics() const
 {
-	SetListening(true);
+	SimulationMetrics simulation;
+	{
+		sf::Lock lock(m_statistics_mutex);
+		simulation = m_published_simulation_metrics;
+	}
 
-	sf::Time frame_rate = sf::seconds(1.f / 60.f);
-	sf::Time frame_time = sf::Time::Zero;
-	sf::Time tick_rate = sf::seconds(1.f / 20.f);
-	sf::Time tick_time = sf::Time::Zero;
-	sf::Time danger_rate = sf::seconds(1.f);
-	sf::Time danger_time = sf::Time::Zero;
-	sf::Clock frame_clock, tick_clock, danger_clock;
+	std::size_t ready_peers = 0;
+	std::size_t send_buffer_bytes = 0;
+	std::size_t largest_send_buffer = 0;
+	std::size_t deferred_packets = 0;
+	for (const PeerPtr& peer : m_peers)
+	{
+		ready_peers += peer->m_ready ? 1 : 0;
+		send_buffer_bytes += peer->m_send_buffer.size();
+		largest_send_buffer = std::max(largest_send_buffer, peer->m_send_buffer.size());
+		deferred_packets += peer->m_deferred.size();
+	}
 
-	while (!m_waiting_thread_end)
+	MetricsText text;
+
+	text.Describe("plagued_connected_peers", "gauge", "Open connections, including ones that have not joined yet.");
+	text.Sample("plagued_connected_peers", static_cast<double>(m_peers.size()));
+	text.Describe("plagued_ready_peers", "gauge", "Connections that have joined and are sent the game.");
+	text.Sample("plagued_ready_peers", static_cast<double>(ready_peers));
+	text.Describe("plagued_connections_total", "counter", "Connections accepted.");
+	text.Sample("plagued_connections_total", static_cast<double>(m_network_metrics.m_connections));
+
+	text.Describe("plagued_disconnects_total", "counter", "Connections dropped by the server, by reason.");
+	for (std::size_t i = 0; i < m_network_metrics.m_disconnects.size(); ++i)
 	{
-		HandleIncomingConnections();
-		HandleIncomingPackets();
+		text.Sample("plagued_disconnects_total", static_cast<double>(m_network_metrics.m_disconnects[i]),
+			"reason=\"" + std::string(DisconnectReasonNames[i]) + "\"");
+	}
+
+	//A server hosts a single room
+	text.Describe("plagued_players", "gauge", "Players in the room, including simulated players.");
+	text.Sample("plagued_players", static_cast<double>(simulation.m_players));
+	text.Describe("plagued_alive_players", "gauge", "Players still alive in the current match.");
+	text.Sample("plagued_alive_players", static_cast<double>(simulation.m_alive_players));
+	text.Describe("plagued_simulated_players", "gauge", "Players moved by the server for load testing.");
+	text.Sample("plagued_simulated_players", static_cast<double>(simulation.m_simulated_players));
+	text.Describe("plagued_spectators", "gauge", "Read only connections such as spectator relays.");
+	text.Sample("plagued_spectators", static_cast<double>(simulation.m_spectators));
+	text.Describe("plagued_suspended_sessions", "gauge", "Dropped clients whose players are held for them to resume.");
+	text.Sample("plagued_suspended_sessions", static_cast<double>(simulation.m_suspended_sessions));
+	text.Describe("plagued_in_match", "gauge", "1 during a match, 0 in the lobby.");
+	text.Sample("plagued_in_match", simulation.m_in_match ? 1.0 : 0.0);
+
+	text.Histogram("plagued_step_duration_seconds", "Time spent on each simulation step.", simulation.m_step_duration);
+
+	text.Describe("plagued_packets_received_total", "counter", "Packets received from clients, by type.");
+	for (std::size_t type = 0; type < m_network_metrics.m_packets_in.size(); ++type)
+	{
+		if (m_network_metrics.m_packets_in[type] > 0)
+		{
+			text.Sample("plagued_packets_received_total", static_cast<double>(m_network_metrics.m_packets_in[type]), PacketTypeLabel(ClientPacketNames, type));
+		}
+	}
 
-		frame_time += frame_clock.getElapsedTime();
-		frame_clock.restart();
+	text.Describe("plagued_received_bytes_total", "counter", "Packet bytes received from clients, by type, without framing.");
+	for (std::size_t type = 0; type < m_network_metrics.m_bytes_in.size(); ++type)
+	{
+		if (m_network_metrics.m_packets_in[type] > 0)
+		{
+			text.Sample("plagued_received_bytes_total", static_cast<double>(m_network_metrics.m_bytes_in[type]), PacketTypeLabel(ClientPacketNames, type));
+		}
+	}
 
-		tick_time += tick_clock.getElapsedTime();
-		tick_clock.restart();
+	text.Describe("plagued_packets_sent_total", "counter", "Packets queued to clients, by type. A broadcast counts once per client.");
+	for (std::size_t type = 0; type < m_network_metrics.m_packets_out.size(); ++type)
+	{
+		if (m_network_metrics.m_packets_out[type] > 0)
+		{
+			text.Sample("plagued_packets_sent_total", static_cast<double>(m_network_metrics.m_packets_out[type]), PacketTypeLabel(ServerPacketNames, type));
+		}
+	}
 
-		//Fixed update step
-		while (frame_time >= frame_rate)
+	text.Describe("plagued_sent_bytes_total", "counter", "Packet bytes queued to clients, by type, without framing.");
+	for (std::size_t type = 0; type < m_network_metrics.m_bytes_out.size(); ++type)
+	{
+		if (m_network_metrics.m_packets_out[type] > 0)
 		{
-			frame_time -= frame_rate;
+			text.Sample("plagued_sent_bytes_total", static_cast<double>(m_network_metrics.m_bytes_out[type]), PacketTypeLabel(ServerPacketNames, type));
 		}
+	}
+
+	text.Describe("plagued_rate_limited_packets_total", "counter", "Packets over a client's rate limit, held back or dropped.");
+	text.Sample("plagued_rate_limited_packets_total", static_cast<double>(m_network_metrics.m_deferred), "action=\"deferred\"");
+	text.Sample("plagued_rate_limited_packets_total", static_cast<double>(m_network_metrics.m_dropped), "action=\"dropped\"");
+
+	text.Describe("plagued_send_buffer_bytes", "gauge", "Bytes waiting to be sent, over all connections.");
+	text.Sample("plagued_send_buffer_bytes", static_cast<double>(send_buffer_bytes));
+	text.Describe("plagued_send_buffer_max_bytes", "gauge", "Bytes waiting to be sent to the most backed up connection.");
+	text.Sample("plagued_send_buffer_max_bytes", static_cast<double>(largest_send_buffer));
+	text.Describe("plagued_deferred_packets", "gauge", "Received packets held back by rate limits.");
+	text.Sample("plagued_deferred_packets", static_cast<double>(deferred_packets));
+	text.Describe("plagued_queue_depth", "gauge", "Messages waiting between the network and simulation threads.");
+	text.Sample("plagued_queue_depth", static_cast<double>(m_inbound.Size()), "queue=\"inbound\"");
+	text.Sample("plagued_queue_depth", static_cast<double>(m_outbound.Size()), "queue=\"outbound\"");
+	text.Sample("plagued_queue_depth", static_cast<double>(m_inbound_overflow.size()), "queue=\"inbound_overflow\"");
+
+	return text.GetText();
+}
 
-		//Fixed tick step
-		while (tick_time >= tick_rate)
+GameServer::RemotePeer* GameServer::FindPeer(PeerId peer)
+{
+	for (PeerPtr& remote_peer : m_peers)
+	{
+		if (remote_peer->m_id == peer)
 		{
-			Tick();
-			tick_time -= tick_rate;
+			return remote_peer.get();
 		}
+	}
+	return nullptr;
+}
+
+//Packets are left in the sockets while the simulation thread is behind, so the overflow only holds a few
+//packets and the disconnections found while the queue was full
+
+bool GameServer::HasInboundRoom() const
+{
+	return m_inbound_overflow.empty() && !m_inbound.IsFull();
+}
+
+void GameServer::PushInbound(InboundMessage::Type type, PeerId peer, const sf::Packet& packet)
+{
+	InboundMessage message;
+	message.m_type = type;
+	message.m_peer = peer;
+	message.m_packet = packet;
+	message.m_received_time = Now();
+
+	//Connection events must not be lost, they wait in the overflow instead of the thread waiting
+	if (!m_inbound_overflow.empty() || !m_inbound.Push(message))
+	{
+		m_inbound_overflow.emplace_back(std::move(message));
+	}
+}
+
+void GameServer::FlushInboundOverflow()
+{
+	while (!m_inbound_overflow.empty() && m_inbound.Push(m_inbound_overflow.front()))
+	{
+		m_inbound_overflow.pop_front();
+	}
+}
+
+//Simulation thread: owns all game state and runs on a fixed step, independent of network traffic.
+
+void GameServer::SimulationThread()
+{
+	std::size_t step = 0;
+	sf::Time next_step = Now();
+
+	AddSimulatedPlayers();
+
+	while (!m_waiting_thread_end)
+	{
+		WaitUntil(next_step);
+
+		const sf::Time step_start = Now();
+		FlushOutboundOverflow();
+		HandleInboundMessages();
+		const sf::Time inbound_end = Now();
 
 		if (!m_lobby)
 		{
-			danger_time += danger_clock.getElapsedTime();
-			danger_clock.restart();
+			MoveSimulatedPlayers();
+		}
 
-			if (danger_time >= danger_rate)
-			{
-				UpdateDangers(danger_time);
-				danger_time = sf::Time::Zero;
-			}
+		//Dangers and session expiry
+		m_simulation_time += StepRate;
+		m_simulation_timers.Advance(m_simulation_time);
+		const sf::Time simulation_end = Now();
+
+		if (step % StepsPerTick == 0)
+		{
+			Tick();
+		}
+		const sf::Time broadcast_end = Now();
+
+		RecordStep(step_start - next_step, inbound_end - step_start, simulation_end - inbound_end, broadcast_end - simulation_end);
+
+		++step;
+		next_step += StepRate;
+
+		//If the thread was stalled for several steps, resynchronise instead of running a burst of catch-up steps
+		if (Now() > next_step + StepRate * 4.f)
+		{
+			next_step = Now();
 		}
+	}
+}
+
+/// <summary>
+/// Sleep until shortly before the deadline, then yield until it is reached.
+/// sf::sleep alone can overshoot by a scheduler quantum, which would show up as tick jitter.
+/// </summary>
+/// <param name="time">Server time to wake at</param>
+void GameServer::WaitUntil(sf::Time time) const
+{
+	const sf::Time spin_threshold = sf::milliseconds(2);
+
+	while (Now() < time && !m_waiting_thread_end)
+	{
+		const sf::Time remaining = time - Now();
+		if (remaining > spin_threshold)
+		{
+			sf::sleep(remaining - spin_threshold);
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+void GameServer::HandleInboundMessages()
+{
+	InboundMessage message;
+	while (m_inbound.Pop(message))
+	{
+		switch (message.m_type)
+		{
+		case InboundMessage::Type::kPacket:
+			HandleIncomingPacket(message.m_packet, message.m_peer, message.m_received_time);
+			break;
+
+		case InboundMessage::Type::kDisconnect:
+			HandleDisconnect(message.m_peer);
+			break;
+		}
+	}
+}
+
+void GameServer::RecordStep(sf::Time jitter, sf::Time inbound_time, sf::Time simulation_time, sf::Time broadcast_time)
+{
+	m_step_window.m_steps++;
+	m_step_window.m_average_jitter += jitter;
+	m_step_window.m_max_jitter = std::max(m_step_window.m_max_jitter, jitter);
+	m_step_window.m_max_inbound_time = std::max(m_step_window.m_max_inbound_time, inbound_time);
+	m_step_window.m_max_simulation_time = std::max(m_step_window.m_max_simulation_time, simulation_time);
+	m_step_window.m_max_broadcast_time = std::max(m_step_window.m_max_broadcast_time, broadcast_time);
+	m_simulation_metrics.m_step_duration.Observe((inbound_time + simulation_time + broadcast_time).asSeconds());
+
+	//Publish once a second
+	if (StepRate * static_cast<sf::Int64>(m_step_window.m_steps) >= sf::seconds(1.f))
+	{
+		PublishSimulationMetrics();
 
-		//sleep
-		sf::sleep(sf::milliseconds(100));
+		m_step_window.m_average_jitter /= static_cast<sf::Int64>(m_step_window.m_steps);
+
+		sf::Lock lock(m_statistics_mutex);
+		m_tick_statistics = m_step_window;
+		m_step_window = TickStatistics();
 	}
 }
 
+void GameServer::PublishSimulationMetrics()
+{
+	m_simulation_metrics.m_players = m_player_info.size();
+	m_simulation_metrics.m_alive_players = m_lobby ? 0 : static_cast<std::size_t>(std::max(m_alive_players, 0));
+	m_simulation_metrics.m_simulated_players = m_simulated_players;
+	m_simulation_metrics.m_spectators = m_spectators.size();
+	m_simulation_metrics.m_suspended_sessions = m_suspended_sessions.size();
+	m_simulation_metrics.m_in_match = !m_lobby;
+
+	sf::Lock lock(m_statistics_mutex);
+	m_published_simulation_metrics = m_simulation_metrics;
+}
+
 void GameServer::Tick()
 {
 	UpdateClientState();
@@ -179,6 +946,13 @@ void GameServer::Tick()
 	{
 		const opt::PlayerIdentifier winner_id = FindWinnerIdentity();
 
+		//Sent every tick until the clients leave, logged once
+		if (!m_winner_logged)
+		{
+			m_simulation_events.Log(EventLog::EventType::kMatchWon, 0, winner_id);
+			m_winner_logged = true;
+		}
+
 		sf::Packet packet;
 		packet << static_cast<opt::ServerPacket>(Server::PacketType::MissionSuccess)
 			<< winner_id;
@@ -191,7 +965,7 @@ opt::PlayerIdentifier GameServer::FindWinnerIdentity() const
 {
 	for (const auto& player : m_player_info)
 	{
-		if (player.second.m_hitpoints > 0)
+		if (player.second.m_hitpoints > 0 && !player.second.m_simulated)
 		{
 			return player.first;
 		}
@@ -200,54 +974,80 @@ opt::PlayerIdentifier GameServer::FindWinnerIdentity() const
 	return 0;
 }
 
-sf::Time GameServer::Now() const
+//This is the same as SpawnSelf but indicate that a player from a different client is entering the world
+
+void GameServer::NotifyPlayerSpawn(opt::PlayerIdentifier player_identifier)
 {
-	return m_clock.getElapsedTime();
+	sf::Packet packet;
+	//First thing for every packet is what type of packet it is
+	packet << static_cast<opt::ServerPacket>(Server::PacketType::PlayerConnect);
+	packet << player_identifier << m_player_info[player_identifier].m_position.x << m_player_info[player_identifier].m_position.y;
+	SendToAll(packet);
 }
 
-void GameServer::HandleIncomingPackets()
-{
-	bool detected_timeout = false;
+//Forwards a player's input frames to every other client. The masks are ordered newest first.
+//The sender's timestamp goes along with when the server received and relayed it, for LatencyTrace
 
-	for (PeerPtr& peer : m_peers)
+void GameServer::NotifyPlayerInput(opt::PlayerIdentifier player_identifier, opt::InputTick newest_tick, const std::vector<opt::InputMask>& masks,
+	sf::Int64 client_send_time, sf::Time received_time, PeerId exclude)
+{
+	sf::Packet packet;
+	//First thing for every packet is what type of packet it is
+	packet << static_cast<opt::ServerPacket>(Server::PacketType::PlayerInput);
+	packet << player_identifier << newest_tick << static_cast<sf::Uint8>(masks.size());
+	for (const opt::InputMask mask : masks)
 	{
-		if (peer->m_ready)
-		{
-			sf::Packet packet;
-			while (peer->m_socket.receive(packet) == sf::Socket::Done)
-			{
-				//Interpret the packet and react to it
-				HandleIncomingPacket(packet, *peer, detected_timeout);
+		packet << mask;
+	}
+	packet << client_send_time << received_time.asMicroseconds() << Now().asMicroseconds();
+	SendToAll(packet, exclude);
+}
 
-				peer->m_last_packet_time = Now();
-				packet.clear();
-			}
+void GameServer::HandleIncomingPacket(sf::Packet& packet, PeerId receiving_peer, sf::Time received_time)
+{
+	opt::ClientPacket packet_type;
+	packet >> packet_type;
 
-			if (Now() > peer->m_last_packet_time + m_client_timeout)
-			{
-				peer->m_timed_out = true;
-				detected_timeout = true;
-			}
+	switch (static_cast<Client::PacketType> (packet_type))
+	{
+	case Client::PacketType::SnapshotAck:
+	{
+		sf::Uint32 sequence;
+		const auto scheduler = m_snapshot_schedulers.find(receiving_peer);
+		if (packet >> sequence && scheduler != m_snapshot_schedulers.end())
+		{
+			scheduler->second.OnAck(sequence, Now());
 		}
 	}
+	break;
 
-	if (detected_timeout)
+	case Client::PacketType::Join:
 	{
-		HandleDisconnections();
+		opt::SessionToken token;
+		bool spectator;
+		if (packet >> token >> spectator)
+		{
+			HandleJoin(receiving_peer, token, spectator);
+		}
 	}
-}
-
-void GameServer::HandleIncomingPacket(sf::Packet& packet, RemotePeer& receiving_peer, bool& detected_timeout)
-{
-	opt::ClientPacket packet_type;
-	packet >> packet_type;
+	break;
 
-	switch (static_cast<Client::PacketType> (packet_type))
+	case Client::PacketType::RequestWorldState:
 	{
+		//Relays ask again for each new spectator. The model sent first resets the relay's baselines, so ours start over too
+		if (IsSpectator(receiving_peer))
+		{
+			m_snapshot_codecs.erase(receiving_peer);
+			InformWorldState(receiving_peer);
+		}
+	}
+	break;
+
 	case Client::PacketType::Quit:
 	{
-		receiving_peer.m_timed_out = true;
-		detected_timeout = true;
+		//Leaving on purpose ends the session, so the players are removed straight away
+		m_peer_sessions.erase(receiving_peer);
+		PushOutbound(OutboundMessage::Type::kKick, receiving_peer, ALL_PEERS);
 	}
 	break;
 
@@ -257,6 +1057,11 @@ void GameServer::HandleIncomingPacket(sf::Packet& packet, RemotePeer& receiving_
 		opt::GamesWon games_won;
 		packet >> player_identifier >> games_won;
 
+		if (!PeerOwnsPlayer(receiving_peer, player_identifier))
+		{
+			break;
+		}
+
 		m_player_info[player_identifier].m_games_won = games_won;
 
 		sf::Packet games_won_packet;
@@ -268,52 +1073,92 @@ void GameServer::HandleIncomingPacket(sf::Packet& packet, RemotePeer& receiving_
 	}
 	break;
 
-	case Client::PacketType::PlayerEvent:
+	case Client::PacketType::PlayerInput:
 	{
 		opt::PlayerIdentifier player_identifier;
-		opt::Action action;
-		packet >> player_identifier >> action;
+		opt::InputTick newest_tick;
+		sf::Uint8 frame_count;
+		packet >> player_identifier >> newest_tick >> frame_count;
+
+		//Clients never send more than INPUT_REDUNDANCY frames, anything else is malformed
+		if (!packet || frame_count == 0 || frame_count > INPUT_REDUNDANCY)
+		{
+			break;
+		}
+
+		std::vector<opt::InputMask> masks(frame_count);
+		for (opt::InputMask& mask : masks)
+		{
+			packet >> mask;
+		}
 
-		if (static_cast<PlayerAction>(action) == PlayerAction::kAttack)
+		sf::Int64 client_send_time;
+		packet >> client_send_time;
+
+		//Peers may only send input for their own players
+		if (!packet || !PeerOwnsPlayer(receiving_peer, player_identifier))
+		{
+			break;
+		}
+
+		//Consume the frames that have not been seen yet, oldest first
+		PlayerInfo& player = m_player_info[player_identifier];
+		bool new_frames = false;
+		for (std::size_t i = masks.size(); i-- > 0;)
 		{
-			if (PlayerCanAttack(player_identifier))
+			const opt::InputTick tick = newest_tick - static_cast<opt::InputTick>(i);
+			if (player.m_has_input && static_cast<sf::Int32>(tick - player.m_last_input_tick) <= 0)
 			{
-				PlayerAttack(player_identifier);
-				NotifyPlayerEvent(player_identifier, action);
+				continue;
 			}
+
+			const opt::InputMask attack = ToInputMask(PlayerAction::kAttack);
+			if (masks[i] & attack)
+			{
+				if (PlayerCanAttack(player_identifier))
+				{
+					PlayerAttack(player_identifier);
+				}
+				else
+				{
+					masks[i] &= ~attack;
+				}
+			}
+
+			player.m_last_input_tick = tick;
+			player.m_has_input = true;
+			new_frames = true;
 		}
-		else
+
+		if (new_frames)
 		{
-			NotifyPlayerEvent(player_identifier, action);
+			NotifyPlayerInput(player_identifier, newest_tick, masks, client_send_time, received_time, receiving_peer);
 		}
 	}
 	break;
 
-	case Client::PacketType::PlayerRealtimeChange:
-	{
-		opt::PlayerIdentifier player_identifier;
-		opt::Action action;
-		bool action_enabled;
-		packet >> player_identifier >> action >> action_enabled;
-		NotifyPlayerRealtimeChange(player_identifier, action, action_enabled);
-	}
-	break;
-
 	case Client::PacketType::RequestCoopPartner:
 	{
+		if (IsSpectator(receiving_peer))
+		{
+			break;
+		}
+
 		m_alive_players++;
 		opt::PlayerIdentifier identifier = GetFreeIdentifier();
-		receiving_peer.m_player_identifiers.emplace_back(identifier);
+		m_peer_players[receiving_peer].emplace_back(identifier);
 
 		m_player_info[identifier].m_name = std::to_string(identifier);
 		m_player_info[identifier].m_position = sf::Vector2f(0, 0);
 		m_player_info[identifier].m_hitpoints = 100;
+		m_player_info[identifier].m_has_input = false;
+		m_player_info[identifier].m_simulated = false;
 
 		sf::Packet request_packet;
 		request_packet << static_cast<opt::ServerPacket>(Server::PacketType::AcceptCoopPartner);
 		request_packet << identifier;
 
-		receiving_peer.m_socket.send(request_packet);
+		Send(receiving_peer, request_packet);
 		m_player_count++;
 
 		// Tell everyone else about the new player
@@ -321,13 +1166,7 @@ void GameServer::HandleIncomingPacket(sf::Packet& packet, RemotePeer& receiving_
 		notify_packet << static_cast<opt::ServerPacket>(Server::PacketType::PlayerConnect);
 		notify_packet << identifier;
 
-		for (PeerPtr& peer : m_peers)
-		{
-			if (peer.get() != &receiving_peer && peer->m_ready)
-			{
-				peer->m_socket.send(notify_packet);
-			}
-		}
+		SendToAll(notify_packet, receiving_peer);
 	}
 	break;
 
@@ -349,12 +1188,26 @@ void GameServer::HandleIncomingPacket(sf::Packet& packet, RemotePeer& receiving_
 			sf::Vector2f player_position;
 			packet >> player_identifier >> player_position.x >> player_position.y;
 
-			m_player_info[player_identifier].m_position = player_position;
+			if (!PeerOwnsPlayer(receiving_peer, player_identifier))
+			{
+				continue;
+			}
+
+			//The velocity feeds the snapshot scheduler's prediction error
+			PlayerInfo& info = m_player_info[player_identifier];
+			const sf::Time now = Now();
+			if (info.m_position_time > sf::Time::Zero && now > info.m_position_time)
+			{
+				info.m_velocity = (player_position - info.m_position) / (now - info.m_position_time).asSeconds();
+			}
+			info.m_position = player_position;
+			info.m_position_time = now;
 
 			if (m_player_info[player_identifier].m_hitpoints > 0 && IsPlayerUnderWorld(player_identifier))
 			{
 				m_player_info[player_identifier].m_hitpoints = 0;
 				m_alive_players--;
+				m_simulation_events.Log(EventLog::EventType::kPlayerDied, receiving_peer, player_identifier);
 
 				sf::Packet notify_packet;
 				notify_packet << static_cast<opt::ServerPacket>(Server::PacketType::PlayerDied)
@@ -380,14 +1233,26 @@ void GameServer::HandleIncomingPacket(sf::Packet& packet, RemotePeer& receiving_
 
 	case Client::PacketType::RequestStartGame:
 	{
-		SetListening(false);
+		if (IsSpectator(receiving_peer))
+		{
+			break;
+		}
+
 		sf::Packet packet;
 		packet << static_cast<opt::ServerPacket>(Server::PacketType::StartGame);
 		SendToAll(packet);
 
 		m_lobby = false;
+		m_winner_logged = false;
+		m_simulation_events.Log(EventLog::EventType::kMatchStarted, receiving_peer, m_player_info.size());
+		m_last_danger_time = m_simulation_time;
+		ScheduleDangers();
 	}
 	break;
+
+	//Answered by the network thread in AnswerClockSync, never queued for the simulation
+	case Client::PacketType::ClockSync:
+		break;
 	}
 }
 
@@ -408,109 +1273,334 @@ opt::PlayerIdentifier GameServer::GetFreeIdentifier() const
 	}
 }
 
-void GameServer::HandleIncomingConnections()
+//Simulated players belong to a peer that never connects. They are sent to clients like any remote
+//player so large lobbies can be measured without running hundreds of clients.
+//Simulated viewers are the reverse, peers without a connection that are sent snapshots, to measure many clients
+
+void GameServer::AddSimulatedPlayers()
 {
-	if (!m_listening_state)
+	for (std::size_t i = 0; i < m_simulated_viewers; ++i)
 	{
-		return;
+		m_peer_players[FIRST_SIMULATED_VIEWER + static_cast<PeerId>(i)];
 	}
 
-	if (m_listener_socket.accept(m_peers[m_connected_players]->m_socket) == sf::TcpListener::Done)
+	for (std::size_t i = 0; i < m_simulated_players; ++i)
 	{
-		m_alive_players++;
 		const opt::PlayerIdentifier identifier = GetFreeIdentifier();
+		PlayerInfo& player = m_player_info[identifier];
+		player.m_name = "Bot " + std::to_string(identifier);
+		player.m_position = sf::Vector2f(0, 0);
+		player.m_hitpoints = 100;
+		player.m_games_won = 0;
+		player.m_has_input = false;
+		player.m_simulated = true;
+
+		m_peer_players[SIMULATED_PEER].emplace_back(identifier);
+		m_player_count++;
+	}
+}
 
-		//Order the new client to spawn its player 1
-		m_player_info[identifier].m_name = "Player " + std::to_string(identifier);
-		m_player_info[identifier].m_position = sf::Vector2f(0, 0);
-		m_player_info[identifier].m_hitpoints = 100;
-		m_player_info[identifier].m_games_won = 0;
+bool GameServer::IsSimulatedViewer(PeerId peer) const
+{
+	return peer >= FIRST_SIMULATED_VIEWER && peer != SIMULATED_PEER;
+}
+
+void GameServer::MoveSimulatedPlayers()
+{
+	const auto simulated = m_peer_players.find(SIMULATED_PEER);
+	if (simulated == m_peer_players.end())
+	{
+		return;
+	}
+
+	//Each bot paces back and forth across the world, out of phase with the others
+	const float time = Now().asSeconds();
+	for (opt::PlayerIdentifier identifier : simulated->second)
+	{
+		PlayerInfo& player = m_player_info[identifier];
+		player.m_position.x = WorldInfo::WORLD_WIDTH * (0.5f + 0.4f * std::sin(time * 0.5f + identifier));
+		player.m_position.y = 64.f;
+		player.m_velocity.x = WorldInfo::WORLD_WIDTH * 0.2f * std::cos(time * 0.5f + identifier);
+		player.m_velocity.y = 0.f;
+	}
+}
 
+bool GameServer::PeerOwnsPlayer(PeerId peer, opt::PlayerIdentifier identifier) const
+{
+	const auto found = m_peer_players.find(peer);
+	return found != m_peer_players.end() &&
+		std::find(found->second.begin(), found->second.end(), identifier) != found->second.end();
+}
 
-		sf::Packet packet;
-		packet << static_cast<opt::ServerPacket>(Server::PacketType::SpawnSelf);
-		packet << identifier;
+//The first packet of every connection is Join. A known session token resumes the players it owned,
+//anything else starts a new session
 
-		m_peers[m_connected_players]->m_player_identifiers.emplace_back(identifier);
+void GameServer::HandleJoin(PeerId peer, opt::SessionToken token, bool spectator)
+{
+	if (m_peer_sessions.count(peer) || IsSpectator(peer))
+	{
+		return;
+	}
 
-		BroadcastMessage("New player");
-		InformWorldState(m_peers[m_connected_players]->m_socket);
-		NotifyPlayerSpawn(identifier);
+	m_simulation_events.Log(EventLog::EventType::kJoin, peer, spectator ? 1 : 0, token != 0 ? 1 : 0);
 
-		m_peers[m_connected_players]->m_socket.send(packet);
-		m_peers[m_connected_players]->m_ready = true;
-		m_peers[m_connected_players]->m_last_packet_time = Now();
+	if (spectator)
+	{
+		StartSpectating(peer);
+		return;
+	}
 
-		m_player_count++;
-		m_connected_players++;
+	std::vector<opt::PlayerIdentifier> players;
+	if (token != 0 && TakeSession(token, players))
+	{
+		ResumeSession(peer, token, players);
+	}
+	else
+	{
+		StartSession(peer);
+	}
+}
 
-		if (m_connected_players >= m_max_connected_players)
+bool GameServer::TakeSession(opt::SessionToken token, std::vector<opt::PlayerIdentifier>& players)
+{
+	//The old connection may not have timed out yet, in which case the new one replaces it
+	for (const auto& session : m_peer_sessions)
+	{
+		if (session.second == token)
 		{
-			SetListening(false);
+			const PeerId old_peer = session.first;
+			players = m_peer_players[old_peer];
+
+			m_peer_players.erase(old_peer);
+			m_peer_sessions.erase(old_peer);
+			m_snapshot_schedulers.erase(old_peer);
+			m_snapshot_codecs.erase(old_peer);
+			PushOutbound(OutboundMessage::Type::kKick, old_peer, ALL_PEERS);
+			return true;
 		}
-		else
+	}
+
+	const auto suspended = m_suspended_sessions.find(token);
+	if (suspended == m_suspended_sessions.end())
+	{
+		return false;
+	}
+
+	players = suspended->second.m_players;
+	m_simulation_timers.Cancel(suspended->second.m_expiry_timer);
+	m_suspended_sessions.erase(suspended);
+	return true;
+}
+
+void GameServer::StartSession(PeerId peer)
+{
+	m_alive_players++;
+	const opt::PlayerIdentifier identifier = GetFreeIdentifier();
+
+	//Order the new client to spawn its player 1
+	m_player_info[identifier].m_name = "Player " + std::to_string(identifier);
+	m_player_info[identifier].m_position = sf::Vector2f(0, 0);
+	m_player_info[identifier].m_hitpoints = 100;
+	m_player_info[identifier].m_has_input = false;
+	m_player_info[identifier].m_simulated = false;
+	m_player_info[identifier].m_games_won = 0;
+
+	sf::Packet packet;
+	packet << static_cast<opt::ServerPacket>(Server::PacketType::SpawnSelf);
+	packet << identifier;
+
+	m_peer_players[peer].emplace_back(identifier);
+	m_peer_sessions[peer] = CreateSessionToken();
+
+	//The new peer is not ready yet, so broadcasts here only reach the existing peers
+	BroadcastMessage("New player");
+	InformWorldState(peer);
+	NotifyPlayerSpawn(identifier);
+
+	Send(peer, packet);
+	PushOutbound(OutboundMessage::Type::kReady, peer, ALL_PEERS);
+
+	m_player_count++;
+}
+
+//The client kept its own players while reconnecting, so it only needs the world state
+
+void GameServer::ResumeSession(PeerId peer, opt::SessionToken token, const std::vector<opt::PlayerIdentifier>& players)
+{
+	m_peer_players[peer] = players;
+	m_peer_sessions[peer] = token;
+	m_simulation_events.Log(EventLog::EventType::kSessionResumed, peer, token);
+
+	BroadcastMessage("A player has reconnected");
+	InformWorldState(peer);
+	PushOutbound(OutboundMessage::Type::kReady, peer, ALL_PEERS);
+}
+
+//An empty player list puts the spectator in the snapshot schedule while PeerOwnsPlayer keeps it read only
+
+void GameServer::StartSpectating(PeerId peer)
+{
+	m_spectators.insert(peer);
+	m_peer_players[peer];
+
+	InformWorldState(peer);
+	PushOutbound(OutboundMessage::Type::kReady, peer, ALL_PEERS);
+}
+
+bool GameServer::IsSpectator(PeerId peer) const
+{
+	return m_spectators.count(peer) != 0;
+}
+
+opt::SessionToken GameServer::CreateSessionToken()
+{
+	std::uniform_int_distribution<opt::SessionToken> distribution(1);
+
+	while (true)
+	{
+		const opt::SessionToken token = distribution(m_random);
+		if (!m_suspended_sessions.count(token))
 		{
-			m_peers.emplace_back(PeerPtr(new RemotePeer()));
+			return token;
 		}
 	}
 }
 
-void GameServer::HandleDisconnections()
+void GameServer::HandleDisconnect(PeerId peer)
 {
-	for (auto itr = m_peers.begin(); itr != m_peers.end();)
+	m_snapshot_schedulers.erase(peer);
+	m_snapshot_codecs.erase(peer);
+
+	if (m_spectators.erase(peer))
 	{
-		if ((*itr)->m_timed_out)
+		m_peer_players.erase(peer);
+		return;
+	}
+
+	const auto found = m_peer_players.find(peer);
+	const auto session = m_peer_sessions.find(peer);
+	if (found == m_peer_players.end())
+	{
+		if (session != m_peer_sessions.end())
 		{
-			//Inform everyone of a disconnection, erase
-			for (opt::PlayerIdentifier identifier : (*itr)->m_player_identifiers)
+			m_peer_sessions.erase(session);
+		}
+		return;
+	}
+
+	//During a match the players stay in the world for a few seconds, in case the client comes back
+	if (!m_lobby && session != m_peer_sessions.end())
+	{
+		const opt::SessionToken token = session->second;
+		m_simulation_events.Log(EventLog::EventType::kSessionSuspended, peer, token);
+		SuspendedSession& suspended = m_suspended_sessions[token];
+		suspended.m_players = found->second;
+		suspended.m_expiry_timer = m_simulation_timers.Schedule(m_simulation_time + sf::seconds(SESSION_RESUME_SECONDS), [this, token]()
 			{
-				m_alive_players--;
-				SendToAll((sf::Packet() << static_cast<opt::ServerPacket>(Server::PacketType::PlayerDisconnect) << identifier));
-				m_player_info.erase(identifier);
-			}
+				ExpireSession(token);
+			});
 
-			m_connected_players--;
-			m_player_count -= (*itr)->m_player_identifiers.size();
+		m_peer_sessions.erase(session);
+		m_peer_players.erase(found);
 
-			itr = m_peers.erase(itr);
+		BroadcastMessage("A player lost connection");
+		return;
+	}
 
-			//If the number of peers has dropped below max_connections
-			if (m_connected_players < m_max_connected_players)
-			{
-				m_peers.emplace_back(PeerPtr(new RemotePeer()));
-				SetListening(true);
-			}
+	if (session != m_peer_sessions.end())
+	{
+		m_peer_sessions.erase(session);
+	}
+
+	RemovePlayers(found->second);
+	m_peer_players.erase(found);
+
+	BroadcastMessage("A player has disconnected");
+}
+
+void GameServer::ExpireSession(opt::SessionToken token)
+{
+	const auto suspended = m_suspended_sessions.find(token);
+	if (suspended == m_suspended_sessions.end())
+	{
+		return;
+	}
+
+	m_simulation_events.Log(EventLog::EventType::kSessionExpired, 0, token);
+	RemovePlayers(suspended->second.m_players);
+	m_suspended_sessions.erase(suspended);
+	BroadcastMessage("A player has disconnected");
+}
 
-			BroadcastMessage("A player has disconnected");
+void GameServer::RemovePlayers(const std::vector<opt::PlayerIdentifier>& players)
+{
+	//Inform everyone of a disconnection, erase
+	for (opt::PlayerIdentifier identifier : players)
+	{
+		m_alive_players--;
+		SendToAll((sf::Packet() << static_cast<opt::ServerPacket>(Server::PacketType::PlayerDisconnect) << identifier));
+		m_player_info.erase(identifier);
+
+		for (auto& scheduler : m_snapshot_schedulers)
+		{
+			scheduler.second.Forget(identifier);
 		}
-		else
+
+		for (auto& codec : m_snapshot_codecs)
 		{
-			++itr;
+			codec.second.Forget(identifier);
 		}
 	}
+
+	m_player_count -= static_cast<opt::PlayerCount>(players.size());
 }
 
-void GameServer::InformWorldState(sf::TcpSocket& socket)
+/// <summary>
+/// Everything a client needs to join mid-match in one packet: its session token, the tile damage
+/// of the whole grid and the state of every other player. Dangers are the server's to trigger, clients only see the damage.
+/// It is preceded by the model snapshots are coded with, which also resets the client's snapshot baselines.
+/// </summary>
+void GameServer::InformWorldState(PeerId peer)
 {
+	sf::Packet model_packet;
+	model_packet << static_cast<opt::ServerPacket>(Server::PacketType::SnapshotModel);
+	m_snapshot_model.Write(model_packet);
+	Send(peer, model_packet);
+
+	//Spectators have no session to resume
+	const auto session = m_peer_sessions.find(peer);
+
 	sf::Packet packet;
 	packet << static_cast<opt::ServerPacket>(Server::PacketType::InitialState)
-	<< static_cast<sf::Uint32>(Utility::GetSeed())
-	<< static_cast<opt::PlayerCount>(m_player_count);
+		<< static_cast<sf::Uint32>(Utility::GetSeed())
+		<< (session != m_peer_sessions.end() ? session->second : opt::SessionToken(0))
+		<< !m_lobby;
 
-	for (std::size_t i = 0; i < m_connected_players; ++i)
+	m_tile_grid.WriteSnapshot(packet);
+
+	//Players of dropped clients are included, they stay in the world until their session expires
+	std::vector<opt::PlayerIdentifier> players;
+	for (const auto& player : m_player_info)
 	{
-		if (m_peers[i]->m_ready)
+		if (!PeerOwnsPlayer(peer, player.first))
 		{
-			for (opt::PlayerIdentifier identifier : m_peers[i]->m_player_identifiers)
-			{
-				packet << identifier
-					<< m_player_info[identifier].m_name
-					<< m_player_info[identifier].m_games_won;
-			}
+			players.emplace_back(player.first);
 		}
 	}
 
-	socket.send(packet);
+	packet << static_cast<opt::PlayerCount>(players.size());
+	for (opt::PlayerIdentifier identifier : players)
+	{
+		const PlayerInfo& player = m_player_info[identifier];
+		packet << identifier
+			<< player.m_name
+			<< player.m_games_won
+			<< player.m_position.x
+			<< player.m_position.y
+			<< player.m_hitpoints;
+	}
+
+	Send(peer, packet);
 }
 
 void GameServer::BroadcastMessage(const std::string& message)
@@ -518,49 +1608,228 @@ void GameServer::BroadcastMessage(const std::string& message)
 	sf::Packet packet;
 	packet << static_cast<opt::ServerPacket>(Server::PacketType::BroadcastMessage);
 	packet << message;
-	for (std::size_t i = 0; i < m_connected_players; ++i)
+	SendToAll(packet);
+}
+
+void GameServer::Send(PeerId peer, const sf::Packet& packet)
+{
+	PushOutbound(OutboundMessage::Type::kPacket, peer, ALL_PEERS, packet);
+}
+
+void GameServer::SendToAll(const sf::Packet& packet, PeerId exclude)
+{
+	PushOutbound(OutboundMessage::Type::kPacket, ALL_PEERS, exclude, packet);
+}
+
+void GameServer::PushOutbound(OutboundMessage::Type type, PeerId peer, PeerId exclude, const sf::Packet& packet)
+{
+	OutboundMessage message;
+	message.m_type = type;
+	message.m_peer = peer;
+	message.m_exclude = exclude;
+	message.m_packet = packet;
+
+	if (!m_outbound_overflow.empty() || !m_outbound.Push(message))
 	{
-		if (m_peers[i]->m_ready)
-		{
-			m_peers[i]->m_socket.send(packet);
-		}
+		m_outbound_overflow.emplace_back(std::move(message));
 	}
 }
 
-void GameServer::SendToAll(sf::Packet& packet)
+/// <summary>
+/// The network thread empties the outbound queue on every loop, so the overflow only builds up
+/// while a burst of broadcasts is larger than the queue, and is moved over within a step or two.
+/// </summary>
+void GameServer::FlushOutboundOverflow()
 {
-	for (PeerPtr& peer : m_peers)
+	while (!m_outbound_overflow.empty() && m_outbound.Push(m_outbound_overflow.front()))
 	{
-		if (peer->m_ready)
-		{
-			peer->m_socket.send(packet);
-		}
+		m_outbound_overflow.pop_front();
 	}
 }
 
+//Each peer gets its own snapshot, sized to its bandwidth estimate and filled with the players it most needs.
+//Scheduling and encoding are independent per peer, so they are spread over the job system
+
 void GameServer::UpdateClientState()
 {
-	sf::Packet update_client_state_packet;
-	update_client_state_packet << static_cast<opt::ServerPacket>(Server::PacketType::UpdateClientState);
+	if (m_lobby)
+	{
+		//Still sent in the lobby, it keeps the clients from timing out
+		SendToAll(sf::Packet() << static_cast<opt::ServerPacket>(Server::PacketType::UpdateClientState));
+		return;
+	}
+
+	m_snapshot_candidates.clear();
+	for (const auto& player : m_player_info)
+	{
+		SnapshotScheduler::Candidate candidate;
+		candidate.m_identifier = player.first;
+		candidate.m_position = player.second.m_position;
+		candidate.m_velocity = player.second.m_velocity;
+		m_snapshot_candidates.emplace_back(candidate);
+	}
+
+	const sf::Time now = Now();
+	const sf::Time dt = StepRate * static_cast<sf::Int64>(StepsPerTick);
+
+	//Schedulers and codecs are created here, the maps must not change while the jobs run
+	std::size_t job_count = 0;
+	for (const auto& peer_players : m_peer_players)
+	{
+		if (peer_players.first == SIMULATED_PEER)
+		{
+			continue;
+		}
+
+		if (job_count == m_snapshot_jobs.size())
+		{
+			m_snapshot_jobs.emplace_back();
+		}
+
+		SnapshotJob& job = m_snapshot_jobs[job_count++];
+		job.m_peer = peer_players.first;
+		job.m_scheduler = &m_snapshot_schedulers[peer_players.first];
+		job.m_codec = &m_snapshot_codecs[peer_players.first];
+		job.m_own_players = &peer_players.second;
+	}
+
+	const sf::Time encode_start = Now();
+	m_jobs.ParallelFor(job_count, 1, [&](std::size_t i)
+		{
+			EncodeSnapshot(m_snapshot_jobs[i], m_snapshot_candidates, m_compress_snapshots ? &m_snapshot_model : nullptr, dt, now);
+		});
+	const sf::Time encode_time = Now() - encode_start;
 
-	if (!m_lobby)
+	//Sent in peer order, so the output does not depend on which thread encoded what
+	for (std::size_t i = 0; i < job_count; ++i)
 	{
-		update_client_state_packet << static_cast<opt::PlayerCount>(m_player_count);
+		const SnapshotJob& job = m_snapshot_jobs[i];
+
+		m_step_window.m_snapshot_raw_bytes += job.m_payload.size();
+		m_step_window.m_snapshot_coded_bytes += job.m_coded_size;
+
+		if (m_snapshot_log.is_open())
+		{
+			for (sf::Uint8 byte : job.m_payload)
+			{
+				m_snapshot_histogram[byte]++;
+			}
+		}
 
-		for (const auto& player : m_player_info)
+		//Simulated viewers ack straight away, so their budget grows like a client on a fast link
+		if (IsSimulatedViewer(job.m_peer))
+		{
+			job.m_scheduler->OnAck(job.m_decision.m_sequence, now);
+		}
+		else
 		{
-			update_client_state_packet << player.first << player.second.m_position.x << player.second.m_position.y;
+			Send(job.m_peer, job.m_packet);
 		}
+
+		LogSnapshot(job.m_peer, *job.m_scheduler, job.m_decision, job.m_packet.getDataSize());
+	}
+
+	if (encode_time >= m_step_window.m_max_encode_time)
+	{
+		m_step_window.m_max_encode_time = encode_time;
+		m_step_window.m_snapshot_peers = job_count;
+		m_step_window.m_snapshot_workers = m_jobs.GetWorkerCount();
+	}
+}
+
+/// <summary>
+/// Picks the players for one peer's snapshot and writes it as a quantized delta payload,
+/// range coded with the model when there is one and it comes out smaller.
+/// Runs on the job system, so it only reads shared state.
+/// </summary>
+void GameServer::EncodeSnapshot(SnapshotJob& job, const std::vector<SnapshotScheduler::Candidate>& candidates, const RangeModel* model,
+	sf::Time dt, sf::Time now)
+{
+	job.m_decision = job.m_scheduler->Schedule(candidates, *job.m_own_players, dt, now);
+
+	job.m_entries.clear();
+	for (std::size_t i : job.m_decision.m_selected)
+	{
+		SnapshotCodec::Entry entry;
+		entry.m_identifier = candidates[i].m_identifier;
+		entry.m_position = candidates[i].m_position;
+		job.m_entries.emplace_back(entry);
+	}
+
+	job.m_payload.clear();
+	job.m_codec->Encode(job.m_entries, job.m_payload);
+
+	job.m_packet.clear();
+	job.m_packet << static_cast<opt::ServerPacket>(Server::PacketType::UpdateClientState)
+		<< job.m_decision.m_sequence;
+
+	job.m_coded_size = SnapshotCodec::WritePayload(model, job.m_payload, job.m_coded, job.m_packet);
+}
+
+void GameServer::LogSnapshot(PeerId peer, const SnapshotScheduler& scheduler, const SnapshotScheduler::Decision& decision, std::size_t packet_bytes)
+{
+	if (!m_snapshot_log.is_open())
+	{
+		return;
 	}
 
-	SendToAll(update_client_state_packet);
+	m_snapshot_log << Now().asMilliseconds() << ','
+		<< peer << ','
+		<< decision.m_sequence << ','
+		<< scheduler.GetRoundTripTime().asMicroseconds() << ','
+		<< scheduler.GetBandwidth() << ','
+		<< decision.m_budget << ','
+		<< decision.m_bytes << ','
+		<< decision.m_candidates << ','
+		<< decision.m_selected.size() << ','
+		<< decision.m_highest_skipped << ','
+		<< packet_bytes << '\n';
+}
+
+void GameServer::ScheduleDangers()
+{
+	m_simulation_timers.Schedule(m_last_danger_time + DangerRate, [this]()
+		{
+			UpdateDangers(DangerRate);
+			m_last_danger_time += DangerRate;
+			ScheduleDangers();
+		});
 }
 
+//Same rules as DangerTrigger, but the server picks the tiles so every client, including late joiners, sees the same world
+
 void GameServer::UpdateDangers(sf::Time dt)
 {
+	std::vector<opt::TileCell> damaged;
+
+	m_tile_grid.GetTopCells(m_danger_cells);
+	const std::size_t dangers = std::min(static_cast<std::size_t>(m_dangers_per_second), m_danger_cells.size());
+
+	for (std::size_t i = 0; i < dangers && !m_danger_cells.empty(); ++i)
+	{
+		std::uniform_int_distribution<std::size_t> distribution(0, m_danger_cells.size() - 1);
+		const int cell = m_danger_cells[distribution(m_random)];
+
+		m_tile_grid.Damage(cell);
+		damaged.emplace_back(static_cast<opt::TileCell>(cell));
+		m_tile_grid.GetTopCells(m_danger_cells);
+	}
+
+	m_dangers_per_second += DangerRateIncrease * dt.asSeconds();
+
+	if (damaged.empty())
+	{
+		return;
+	}
+
 	sf::Packet packet;
-	packet << static_cast<opt::ServerPacket>(Server::PacketType::UpdateDangerTime)
-		<< dt.asSeconds();
+	packet << static_cast<opt::ServerPacket>(Server::PacketType::TileDamage)
+		<< static_cast<opt::TileCell>(damaged.size());
+
+	for (opt::TileCell cell : damaged)
+	{
+		packet << cell;
+	}
 
 	SendToAll(packet);
 }
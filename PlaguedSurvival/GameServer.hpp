@@ -1,16 +1,38 @@
 #pragma once
+#include <array>
+#include <atomic>
+#include <deque>
+#include <fstream>
 #include <map>
 #include <memory>
+#include <random>
+#include <set>
 #include <string>
+#include <vector>
 #include <SFML/Config.hpp>
 #include <SFML/Graphics/Rect.hpp>
 #include <SFML/System/Vector2.hpp>
+#include <SFML/Network/Packet.hpp>
+#include <SFML/Network/SocketSelector.hpp>
 #include <SFML/Network/TcpSocket.hpp>
 #include <SFML/Network/TcpListener.hpp>
 #include <SFML/System/Clock.hpp>
+#include <SFML/System/Mutex.hpp>
 #include <SFML/System/Thread.hpp>
 
+#include "EventLog.hpp"
+#include "JobSystem.hpp"
+#include "Metrics.hpp"
+#include "MetricsEndpoint.hpp"
 #include "NetworkOptimisations.hpp"
+#include "NetworkProtocol.hpp"
+#include "RangeCoder.hpp"
+#include "SnapshotCodec.hpp"
+#include "SnapshotScheduler.hpp"
+#include "SpscQueue.hpp"
+#include "TimingWheel.hpp"
+#include "TileGrid.hpp"
+#include "TokenBucket.hpp"
 
 /**
  * Vilandas Morrissey - D00218436
@@ -21,53 +43,262 @@ class GameServer
 public:
 	static constexpr int NAME_SIZE = 12;
 
+	//Per-phase timings of the simulation thread, gathered over the last second
+	struct TickStatistics
+	{
+		TickStatistics();
+
+		std::size_t m_steps;
+		sf::Time m_average_jitter;
+		sf::Time m_max_jitter;
+		sf::Time m_max_inbound_time;
+		sf::Time m_max_simulation_time;
+		sf::Time m_max_broadcast_time;
+		sf::Time m_max_encode_time;
+		std::size_t m_snapshot_peers;
+		std::size_t m_snapshot_workers;
+		std::size_t m_snapshot_raw_bytes;
+		std::size_t m_snapshot_coded_bytes;
+	};
+
+	//Packet and socket call counters of the network thread, gathered over the last second
+	struct NetworkStatistics
+	{
+		NetworkStatistics();
+
+		std::size_t m_received;
+		std::size_t m_deferred;
+		std::size_t m_dropped;
+		std::size_t m_receive_calls;
+		std::size_t m_sent;
+		std::size_t m_send_calls;
+	};
+
 public:
-	explicit GameServer();
+	GameServer(std::size_t max_connected_players, std::size_t simulated_players, std::size_t simulated_viewers,
+		bool log_snapshots, bool compress_snapshots, unsigned short metrics_port);
 	~GameServer();
-	void NotifyPlayerSpawn(opt::PlayerIdentifier player_identifier);
-	void NotifyPlayerRealtimeChange(opt::PlayerIdentifier player_identifier, opt::Action action, bool action_enabled);
-	void NotifyPlayerEvent(opt::PlayerIdentifier player_identifier, opt::Action action);
+	TickStatistics GetTickStatistics() const;
+	NetworkStatistics GetNetworkStatistics() const;
 
 private:
+	//Times EncodeSnapshot on its own lobby of peers
+	friend class Benchmarks;
+
+	typedef sf::Uint32 PeerId;
+	static constexpr PeerId ALL_PEERS = 0;
+	//Owner of the simulated players, never assigned to a connection
+	static constexpr PeerId SIMULATED_PEER = 0xFFFFFFFF;
+	//Simulated viewers take the ids just below it
+	static constexpr PeerId FIRST_SIMULATED_VIEWER = SIMULATED_PEER - MAX_SIMULATED_VIEWERS;
+
+	//Inbound packets are rate limited separately for each class
+	enum class MessageClass
+	{
+		kControl,
+		kRealtime,
+		kPosition,
+		kAck,
+		kMessageClassCount
+	};
+
+	//Why the network thread dropped a peer, counted for the metrics
+	enum class DisconnectReason
+	{
+		kTimeout,
+		kClosed,
+		kMalformed,
+		kSendOverflow,
+		kKicked,
+		kDisconnectReasonCount
+	};
+
+	//Owned by the network thread
 	struct RemotePeer
 	{
-		RemotePeer();
+		explicit RemotePeer(PeerId id);
+		PeerId m_id;
 		sf::TcpSocket m_socket;
 		sf::Time m_last_packet_time;
-		std::vector<opt::PlayerIdentifier> m_player_identifiers;
+		TimingWheel::TimerId m_timeout_timer;
+		std::array<TokenBucket, static_cast<int>(MessageClass::kMessageClassCount)> m_rate_limits;
+		std::deque<sf::Packet> m_deferred;
+		//Framed packets waiting for the next send, and bytes read but not yet split into packets
+		std::vector<char> m_send_buffer;
+		std::vector<char> m_receive_buffer;
+		std::size_t m_receive_offset;
 		bool m_ready;
 		bool m_timed_out;
+		DisconnectReason m_disconnect_reason;
+	};
+
+	//Totals since the server started, kept by the network thread. Packets are counted by their type byte
+	struct NetworkMetrics
+	{
+		NetworkMetrics();
+
+		std::array<sf::Uint64, 256> m_packets_in;
+		std::array<sf::Uint64, 256> m_bytes_in;
+		std::array<sf::Uint64, 256> m_packets_out;
+		std::array<sf::Uint64, 256> m_bytes_out;
+		std::array<sf::Uint64, static_cast<int>(DisconnectReason::kDisconnectReasonCount)> m_disconnects;
+		sf::Uint64 m_connections;
+		sf::Uint64 m_deferred;
+		sf::Uint64 m_dropped;
+	};
+
+	//Game state for the metrics, copied from the simulation thread once a second
+	struct SimulationMetrics
+	{
+		SimulationMetrics();
+
+		std::size_t m_players;
+		std::size_t m_alive_players;
+		std::size_t m_simulated_players;
+		std::size_t m_spectators;
+		std::size_t m_suspended_sessions;
+		bool m_in_match;
+		MetricsHistogram m_step_duration;
 	};
 
+	//Owned by the simulation thread
 	struct PlayerInfo
 	{
 		std::string m_name;
 		sf::Vector2f m_position;
+		sf::Vector2f m_velocity;
+		sf::Time m_position_time;
 		sf::Int32 m_hitpoints;
 		opt::GamesWon m_games_won;
-		std::map<opt::Action, bool> m_realtime_actions;
+		opt::InputTick m_last_input_tick;
+		bool m_has_input;
+		bool m_simulated;
+	};
+
+	//Players of a dropped client, kept until it resumes or the session expires
+	struct SuspendedSession
+	{
+		std::vector<opt::PlayerIdentifier> m_players;
+		TimingWheel::TimerId m_expiry_timer;
+	};
+
+	//Network thread -> simulation thread
+	struct InboundMessage
+	{
+		enum class Type
+		{
+			kPacket,
+			kDisconnect
+		};
+
+		Type m_type;
+		PeerId m_peer;
+		sf::Packet m_packet;
+		sf::Time m_received_time;
+	};
+
+	//Simulation thread -> network thread
+	struct OutboundMessage
+	{
+		enum class Type
+		{
+			kPacket,
+			kReady,
+			kKick
+		};
+
+		Type m_type;
+		PeerId m_peer;
+		PeerId m_exclude;
+		sf::Packet m_packet;
+	};
+
+	//One peer's snapshot for this tick. Jobs run in parallel and only touch their own peer's scheduler and codec
+	struct SnapshotJob
+	{
+		PeerId m_peer;
+		SnapshotScheduler* m_scheduler;
+		SnapshotCodec* m_codec;
+		const std::vector<opt::PlayerIdentifier>* m_own_players;
+		SnapshotScheduler::Decision m_decision;
+		std::vector<SnapshotCodec::Entry> m_entries;
+		std::vector<sf::Uint8> m_payload;
+		std::vector<sf::Uint8> m_coded;
+		std::size_t m_coded_size;
+		sf::Packet m_packet;
 	};
 
 	typedef std::unique_ptr<RemotePeer> PeerPtr;
 
 private:
+	sf::Time Now() const;
+
+	//Network thread
+	void NetworkThread();
 	void SetListening(bool enable);
-	void ExecutionThread();
+	void HandleIncomingConnections();
+	void HandleIncomingPackets();
+	void ScheduleTimeout(RemotePeer& peer);
+	void CheckTimeout(RemotePeer& peer);
+	void ReceiveFromPeer(RemotePeer& peer);
+	void ReadSocket(RemotePeer& peer);
+	bool ExtractPacket(RemotePeer& peer, sf::Packet& packet);
+	void AdmitPacket(RemotePeer& peer, const sf::Packet& packet);
+	static MessageClass ClassifyPacket(const sf::Packet& packet);
+	bool AnswerClockSync(RemotePeer& peer, const sf::Packet& packet);
+	void SchedulePublishNetworkStatistics();
+	void PublishNetworkStatistics();
+	void HandleOutgoingMessages();
+	void QueuePacket(RemotePeer& peer, const sf::Packet& packet);
+	void FlushPeer(RemotePeer& peer);
+	void DropPeer(RemotePeer& peer, DisconnectReason reason);
+	void HandleDisconnections();
+	std::string RenderMetrics() const;
+	RemotePeer* FindPeer(PeerId peer);
+	bool HasInboundRoom() const;
+	void PushInbound(InboundMessage::Type type, PeerId peer, const sf::Packet& packet = sf::Packet());
+	void FlushInboundOverflow();
+
+	//Simulation thread
+	void SimulationThread();
+	void WaitUntil(sf::Time time) const;
+	void HandleInboundMessages();
+	void HandleIncomingPacket(sf::Packet& packet, PeerId receiving_peer, sf::Time received_time);
+	bool PeerOwnsPlayer(PeerId peer, opt::PlayerIdentifier identifier) const;
+	void HandleJoin(PeerId peer, opt::SessionToken token, bool spectator);
+	bool TakeSession(opt::SessionToken token, std::vector<opt::PlayerIdentifier>& players);
+	void StartSession(PeerId peer);
+	void StartSpectating(PeerId peer);
+	bool IsSpectator(PeerId peer) const;
+	void ResumeSession(PeerId peer, opt::SessionToken token, const std::vector<opt::PlayerIdentifier>& players);
+	opt::SessionToken CreateSessionToken();
+	void HandleDisconnect(PeerId peer);
+	void ExpireSession(opt::SessionToken token);
+	void RemovePlayers(const std::vector<opt::PlayerIdentifier>& players);
+	void AddSimulatedPlayers();
+	void MoveSimulatedPlayers();
+	bool IsSimulatedViewer(PeerId peer) const;
 	void Tick();
+	void RecordStep(sf::Time jitter, sf::Time inbound_time, sf::Time simulation_time, sf::Time broadcast_time);
+	void PublishSimulationMetrics();
 	opt::PlayerIdentifier FindWinnerIdentity() const;
-	sf::Time Now() const;
 
-	void HandleIncomingPackets();
-	void HandleIncomingPacket(sf::Packet& packet, RemotePeer& receiving_peer, bool& detected_timeout);
+	void NotifyPlayerSpawn(opt::PlayerIdentifier player_identifier);
+	void NotifyPlayerInput(opt::PlayerIdentifier player_identifier, opt::InputTick newest_tick, const std::vector<opt::InputMask>& masks,
+		sf::Int64 client_send_time, sf::Time received_time, PeerId exclude);
 
 	opt::PlayerIdentifier GetFreeIdentifier() const;
-	void HandleIncomingConnections();
-	void HandleDisconnections();
-
-	void InformWorldState(sf::TcpSocket& socket);
+	void InformWorldState(PeerId peer);
 	void BroadcastMessage(const std::string& message);
-	void SendToAll(sf::Packet& packet);
+	void Send(PeerId peer, const sf::Packet& packet);
+	void SendToAll(const sf::Packet& packet, PeerId exclude = ALL_PEERS);
+	void PushOutbound(OutboundMessage::Type type, PeerId peer, PeerId exclude, const sf::Packet& packet = sf::Packet());
+	void FlushOutboundOverflow();
 	void UpdateClientState();
+	static void EncodeSnapshot(SnapshotJob& job, const std::vector<SnapshotScheduler::Candidate>& candidates, const RangeModel* model,
+		sf::Time dt, sf::Time now);
+	void LogSnapshot(PeerId peer, const SnapshotScheduler& scheduler, const SnapshotScheduler::Decision& decision, std::size_t packet_bytes);
+	void ScheduleDangers();
 	void UpdateDangers(sf::Time dt);
 
 	bool PlayerCanAttack(opt::PlayerIdentifier identifier);
@@ -76,21 +307,80 @@ private:
 	bool IsPlayerUnderWorld(opt::PlayerIdentifier identifier);
 
 private:
-	sf::Thread m_thread;
+	static constexpr std::size_t QUEUE_CAPACITY = 4096;
+
 	sf::Clock m_clock;
+	std::atomic<bool> m_waiting_thread_end;
+
+	//Connections, timeouts and match events, one channel for each thread
+	EventLog m_event_log;
+	EventLog::Channel& m_network_events;
+	EventLog::Channel& m_simulation_events;
+
+	//Neither thread waits for room in the other's queue, or each could end up waiting on the other.
+	//What does not fit goes to the producer's overflow list, in order, and is moved over as room appears
+	SpscQueue<InboundMessage> m_inbound;
+	SpscQueue<OutboundMessage> m_outbound;
+
+	//Network thread state
+	sf::Thread m_network_thread;
 	sf::TcpListener m_listener_socket;
+	sf::SocketSelector m_selector;
 	bool m_listening_state;
-	bool m_lobby;
 	sf::Time m_client_timeout;
-
 	std::size_t m_max_connected_players;
-	std::size_t m_connected_players;
+	std::vector<PeerPtr> m_peers;
+	PeerPtr m_pending_peer;
+	PeerId m_next_peer_id;
+	std::size_t m_next_peer_index;
+	std::deque<InboundMessage> m_inbound_overflow;
+	//Peer timeouts and the statistics heartbeat
+	TimingWheel m_network_timers;
+	NetworkStatistics m_network_window;
+	//Only listening when a metrics port is given
+	unsigned short m_metrics_port;
+	MetricsEndpoint m_metrics_endpoint;
+	NetworkMetrics m_network_metrics;
+	NetworkStatistics m_network_statistics;
 
+	//Simulation thread state
+	sf::Thread m_simulation_thread;
+	//Advances a fixed step at a time, so timed events follow game time rather than stalls of the thread
+	sf::Time m_simulation_time;
+	TimingWheel m_simulation_timers;
+	std::deque<OutboundMessage> m_outbound_overflow;
+	bool m_lobby;
+	bool m_winner_logged;
 	opt::PlayerCount m_player_count;
+	std::size_t m_simulated_players;
+	std::size_t m_simulated_viewers;
 	std::map<opt::PlayerIdentifier, PlayerInfo> m_player_info;
+	std::map<PeerId, std::vector<opt::PlayerIdentifier>> m_peer_players;
+	int m_alive_players;
+	std::map<PeerId, opt::SessionToken> m_peer_sessions;
+	std::map<opt::SessionToken, SuspendedSession> m_suspended_sessions;
+	//Read only peers such as spectator relays. They get every broadcast and snapshot but own no players
+	std::set<PeerId> m_spectators;
+	sf::Time m_last_danger_time;
+	float m_dangers_per_second;
+	TileGrid m_tile_grid;
+	std::vector<int> m_danger_cells;
+	std::mt19937_64 m_random;
 
-	std::vector<PeerPtr> m_peers;
-	bool m_waiting_thread_end;
+	std::map<PeerId, SnapshotScheduler> m_snapshot_schedulers;
+	std::vector<SnapshotScheduler::Candidate> m_snapshot_candidates;
+	std::ofstream m_snapshot_log;
 
-	int m_alive_players;
+	bool m_compress_snapshots;
+	RangeModel m_snapshot_model;
+	RangeModel::Histogram m_snapshot_histogram;
+	std::map<PeerId, SnapshotCodec> m_snapshot_codecs;
+	std::vector<SnapshotJob> m_snapshot_jobs;
+	JobSystem m_jobs;
+
+	TickStatistics m_step_window;
+	TickStatistics m_tick_statistics;
+	SimulationMetrics m_simulation_metrics;
+	SimulationMetrics m_published_simulation_metrics;
+	mutable sf::Mutex m_statistics_mutex;
 };
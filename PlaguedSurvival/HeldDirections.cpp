@@ -0,0 +1,90 @@
+#include "HeldDirections.hpp"
+
+/**
+ * Vilandas Morrissey - D00218436
+ */
+
+namespace
+{
+	//Indexed by the squared length of the summed direction, which is 0, 1 or 2
+	const float InverseLengths[3] = { 0.f, 1.f, 0.70710678f };
+}
+
+HeldDirections::HeldDirections()
+	: m_ages()
+	, m_held(0)
+{
+}
+
+//Restarts the hold time if the direction is already held. Anything that is not a cardinal direction is ignored.
+void HeldDirections::Add(sf::Vector2i direction)
+{
+	const int index = GetIndex(direction);
+	if (index < 0) return;
+
+	m_ages[index] = 0.f;
+	m_held |= 1 << index;
+}
+
+void HeldDirections::Remove(sf::Vector2i direction)
+{
+	const int index = GetIndex(direction);
+	if (index < 0) return;
+
+	m_held &= ~(1 << index);
+}
+
+/// <summary>
+/// Ages the held directions and drops those held for longer than HOLD_TIME
+/// </summary>
+/// <returns>True if any direction was dropped</returns>
+bool HeldDirections::Update(float dt)
+{
+	const sf::Uint8 held = m_held;
+
+	for (int index = 0; index < kDirectionCount; ++index)
+	{
+		if ((held & 1 << index) == 0) continue;
+
+		m_ages[index] += dt;
+		if (m_ages[index] > HOLD_TIME)
+		{
+			m_held &= ~(1 << index);
+		}
+	}
+
+	return m_held != held;
+}
+
+bool HeldDirections::IsEmpty() const
+{
+	return m_held == 0;
+}
+
+/// <summary>
+/// The sum of the held directions as a unit vector, opposite directions cancel out
+/// </summary>
+sf::Vector2f HeldDirections::GetUnit() const
+{
+	const int x = (m_held >> kRight & 1) - (m_held >> kLeft & 1);
+	const int y = (m_held >> kDown & 1) - (m_held >> kUp & 1);
+	const float inverse_length = InverseLengths[x * x + y * y];
+
+	return { x * inverse_length, y * inverse_length };
+}
+
+/// <returns>The slot for a cardinal unit vector, or -1 for anything else</returns>
+int HeldDirections::GetIndex(sf::Vector2i direction)
+{
+	if (direction.y == 0)
+	{
+		if (direction.x == -1) return kLeft;
+		if (direction.x == 1) return kRight;
+	}
+	else if (direction.x == 0)
+	{
+		if (direction.y == -1) return kUp;
+		if (direction.y == 1) return kDown;
+	}
+	return -1;
+}
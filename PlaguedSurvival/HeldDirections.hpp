@@ -0,0 +1,46 @@
+#pragma once
+#include <array>
+#include <SFML/Config.hpp>
+#include <SFML/System/Vector2.hpp>
+
+/**
+ * Vilandas Morrissey - D00218436
+ */
+
+/// <summary>
+/// The cardinal directions an entity is being moved in. Input adds a direction every frame it is held,
+/// and a direction that has not been added for HOLD_TIME is dropped. Each direction has a fixed slot
+/// with its age, so nothing here allocates.
+/// </summary>
+class HeldDirections
+{
+public:
+	static constexpr float HOLD_TIME = 0.02f;
+
+public:
+	HeldDirections();
+
+	void Add(sf::Vector2i direction);
+	void Remove(sf::Vector2i direction);
+	bool Update(float dt);
+
+	bool IsEmpty() const;
+	sf::Vector2f GetUnit() const;
+
+private:
+	enum Direction
+	{
+		kLeft,
+		kRight,
+		kUp,
+		kDown,
+		kDirectionCount
+	};
+
+	static int GetIndex(sf::Vector2i direction);
+
+private:
+	std::array<float, kDirectionCount> m_ages;
+	//One bit per Direction
+	sf::Uint8 m_held;
+};
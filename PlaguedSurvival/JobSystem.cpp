@@ -0,0 +1,181 @@
+#include "JobSystem.hpp"
+
+#include <algorithm>
+#include <thread>
+
+/**
+ * Vilandas Morrissey - D00218436
+ */
+
+JobSystem::JobSystem(std::size_t worker_count)
+	: m_job(nullptr)
+	, m_remaining(0)
+	, m_generation(0)
+	, m_quit(false)
+{
+	for (std::size_t i = 0; i <= worker_count; ++i)
+	{
+		m_queues.emplace_back(new WorkQueue());
+	}
+
+	for (std::size_t i = 1; i <= worker_count; ++i)
+	{
+		m_threads.emplace_back(new sf::Thread([this, i]()
+			{
+				WorkerThread(i);
+			}));
+		m_threads.back()->launch();
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_wake_mutex);
+		m_quit = true;
+	}
+	m_wake.notify_all();
+
+	for (auto& thread : m_threads)
+	{
+		thread->wait();
+	}
+}
+
+std::size_t JobSystem::GetWorkerCount() const
+{
+	return m_threads.size();
+}
+
+/// <summary>
+/// Runs job for every index below count, in batches of batch_size indices.
+/// Small loops, or a pool without workers, run straight through on the calling thread.
+/// </summary>
+void JobSystem::ParallelFor(std::size_t count, std::size_t batch_size, const std::function<void(std::size_t)>& job)
+{
+	batch_size = std::max<std::size_t>(1, batch_size);
+
+	if (m_threads.empty() || count <= batch_size)
+	{
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			job(i);
+		}
+		return;
+	}
+
+	m_job = &job;
+	m_remaining = count;
+
+	//Deal the batches out round robin, neighbouring indices tend to cost the same
+	std::size_t queue_index = 0;
+	for (std::size_t begin = 0; begin < count; begin += batch_size)
+	{
+		WorkQueue& queue = *m_queues[queue_index];
+		{
+			std::lock_guard<std::mutex> lock(queue.m_mutex);
+			queue.m_batches.push_back(Batch{ begin, std::min(count, begin + batch_size) });
+		}
+		queue_index = (queue_index + 1) % m_queues.size();
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_wake_mutex);
+		m_generation++;
+	}
+	m_wake.notify_all();
+
+	while (RunBatch(0))
+	{
+	}
+
+	//Stolen batches may still be running on the workers
+	while (m_remaining > 0)
+	{
+		std::this_thread::yield();
+	}
+
+	m_job = nullptr;
+}
+
+/// <summary>
+/// Leaves a core each for the calling thread and the given number of other busy threads. Always at least one worker.
+/// </summary>
+std::size_t JobSystem::GetDefaultWorkerCount(std::size_t reserved_threads)
+{
+	const std::size_t cores = std::thread::hardware_concurrency();
+	return cores > reserved_threads + 1 ? cores - reserved_threads - 1 : 1;
+}
+
+void JobSystem::WorkerThread(std::size_t queue_index)
+{
+	std::size_t generation = 0;
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_wake_mutex);
+			m_wake.wait(lock, [&]()
+				{
+					return m_quit || m_generation != generation;
+				});
+
+			if (m_quit)
+			{
+				return;
+			}
+			generation = m_generation;
+		}
+
+		while (RunBatch(queue_index))
+		{
+		}
+	}
+}
+
+bool JobSystem::RunBatch(std::size_t queue_index)
+{
+	Batch batch;
+	if (!TakeBatch(queue_index, batch))
+	{
+		return false;
+	}
+
+	for (std::size_t i = batch.m_begin; i < batch.m_end; ++i)
+	{
+		(*m_job)(i);
+	}
+
+	m_remaining -= batch.m_end - batch.m_begin;
+	return true;
+}
+
+//Own work is taken from the front, stolen work from the back, so owner and thief rarely want the same batch
+
+bool JobSystem::TakeBatch(std::size_t queue_index, Batch& batch)
+{
+	{
+		WorkQueue& own = *m_queues[queue_index];
+		std::lock_guard<std::mutex> lock(own.m_mutex);
+		if (!own.m_batches.empty())
+		{
+			batch = own.m_batches.front();
+			own.m_batches.pop_front();
+			return true;
+		}
+	}
+
+	for (std::size_t i = 1; i < m_queues.size(); ++i)
+	{
+		WorkQueue& victim = *m_queues[(queue_index + i) % m_queues.size()];
+		std::lock_guard<std::mutex> lock(victim.m_mutex);
+		if (!victim.m_batches.empty())
+		{
+			batch = victim.m_batches.back();
+			victim.m_batches.pop_back();
+			return true;
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <SFML/System/Thread.hpp>
+
+/**
+ * Vilandas Morrissey - D00218436
+ */
+
+/// <summary>
+/// Fixed pool of worker threads for splitting a loop across cores. Every worker has its own queue of
+/// index ranges and steals from the back of the others' once its own runs dry, so uneven jobs still balance.
+/// The calling thread works too and ParallelFor only returns once every index has run.
+/// Jobs must only write to state owned by their index for the result to be deterministic.
+/// </summary>
+class JobSystem
+{
+public:
+	explicit JobSystem(std::size_t worker_count);
+	~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	std::size_t GetWorkerCount() const;
+	void ParallelFor(std::size_t count, std::size_t batch_size, const std::function<void(std::size_t)>& job);
+
+	static std::size_t GetDefaultWorkerCount(std::size_t reserved_threads);
+
+private:
+	struct Batch
+	{
+		std::size_t m_begin;
+		std::size_t m_end;
+	};
+
+	struct WorkQueue
+	{
+		std::mutex m_mutex;
+		std::deque<Batch> m_batches;
+	};
+
+private:
+	void WorkerThread(std::size_t queue_index);
+	bool RunBatch(std::size_t queue_index);
+	bool TakeBatch(std::size_t queue_index, Batch& batch);
+
+private:
+	//Queue 0 belongs to the thread calling ParallelFor
+	std::vector<std::unique_ptr<WorkQueue>> m_queues;
+	std::vector<std::unique_ptr<sf::Thread>> m_threads;
+
+	const std::function<void(std::size_t)>* m_job;
+	std::atomic<std::size_t> m_remaining;
+
+	std::mutex m_wake_mutex;
+	std::condition_variable m_wake;
+	std::size_t m_generation;
+	bool m_quit;
+};
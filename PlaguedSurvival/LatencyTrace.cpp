@@ -0,0 +1,86 @@
+#include "LatencyTrace.hpp"
+
+#include <algorithm>
+
+/**
+ * Vilandas Morrissey - D00218436
+ */
+
+namespace
+{
+	const char* HopNames[] = { "client_send", "server_queue", "server_relay", "remote_render", "total" };
+
+	//Nearest rank, the samples must be sorted
+	sf::Int64 Percentile(const std::vector<sf::Int64>& samples, float percentile)
+	{
+		const std::size_t rank = static_cast<std::size_t>(percentile / 100.f * (samples.size() - 1) + 0.5f);
+		return samples[std::min(rank, samples.size() - 1)];
+	}
+}
+
+LatencyTrace::LatencyTrace(const std::string& trace_file, const std::string& summary_file)
+	: m_trace(trace_file, std::fstream::out)
+	, m_summary_file(summary_file)
+{
+	m_trace << "player,tick,client_send_us,server_receive_us,server_relay_us,remote_receive_us,remote_render_us\n";
+}
+
+LatencyTrace::~LatencyTrace()
+{
+	WriteSummary();
+}
+
+/// <summary>
+/// The input is applied during the next update, so it first shows on the next frame rendered
+/// </summary>
+void LatencyTrace::OnReceived(const Stamps& stamps)
+{
+	m_pending.emplace_back(stamps);
+}
+
+void LatencyTrace::OnRendered(sf::Time render_time)
+{
+	for (const Stamps& stamps : m_pending)
+	{
+		m_samples[kClientSend].emplace_back((stamps.m_server_receive - stamps.m_client_send).asMicroseconds());
+		m_samples[kServerQueue].emplace_back((stamps.m_server_relay - stamps.m_server_receive).asMicroseconds());
+		m_samples[kServerRelay].emplace_back((stamps.m_remote_receive - stamps.m_server_relay).asMicroseconds());
+		m_samples[kRemoteRender].emplace_back((render_time - stamps.m_remote_receive).asMicroseconds());
+		m_samples[kTotal].emplace_back((render_time - stamps.m_client_send).asMicroseconds());
+
+		m_trace << stamps.m_player << ','
+			<< stamps.m_tick << ','
+			<< stamps.m_client_send.asMicroseconds() << ','
+			<< stamps.m_server_receive.asMicroseconds() << ','
+			<< stamps.m_server_relay.asMicroseconds() << ','
+			<< stamps.m_remote_receive.asMicroseconds() << ','
+			<< render_time.asMicroseconds() << '\n';
+	}
+
+	m_pending.clear();
+}
+
+//Hops measured across machines are only as good as the clock offsets, a few hundred microseconds on a LAN
+void LatencyTrace::WriteSummary()
+{
+	if (m_samples[kTotal].empty())
+	{
+		return;
+	}
+
+	std::ofstream summary(m_summary_file, std::fstream::out);
+	summary << "hop,count,p50_us,p90_us,p99_us,max_us\n";
+
+	for (int hop = 0; hop < kHopCount; ++hop)
+	{
+		std::vector<sf::Int64>& samples = m_samples[hop];
+		std::sort(samples.begin(), samples.end());
+
+		summary << HopNames[hop] << ','
+			<< samples.size() << ','
+			<< Percentile(samples, 50.f) << ','
+			<< Percentile(samples, 90.f) << ','
+			<< Percentile(samples, 99.f) << ','
+			<< samples.back() << '\n';
+	}
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <array>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <SFML/System/Time.hpp>
+
+#include "NetworkOptimisations.hpp"
+
+/**
+ * Vilandas Morrissey - D00218436
+ */
+
+/// <summary>
+/// Follows remote players' input packets from the keypress to the first frame drawn after they arrive.
+/// Every stamp is on the server's clock: the sending client converts its own with its clock offset,
+/// the server stamps receive and relay, and the receiving client converts arrival and render times.
+/// Each trace is written as a row of the trace file, and percentiles per hop are written to the
+/// summary file when the trace is destroyed.
+/// </summary>
+class LatencyTrace
+{
+public:
+	//A player identifier and input tick identify one trace
+	struct Stamps
+	{
+		opt::PlayerIdentifier m_player;
+		opt::InputTick m_tick;
+		sf::Time m_client_send;
+		sf::Time m_server_receive;
+		sf::Time m_server_relay;
+		sf::Time m_remote_receive;
+	};
+
+public:
+	LatencyTrace(const std::string& trace_file, const std::string& summary_file);
+	~LatencyTrace();
+
+	void OnReceived(const Stamps& stamps);
+	void OnRendered(sf::Time render_time);
+
+private:
+	enum Hop
+	{
+		kClientSend,
+		kServerQueue,
+		kServerRelay,
+		kRemoteRender,
+		kTotal,
+		kHopCount
+	};
+
+private:
+	void WriteSummary();
+
+private:
+	std::ofstream m_trace;
+	std::string m_summary_file;
+	std::vector<Stamps> m_pending;
+	std::array<std::vector<sf::Int64>, kHopCount> m_samples;
+};
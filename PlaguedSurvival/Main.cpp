@@ -1,14 +1,55 @@
+#include <fstream>
 #include <iostream>
+#include <string>
 #include "Application.hpp"
+#include "Benchmarks.hpp"
+#include "CollisionTestScene.hpp"
+#include "EventLog.hpp"
+#include "NetworkProtocol.hpp"
+#include "SpectatorRelay.hpp"
 
 /**
  * Vilandas Morrissey - D00218436
  */
 
-int main()
+//"relay [server address] [delay seconds]" runs a headless spectator relay instead of the game,
+//"decode-log [file]" prints a server event log as CSV, "collision-test" runs the collision scene and benchmark,
+//"benchmark [name]" runs one of the microbenchmarks
+int main(int argc, char* argv[])
 {
 	try
 	{
+		if (argc > 1 && std::string(argv[1]) == "benchmark")
+		{
+			return Benchmarks::Run(argc > 2 ? argv[2] : "", std::cout) ? 0 : 1;
+		}
+
+		if (argc > 1 && std::string(argv[1]) == "collision-test")
+		{
+			return CollisionTestScene::Run(std::cout) ? 0 : 1;
+		}
+
+		if (argc > 1 && std::string(argv[1]) == "decode-log")
+		{
+			std::ifstream input(argc > 2 ? argv[2] : "server_events.log", std::ios::binary);
+			if (!EventLog::Decode(input, std::cout))
+			{
+				std::cout << "\nNot an event log, or it ends part way through a block" << std::endl;
+				return 1;
+			}
+			return 0;
+		}
+
+		if (argc > 1 && std::string(argv[1]) == "relay")
+		{
+			const sf::IpAddress server_address(argc > 2 ? argv[2] : "127.0.0.1");
+			const sf::Time delay = sf::seconds(argc > 3 ? std::stof(argv[3]) : 0.f);
+
+			SpectatorRelay relay(server_address, SERVER_PORT, RELAY_PORT, delay);
+			relay.Run();
+			return 0;
+		}
+
 		Application app;
 		app.Run();
 	}
@@ -16,4 +57,4 @@ int main()
 	{
 		std::cout << "\nEXCEPTION: " << e.what() << std::endl;
 	}
-}
\ No newline at end of file
+}
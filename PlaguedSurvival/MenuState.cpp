@@ -50,8 +50,17 @@ MenuState::MenuState(StateStack& stack, Context context)
 		RequestStackPush(StateID::kJoinGame);
 	});
 
+	auto spectate_button = std::make_shared<GUI::Button>(context);
+	spectate_button->setPosition(100, 450);
+	spectate_button->SetText("Spectate");
+	spectate_button->SetCallback([this]()
+	{
+		RequestStackPop();
+		RequestStackPush(StateID::kSpectateGame);
+	});
+
 	auto settings_button = std::make_shared<GUI::Button>(context);
-	settings_button->setPosition(100, 450);
+	settings_button->setPosition(100, 500);
 	settings_button->SetText("Settings");
 	settings_button->SetCallback([this]()
 	{
@@ -59,7 +68,7 @@ MenuState::MenuState(StateStack& stack, Context context)
 	});
 
 	auto exit_button = std::make_shared<GUI::Button>(context);
-	exit_button->setPosition(100, 500);
+	exit_button->setPosition(100, 550);
 	exit_button->SetText("Exit");
 	exit_button->SetCallback([this]()
 	{
@@ -69,6 +78,7 @@ MenuState::MenuState(StateStack& stack, Context context)
 	m_gui_container.Pack(play_button);
 	m_gui_container.Pack(host_play_button);
 	m_gui_container.Pack(join_play_button);
+	m_gui_container.Pack(spectate_button);
 	m_gui_container.Pack(settings_button);
 	m_gui_container.Pack(exit_button);
 
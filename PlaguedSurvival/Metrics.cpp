@@ -0,0 +1,97 @@
+#include "Metrics.hpp"
+
+/**
+ * Vilandas Morrissey - D00218436
+ */
+
+/// <summary>
+/// </summary>
+/// <param name="bounds">Upper bounds of the buckets in increasing order, +Inf is added on the end</param>
+MetricsHistogram::MetricsHistogram(const std::vector<double>& bounds)
+	: m_bounds(bounds)
+	, m_buckets(bounds.size() + 1, 0)
+	, m_sum(0.0)
+	, m_count(0)
+{
+}
+
+void MetricsHistogram::Observe(double value)
+{
+	for (std::size_t i = 0; i < m_bounds.size(); ++i)
+	{
+		if (value <= m_bounds[i])
+		{
+			m_buckets[i]++;
+		}
+	}
+
+	m_buckets.back()++;
+	m_sum += value;
+	m_count++;
+}
+
+const std::vector<double>& MetricsHistogram::GetBounds() const
+{
+	return m_bounds;
+}
+
+const std::vector<sf::Uint64>& MetricsHistogram::GetBuckets() const
+{
+	return m_buckets;
+}
+
+double MetricsHistogram::GetSum() const
+{
+	return m_sum;
+}
+
+sf::Uint64 MetricsHistogram::GetCount() const
+{
+	return m_count;
+}
+
+//Counters are whole numbers and would otherwise switch to exponents past six digits
+MetricsText::MetricsText()
+{
+	m_text.precision(15);
+}
+
+void MetricsText::Describe(const std::string& name, const std::string& type, const std::string& help)
+{
+	m_text << "# HELP " << name << ' ' << help << '\n'
+		<< "# TYPE " << name << ' ' << type << '\n';
+}
+
+/// <param name="labels">Label pairs without the braces, such as type="PlayerInput"</param>
+void MetricsText::Sample(const std::string& name, double value, const std::string& labels)
+{
+	m_text << name;
+	if (!labels.empty())
+	{
+		m_text << '{' << labels << '}';
+	}
+	m_text << ' ' << value << '\n';
+}
+
+void MetricsText::Histogram(const std::string& name, const std::string& help, const MetricsHistogram& histogram)
+{
+	Describe(name, "histogram", help);
+
+	const std::vector<double>& bounds = histogram.GetBounds();
+	const std::vector<sf::Uint64>& buckets = histogram.GetBuckets();
+	for (std::size_t i = 0; i < bounds.size(); ++i)
+	{
+		std::ostringstream bound;
+		bound << bounds[i];
+		Sample(name + "_bucket", static_cast<double>(buckets[i]), "le=\"" + bound.str() + "\"");
+	}
+
+	Sample(name + "_bucket", static_cast<double>(buckets.back()), "le=\"+Inf\"");
+	Sample(name + "_sum", histogram.GetSum());
+	Sample(name + "_count", static_cast<double>(histogram.GetCount()));
+}
+
+std::string MetricsText::GetText() const
+{
+	return m_text.str();
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <sstream>
+#include <string>
+#include <vector>
+#include <SFML/Config.hpp>
+
+/**
+ * Vilandas Morrissey - D00218436
+ */
+
+/// <summary>
+/// Cumulative histogram in the Prometheus sense: each bucket counts every observation at or below its bound.
+/// </summary>
+class MetricsHistogram
+{
+public:
+	explicit MetricsHistogram(const std::vector<double>& bounds);
+
+	void Observe(double value);
+
+	const std::vector<double>& GetBounds() const;
+	const std::vector<sf::Uint64>& GetBuckets() const;
+	double GetSum() const;
+	sf::Uint64 GetCount() const;
+
+private:
+	std::vector<double> m_bounds;
+	std::vector<sf::Uint64> m_buckets;
+	double m_sum;
+	sf::Uint64 m_count;
+};
+
+/// <summary>
+/// Builds a page in the Prometheus text format. Every metric starts with Describe,
+/// followed by one or more samples.
+/// </summary>
+class MetricsText
+{
+public:
+	MetricsText();
+
+	void Describe(const std::string& name, const std::string& type, const std::string& help);
+	void Sample(const std::string& name, double value, const std::string& labels = "");
+	void Histogram(const std::string& name, const std::string& help, const MetricsHistogram& histogram);
+
+	std::string GetText() const;
+
+private:
+	std::ostringstream m_text;
+};
@@ -0,0 +1,116 @@
+#include "MetricsEndpoint.hpp"
+
+#include <algorithm>
+#include <SFML/Network/IpAddress.hpp>
+
+/**
+ * Vilandas Morrissey - D00218436
+ */
+
+namespace
+{
+	//A scraper sends a short request and reads the answer straight away, anything slower is dropped
+	const std::size_t MaxConnections = 4;
+	const std::size_t MaxRequestSize = 4096;
+	const sf::Time ConnectionTimeout = sf::seconds(2.f);
+}
+
+MetricsEndpoint::MetricsEndpoint()
+	: m_listening(false)
+	, m_pending(new Connection())
+{
+	m_listener.setBlocking(false);
+}
+
+/// <summary>
+/// Only binds to 127.0.0.1, the metrics are not meant to be reachable from other machines
+/// </summary>
+bool MetricsEndpoint::Listen(unsigned short port)
+{
+	m_listening = m_listener.listen(port, sf::IpAddress::LocalHost) == sf::Socket::Done;
+	return m_listening;
+}
+
+/// <summary>
+/// Accepts new connections and moves the open ones along, call it regularly
+/// </summary>
+/// <param name="render">Builds the page, only called once a full request has arrived</param>
+void MetricsEndpoint::Serve(const std::function<std::string()>& render)
+{
+	if (!m_listening)
+	{
+		return;
+	}
+
+	Accept();
+
+	m_connections.erase(std::remove_if(m_connections.begin(), m_connections.end(), [&](ConnectionPtr& connection)
+		{
+			return !Update(*connection, render);
+		}), m_connections.end());
+}
+
+void MetricsEndpoint::Accept()
+{
+	while (m_connections.size() < MaxConnections && m_listener.accept(m_pending->m_socket) == sf::Socket::Done)
+	{
+		m_pending->m_socket.setBlocking(false);
+		m_pending->m_sent = 0;
+		m_pending->m_opened = m_clock.getElapsedTime();
+
+		m_connections.emplace_back(std::move(m_pending));
+		m_pending.reset(new Connection());
+	}
+}
+
+/// <returns>False once the connection is finished with</returns>
+bool MetricsEndpoint::Update(Connection& connection, const std::function<std::string()>& render)
+{
+	if (m_clock.getElapsedTime() - connection.m_opened > ConnectionTimeout)
+	{
+		return false;
+	}
+
+	//Read until the blank line that ends the headers, the body of a GET is empty
+	if (connection.m_response.empty())
+	{
+		char buffer[1024];
+		std::size_t received = 0;
+		const sf::Socket::Status status = connection.m_socket.receive(buffer, sizeof(buffer), received);
+		if (status == sf::Socket::Disconnected || status == sf::Socket::Error)
+		{
+			return false;
+		}
+
+		connection.m_request.append(buffer, received);
+		if (connection.m_request.size() > MaxRequestSize)
+		{
+			return false;
+		}
+
+		if (connection.m_request.find("\r\n\r\n") == std::string::npos)
+		{
+			return true;
+		}
+
+		const std::string body = render();
+		connection.m_response =
+			"HTTP/1.1 200 OK\r\n"
+			"Content-Type: text/plain; version=0.0.4\r\n"
+			"Content-Length: " + std::to_string(body.size()) + "\r\n"
+			"Connection: close\r\n"
+			"\r\n" + body;
+	}
+
+	std::size_t sent = 0;
+	const sf::Socket::Status status = connection.m_socket.send(connection.m_response.data() + connection.m_sent,
+		connection.m_response.size() - connection.m_sent, sent);
+	connection.m_sent += sent;
+
+	if (status == sf::Socket::Disconnected || status == sf::Socket::Error)
+	{
+		return false;
+	}
+
+	return connection.m_sent < connection.m_response.size();
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <SFML/Network/TcpListener.hpp>
+#include <SFML/Network/TcpSocket.hpp>
+#include <SFML/System/Clock.hpp>
+
+/**
+ * Vilandas Morrissey - D00218436
+ */
+
+/// <summary>
+/// Minimal HTTP listener on the loopback interface for a local agent to scrape metrics from.
+/// Every request, whatever its path, is answered with the page from the render callback and the
+/// connection is closed. Nothing blocks, so it can be served from a thread with other work.
+/// </summary>
+class MetricsEndpoint
+{
+public:
+	MetricsEndpoint();
+
+	bool Listen(unsigned short port);
+	void Serve(const std::function<std::string()>& render);
+
+private:
+	struct Connection
+	{
+		sf::TcpSocket m_socket;
+		std::string m_request;
+		std::string m_response;
+		std::size_t m_sent;
+		sf::Time m_opened;
+	};
+
+	typedef std::unique_ptr<Connection> ConnectionPtr;
+
+private:
+	void Accept();
+	bool Update(Connection& connection, const std::function<std::string()>& render);
+
+private:
+	sf::Clock m_clock;
+	sf::TcpListener m_listener;
+	bool m_listening;
+	ConnectionPtr m_pending;
+	std::vector<ConnectionPtr> m_connections;
+};
@@ -8,16 +8,22 @@
 
 #include <fstream>
 #include <iostream>
+#include <unordered_set>
 #include <SFML/Graphics/RectangleShape.hpp>
 #include <SFML/Network/Packet.hpp>
 
-#include "DangerTrigger.hpp"
 #include "PlayerColors.hpp"
 
 /**
  * Vilandas Morrissey - D00218436
  */
 
+namespace
+{
+	//Lobby names per column before the list wraps into another column
+	const std::size_t LobbyRows = 18;
+}
+
 sf::IpAddress GetAddressFromFile()
 {
 	{
@@ -37,6 +43,93 @@ sf::IpAddress GetAddressFromFile()
 	return local_address;
 }
 
+struct LobbySettings
+{
+	std::size_t m_max_players;
+	std::size_t m_simulated_players;
+	std::size_t m_simulated_viewers;
+	bool m_log_snapshots;
+	bool m_compress_snapshots;
+	unsigned short m_metrics_port;
+};
+
+LobbySettings GetLobbySettingsFromFile()
+{
+	LobbySettings settings;
+	settings.m_max_players = 15;
+	settings.m_simulated_players = 0;
+	settings.m_simulated_viewers = 0;
+	settings.m_log_snapshots = false;
+	settings.m_compress_snapshots = true;
+	settings.m_metrics_port = 0;
+
+	{
+		//Try to open existing file lobby.txt: max players, simulated players, then optionally 1 to log snapshot scheduling
+		//and 0 to send snapshots without range coding, then how many simulated viewers to encode snapshots for,
+		//then a port to serve metrics on for a local scraper, 0 for none
+		std::ifstream input_file("lobby.txt");
+		std::size_t max_players;
+		std::size_t simulated_players;
+		if (input_file >> max_players >> simulated_players)
+		{
+			settings.m_max_players = std::min(max_players, MAX_LOBBY_PLAYERS);
+			settings.m_simulated_players = std::min(simulated_players, MAX_LOBBY_PLAYERS);
+
+			int log_snapshots;
+			if (input_file >> log_snapshots)
+			{
+				settings.m_log_snapshots = log_snapshots != 0;
+			}
+
+			int compress_snapshots;
+			if (input_file >> compress_snapshots)
+			{
+				settings.m_compress_snapshots = compress_snapshots != 0;
+			}
+
+			std::size_t simulated_viewers;
+			if (input_file >> simulated_viewers)
+			{
+				settings.m_simulated_viewers = std::min(simulated_viewers, MAX_SIMULATED_VIEWERS);
+			}
+
+			unsigned short metrics_port;
+			if (input_file >> metrics_port)
+			{
+				settings.m_metrics_port = metrics_port;
+			}
+			return settings;
+		}
+	}
+
+	//If open/read failed, create a new file
+	std::ofstream output_file("lobby.txt");
+	output_file << settings.m_max_players << " " << settings.m_simulated_players << " " << settings.m_log_snapshots << " " << settings.m_compress_snapshots
+		<< " " << settings.m_simulated_viewers << " " << settings.m_metrics_port;
+	return settings;
+}
+
+//Spectators usually watch through a relay, see SpectatorRelay
+std::pair<sf::IpAddress, unsigned short> GetSpectateAddressFromFile()
+{
+	{
+		//Try to open existing file spectate.txt: address then port
+		std::ifstream input_file("spectate.txt");
+		std::string ip_address;
+		unsigned short port;
+		if (input_file >> ip_address >> port)
+		{
+			return std::make_pair(sf::IpAddress(ip_address), port);
+		}
+	}
+
+	//If open/read failed, create a new file
+	std::ofstream output_file("spectate.txt");
+	std::string local_address = "127.0.0.1";
+	output_file << local_address << " " << RELAY_PORT;
+	return std::make_pair(sf::IpAddress(local_address), RELAY_PORT);
+}
+
 unsigned int GetGamesWonFromFile()
 {
 	{
@@ -55,7 +148,31 @@ unsigned int GetGamesWonFromFile()
 	return 0;
 }
 
-MultiplayerGameState::MultiplayerGameState(StateStack& stack, Context context, bool is_host)
+bool GetTraceLatencyFromFile()
+{
+	{
+		//Try to open existing file trace.txt: 1 to trace input latency to latency_trace.csv
+		std::ifstream input_file("trace.txt");
+		int trace_latency;
+		if (input_file >> trace_latency)
+		{
+			return trace_latency != 0;
+		}
+	}
+
+	//If open/read failed, create a new file
+	std::ofstream output_file("trace.txt");
+	output_file << 0;
+	return false;
+}
+
+MultiplayerGameState::StateUpdateStatistics::StateUpdateStatistics()
+	: m_count(0)
+	, m_players(0)
+{
+}
+
+MultiplayerGameState::MultiplayerGameState(StateStack& stack, Context context, bool is_host, bool is_spectator)
 	: State(stack, context)
 	, m_world(*context.window, *context.textures, *context.fonts, *context.sounds, *context.camera, true)
 	, m_window(*context.window)
@@ -64,20 +181,31 @@ MultiplayerGameState::MultiplayerGameState(StateStack& stack, Context context, b
 	, m_music(*context.music)
 	, m_camera(m_window.getDefaultView())
 	, m_lobby_gui(m_window, m_camera)
+	, m_lobby_column_width(600.f)
+	, m_lobby_character_size(20u)
 	, m_bytes_received()
 	, m_bytes_sent()
+	, m_state_updates()
 	, m_games_won(GetGamesWonFromFile())
 	, m_connected(false)
+	, m_reconnecting(false)
+	, m_session_token(0)
+	, m_network_status(ClientNetwork::Status::kConnecting)
 	, m_game_server(nullptr)
 	, m_active_state(true)
 	, m_has_focus(true)
 	, m_host(is_host)
+	, m_spectator(is_spectator)
 	, m_lobby(true)
 	, m_client_timeout(sf::seconds(2.f))
-	, m_time_since_last_packet(sf::seconds(0.f))
 {
 	m_background_sprite.setTexture(context.textures->Get(Textures::kTitleScreen));
 
+	if (GetTraceLatencyFromFile())
+	{
+		m_latency_trace.reset(new LatencyTrace("latency_trace.csv", "latency_summary.csv"));
+	}
+
 	m_broadcast_text.setFont(context.fonts->Get(Fonts::Main));
 	m_broadcast_text.setPosition(1024.f / 2, 100.f);
 
@@ -89,13 +217,6 @@ MultiplayerGameState::MultiplayerGameState(StateStack& stack, Context context, b
 	Utility::CentreOrigin(m_failed_connection_text);
 	m_failed_connection_text.setPosition(m_window.getSize().x / 2.f, m_window.getSize().y / 2.f);
 
-	//Render an "establishing connection" frame for user feedback
-	m_window.clear(sf::Color::Black);
-	m_window.draw(m_failed_connection_text);
-	m_window.display();
-	m_failed_connection_text.setString("Could not connect to the remote server");
-	Utility::CentreOrigin(m_failed_connection_text);
-
 	m_lobby_text.setFont(context.fonts->Get(Fonts::Main));
 	m_lobby_text.setString("Lobby");
 	m_lobby_text.setCharacterSize(35);
@@ -116,9 +237,20 @@ MultiplayerGameState::MultiplayerGameState(StateStack& stack, Context context, b
 	m_statistics_text.setCharacterSize(10u);
 
 	sf::IpAddress ip;
-	if (m_host)
+	unsigned short port = SERVER_PORT;
+	if (m_spectator)
 	{
-		m_game_server.reset(new GameServer());
+		const std::pair<sf::IpAddress, unsigned short> address = GetSpectateAddressFromFile();
+		ip = address.first;
+		port = address.second;
+		m_waiting_for_host_text.setString("Spectating, waiting for the host to start the game");
+		Utility::CentreOrigin(m_waiting_for_host_text);
+	}
+	else if (m_host)
+	{
+		const LobbySettings lobby = GetLobbySettingsFromFile();
+		m_game_server.reset(new GameServer(lobby.m_max_players, lobby.m_simulated_players, lobby.m_simulated_viewers,
+			lobby.m_log_snapshots, lobby.m_compress_snapshots, lobby.m_metrics_port));
 		ip = "127.0.0.1";
 
 		auto start_button = std::make_shared<GUI::Button>(context);
@@ -138,16 +270,9 @@ MultiplayerGameState::MultiplayerGameState(StateStack& stack, Context context, b
 		ip = GetAddressFromFile();
 	}
 
-	if (m_socket.connect(ip, SERVER_PORT, sf::seconds(5.f)) == sf::TcpSocket::Done)
-	{
-		m_connected = true;
-	}
-	else
-	{
-		m_failed_connection_clock.restart();
-	}
-
-	m_socket.setBlocking(false);
+	//Connecting happens on the network thread, Update() watches for the result
+	m_server_address = ip;
+	m_network.reset(new ClientNetwork(ip, port));
 }
 
 void MultiplayerGameState::Draw()
@@ -161,9 +286,11 @@ void MultiplayerGameState::Draw()
 		{
 			m_window.draw(m_background_sprite);
 
+			const std::size_t columns = std::max<std::size_t>(1, (m_players.size() + LobbyRows - 1) / LobbyRows);
+
 			sf::RectangleShape backgroundShape;
 			backgroundShape.setFillColor(sf::Color(0, 0, 0, 200));
-			backgroundShape.setSize(sf::Vector2f(600, 800));
+			backgroundShape.setSize(sf::Vector2f(std::max(600.f, m_lobby_column_width * columns), 800));
 			Utility::CentreOrigin(backgroundShape);
 			backgroundShape.setPosition(960, 540);
 
@@ -174,10 +301,10 @@ void MultiplayerGameState::Draw()
 			for (const auto& pair : m_players)
 			{
 				const sf::Vector2f position = pair.second.m_name->getPosition();
-				sf::Text text("Wins: " + std::to_string(pair.second.m_games_won), m_font_holder.Get(Fonts::Main), 16);
+				sf::Text text("Wins: " + std::to_string(pair.second.m_games_won), m_font_holder.Get(Fonts::Main), m_lobby_character_size - 4);
 				Utility::CentreOrigin(text);
 				text.setFillColor(pair.second.m_name->GetFillColor());
-				text.setPosition(position.x + 200, position.y);
+				text.setPosition(position.x + m_lobby_column_width / 3.f, position.y);
 				m_window.draw(text);
 			}
 
@@ -188,7 +315,7 @@ void MultiplayerGameState::Draw()
 			}
 
 
-			if (m_local_player_identifiers.size() < 2 && m_player_invitation_time < sf::seconds(0.5f))
+			if (!m_spectator && m_local_player_identifiers.size() < 2 && m_player_invitation_time < sf::seconds(0.5f))
 			{
 				m_window.draw(m_player_invitation_text);
 			}
@@ -196,6 +323,12 @@ void MultiplayerGameState::Draw()
 		else
 		{
 			m_world.Draw();
+
+			//Input that arrived since the last frame is on screen now
+			if (m_latency_trace)
+			{
+				m_latency_trace->OnRendered(m_network->GetServerTime());
+			}
 		}
 
 		if (!m_broadcasts.empty())
@@ -214,6 +347,7 @@ void MultiplayerGameState::Draw()
 bool MultiplayerGameState::Update(sf::Time dt)
 {
 	UpdateStatistics(dt);
+	UpdateConnectionStatus();
 
 	//Connected to the Server: Handle all the network logic
 	if (m_connected)
@@ -229,7 +363,7 @@ bool MultiplayerGameState::Update(sf::Time dt)
 	}
 
 	//Failed to connect and waited for more than 5 seconds: Back to menu
-	else if (m_failed_connection_clock.getElapsedTime() >= sf::seconds(5.f))
+	else if (m_network_status != ClientNetwork::Status::kConnecting && m_failed_connection_clock.getElapsedTime() >= sf::seconds(5.f))
 	{
 		RequestStackClear();
 		RequestStackPush(StateID::kMenu);
@@ -237,19 +371,144 @@ bool MultiplayerGameState::Update(sf::Time dt)
 	return true;
 }
 
+void MultiplayerGameState::UpdateConnectionStatus()
+{
+	const ClientNetwork::Status status = m_network->GetStatus();
+	if (status == m_network_status)
+	{
+		return;
+	}
+
+	m_network_status = status;
+
+	switch (status)
+	{
+	case ClientNetwork::Status::kConnected:
+	{
+		m_connected = true;
+		m_reconnecting = false;
+
+		//Join is always the first packet, the session token lets the server hand back our players
+		sf::Packet packet;
+		packet << static_cast<opt::ClientPacket>(Client::PacketType::Join) << m_session_token << m_spectator;
+		SendPacket(packet);
+	}
+	break;
+
+	case ClientNetwork::Status::kFailed:
+		SetConnectionFailed(m_reconnecting
+			? "Could not reconnect to the server"
+			: "Could not connect to the remote server");
+		break;
+
+	case ClientNetwork::Status::kDisconnected:
+		HandleConnectionLost("Lost connection to the server");
+		break;
+
+	case ClientNetwork::Status::kConnecting:
+		break;
+	}
+}
+
+//A match in progress is resumed with the session token, anything else goes back to the menu
+
+void MultiplayerGameState::HandleConnectionLost(const std::string& message)
+{
+	if (m_lobby || m_session_token == 0 || m_reconnecting)
+	{
+		SetConnectionFailed(message);
+		return;
+	}
+
+	m_connected = false;
+	m_reconnecting = true;
+	m_failed_connection_text.setString("Reconnecting...");
+	Utility::CentreOrigin(m_failed_connection_text);
+
+	m_network.reset(new ClientNetwork(m_server_address, SERVER_PORT));
+	m_network_status = ClientNetwork::Status::kConnecting;
+
+	for (auto& pair : m_players)
+	{
+		if (pair.second.m_player)
+		{
+			pair.second.m_player->SetNetwork(m_network.get());
+		}
+	}
+}
+
+void MultiplayerGameState::SetConnectionFailed(const std::string& message)
+{
+	m_connected = false;
+	m_failed_connection_text.setString(message);
+	Utility::CentreOrigin(m_failed_connection_text);
+
+	m_failed_connection_clock.restart();
+}
+
 void MultiplayerGameState::UpdateStatistics(sf::Time dt)
 {
 	m_statistics_update_time += dt;
 
 	if (m_statistics_update_time >= sf::seconds(1.0f))
 	{
-		m_statistics_text.setString(
+		std::string statistics =
 			"Bytes Received / Second = " + std::to_string(m_bytes_received) + "\n" +
-			"Bytes Sent / Second = " + std::to_string(m_bytes_sent));
+			"Bytes Sent / Second = " + std::to_string(m_bytes_sent);
+
+		//The host also shows how steady the server's simulation thread is
+		if (m_game_server)
+		{
+			const GameServer::TickStatistics server = m_game_server->GetTickStatistics();
+			statistics +=
+				"\nServer Steps / Second = " + std::to_string(server.m_steps) +
+				"\nServer Jitter Avg / Max = " + std::to_string(server.m_average_jitter.asMicroseconds()) + " / " + std::to_string(server.m_max_jitter.asMicroseconds()) + "us" +
+				"\nServer Inbound / Sim / Broadcast Max = " +
+				std::to_string(server.m_max_inbound_time.asMicroseconds()) + " / " +
+				std::to_string(server.m_max_simulation_time.asMicroseconds()) + " / " +
+				std::to_string(server.m_max_broadcast_time.asMicroseconds()) + "us";
+
+			//Snapshot coding has to stay a small part of the 50ms tick it runs in
+			if (server.m_snapshot_raw_bytes > 0)
+			{
+				const float tick_share = 100.f * server.m_max_encode_time.asSeconds() / (1.f / 20.f);
+				statistics +=
+					"\nSnapshot Encode Max = " + std::to_string(server.m_max_encode_time.asMicroseconds()) + "us (" +
+					std::to_string(tick_share) + "% of tick) for " + std::to_string(server.m_snapshot_peers) + " peers on " +
+					std::to_string(server.m_snapshot_workers) + " workers" +
+					"\nSnapshot Raw / Coded Bytes = " + std::to_string(server.m_snapshot_raw_bytes) + " / " +
+					std::to_string(server.m_snapshot_coded_bytes);
+			}
+
+			const GameServer::NetworkStatistics network = m_game_server->GetNetworkStatistics();
+			statistics +=
+				"\nServer Packets In / Deferred / Dropped = " +
+				std::to_string(network.m_received) + " / " +
+				std::to_string(network.m_deferred) + " / " +
+				std::to_string(network.m_dropped) +
+				"\nServer Packets / Socket Calls In = " +
+				std::to_string(network.m_received) + " / " + std::to_string(network.m_receive_calls) +
+				"\nServer Packets / Socket Calls Out = " +
+				std::to_string(network.m_sent) + " / " + std::to_string(network.m_send_calls);
+		}
+
+		//Cost of applying the server's player states, this grows with the lobby size
+		if (m_state_updates.m_count > 0)
+		{
+			statistics +=
+				"\nClient State Updates = " + std::to_string(m_state_updates.m_count) +
+				" x " + std::to_string(m_state_updates.m_players) + " players" +
+				"\nClient State Update Avg / Max = " +
+				std::to_string(m_state_updates.m_total_time.asMicroseconds() / m_state_updates.m_count) + " / " +
+				std::to_string(m_state_updates.m_max_time.asMicroseconds()) + "us";
+		}
+
+		m_statistics_text.setString(statistics);
 
 		m_statistics_update_time -= sf::seconds(1.0f);
 		m_bytes_received = 0;
 		m_bytes_sent = 0;
+		m_state_updates = StateUpdateStatistics();
 	}
 }
 
@@ -272,8 +531,6 @@ void MultiplayerGameState::UpdateLobby(sf::Time dt)
 		SendPacket(update_packet);
 		m_tick_clock.restart();
 	}
-
-	m_time_since_last_packet += dt;
 }
 
 void MultiplayerGameState::UpdateGame(sf::Time dt)
@@ -285,7 +542,7 @@ void MultiplayerGameState::UpdateGame(sf::Time dt)
 	for (auto itr = m_players.begin(); itr != m_players.end();)
 	{
 		//Check if there are no more local planes for remote clients
-		if (std::find(m_local_player_identifiers.begin(), m_local_player_identifiers.end(), itr->first) != m_local_player_identifiers.end())
+		if (itr->second.m_player && itr->second.m_player->IsLocal())
 		{
 			found_local_plane = true;
 		}
@@ -306,7 +563,11 @@ void MultiplayerGameState::UpdateGame(sf::Time dt)
 		}
 	}
 
-	if (!found_local_plane)
+	if (m_spectator)
+	{
+		UpdateSpectatorCamera();
+	}
+	else if (!found_local_plane)
 	{
 		RequestStackPush(StateID::kGameOver);
 	}
@@ -321,6 +582,16 @@ void MultiplayerGameState::UpdateGame(sf::Time dt)
 		}
 	}
 
+	//Send this frame's input from the local players
+	for (opt::PlayerIdentifier identifier : m_local_player_identifiers)
+	{
+		auto itr = m_players.find(identifier);
+		if (itr != m_players.end())
+		{
+			itr->second.m_player->SendInputFrame();
+		}
+	}
+
 	//Always handle the network input
 	CommandQueue& commands = m_world.GetCommandQueue();
 	for (auto& pair : m_players)
@@ -365,40 +636,29 @@ void MultiplayerGameState::UpdateGame(sf::Time dt)
 		SendPacket(position_update_packet);
 		m_tick_clock.restart();
 	}
-	m_time_since_last_packet += dt;
 }
 
 void MultiplayerGameState::ReceivePacket()
 {
-	//Handle messages from the server that may have arrived
-	sf::Packet packet;
-	if (m_socket.receive(packet) == sf::Socket::Done)
+	//Handle every message the network thread has received since the last frame
+	ClientNetwork::ReceivedPacket received;
+	while (m_connected && m_network->PollPacket(received))
 	{
-		m_bytes_received += packet.getDataSize();
-
-		m_time_since_last_packet = sf::seconds(0.f);
-		opt::ServerPacket packet_type;
-		packet >> packet_type;
-		HandlePacket(packet_type, packet);
+		m_bytes_received += received.m_packet.getDataSize();
+		HandlePacket(received.m_type, received.m_packet, received.m_arrival_time);
 	}
-	else
-	{
-		//Check for timeout with the server
-		if (m_time_since_last_packet > m_client_timeout)
-		{
-			m_connected = false;
-			m_failed_connection_text.setString("Lost connection to the server");
-			Utility::CentreOrigin(m_failed_connection_text);
 
-			m_failed_connection_clock.restart();
-		}
+	//Check for timeout with the server
+	if (m_connected && m_network->GetTimeSinceLastPacket() > m_client_timeout)
+	{
+		HandleConnectionLost("Lost connection to the server");
 	}
 }
 
 void MultiplayerGameState::SendPacket(sf::Packet& packet)
 {
 	m_bytes_sent += packet.getDataSize();
-	m_socket.send(packet);
+	m_network->Send(packet);
 }
 
 bool MultiplayerGameState::HandleEvent(const sf::Event& event)
@@ -408,7 +668,7 @@ bool MultiplayerGameState::HandleEvent(const sf::Event& event)
 		m_lobby_gui.HandleEvent(event);
 
 		//If enter pressed, add second player co-op only if there is only 1 player
-		if (event.key.code == sf::Keyboard::Return && m_local_player_identifiers.size() == 1)
+		if (event.key.code == sf::Keyboard::Return && !m_spectator && m_local_player_identifiers.size() == 1)
 		{
 			sf::Packet packet;
 			packet << static_cast<opt::ClientPacket>(Client::PacketType::RequestCoopPartner);
@@ -506,7 +766,7 @@ void MultiplayerGameState::UpdateBroadcastMessage(sf::Time elapsed_time)
 	}
 }
 
-void MultiplayerGameState::HandlePacket(opt::ServerPacket packet_type, sf::Packet& packet)
+void MultiplayerGameState::HandlePacket(opt::ServerPacket packet_type, sf::Packet& packet, sf::Time arrival_time)
 {
 	const auto packet_type_cast = static_cast<Server::PacketType>(packet_type);
 	switch (packet_type_cast)
@@ -545,7 +805,7 @@ void MultiplayerGameState::HandlePacket(opt::ServerPacket packet_type, sf::Packe
 			packet >> player_identifier;
 
 			GeneratePlayer(player_identifier);
-			m_players[player_identifier].m_player.reset(new Player(&m_socket, player_identifier, GetContext().keys1));
+			m_players[player_identifier].m_player.reset(new Player(m_network.get(), player_identifier, GetContext().keys1));
 			m_players[player_identifier].m_games_won = m_games_won;
 			m_local_player_identifiers.push_back(player_identifier);
 			m_world.AddPlayer(player_identifier, m_players[player_identifier].m_name->GetText(), true);
@@ -565,7 +825,7 @@ void MultiplayerGameState::HandlePacket(opt::ServerPacket packet_type, sf::Packe
 			packet >> player_identifier;
 
 			GeneratePlayer(player_identifier);
-			m_players[player_identifier].m_player.reset(new Player(&m_socket, player_identifier, nullptr));
+			m_players[player_identifier].m_player.reset(new Player(m_network.get(), player_identifier, nullptr));
 			m_players[player_identifier].m_games_won = 0;
 			m_world.AddPlayer(player_identifier, m_players[player_identifier].m_name->GetText(), false);
 		}
@@ -577,33 +837,105 @@ void MultiplayerGameState::HandlePacket(opt::ServerPacket packet_type, sf::Packe
 			packet >> player_identifier;
 
 			m_world.RemovePlayer(player_identifier);
+			m_snapshot_codec.Forget(player_identifier);
 			m_lobby_gui.Unpack(m_players[player_identifier].m_name);
 			m_players.erase(player_identifier);
+			UpdateLobbyLayout();
 		}
 		break;
 
+		//Sent on every join ahead of InitialState, snapshots from the new connection start from empty baselines
+		case Server::PacketType::SnapshotModel:
+		{
+			if (!m_snapshot_model.Read(packet))
+			{
+				m_snapshot_model = RangeModel();
+			}
+			m_snapshot_codec.Reset();
+		}
+		break;
+
+		//Sent on every join, this brings a new or reconnecting client up to date in one step
 		case Server::PacketType::InitialState:
 		{
 			sf::Uint32 seed;
-			opt::PlayerCount player_count;
+			opt::SessionToken session_token;
+			bool match_running;
 			packet >> seed
-				>> player_count;
+				>> session_token
+				>> match_running;
+
+			TileGrid tile_snapshot;
+			opt::PlayerCount player_count;
+			if (!tile_snapshot.ReadSnapshot(packet) || !(packet >> player_count))
+			{
+				break;
+			}
 
+			m_session_token = session_token;
 			Utility::UpdateRandomEngine(seed);
+			m_world.ApplyTileSnapshot(tile_snapshot);
+
+			std::unordered_set<opt::PlayerIdentifier> listed_players;
 			for (opt::PlayerCount i = 0; i < player_count; ++i)
 			{
 				opt::PlayerIdentifier player_identifier;
 				std::string player_name;
 				opt::GamesWon games_won;
+				sf::Vector2f player_position;
+				sf::Int32 hitpoints;
 
 				packet >> player_identifier
 					>> player_name
-					>> games_won;
+					>> games_won
+					>> player_position.x
+					>> player_position.y
+					>> hitpoints;
+
+				listed_players.insert(player_identifier);
+
+				//A reconnecting client still has most players, only new ones are created
+				if (m_players.find(player_identifier) == m_players.end())
+				{
+					GeneratePlayer(player_identifier, player_name);
+					m_players[player_identifier].m_player.reset(new Player(m_network.get(), player_identifier, nullptr));
+					m_world.AddPlayer(player_identifier, player_name, false);
+				}
 
-				GeneratePlayer(player_identifier, player_name);
-				m_players[player_identifier].m_player.reset(new Player(&m_socket, player_identifier, nullptr));
 				m_players[player_identifier].m_games_won = games_won;
-				m_world.AddPlayer(player_identifier, player_name, false);
+
+				PlayerObject* player = m_world.GetPlayer(player_identifier);
+				if (player && match_running)
+				{
+					player->setPosition(player_position);
+
+					if (hitpoints <= 0 && player->IsAlive())
+					{
+						player->Kill();
+					}
+				}
+			}
+
+			//Remote players missing from the list left while this client was away
+			for (auto itr = m_players.begin(); itr != m_players.end();)
+			{
+				if (itr->second.m_player && !itr->second.m_player->IsLocal() && !listed_players.count(itr->first))
+				{
+					m_world.RemovePlayer(itr->first);
+					m_lobby_gui.Unpack(itr->second.m_name);
+					itr = m_players.erase(itr);
+				}
+				else
+				{
+					++itr;
+				}
+			}
+			UpdateLobbyLayout();
+
+			if (match_running && m_lobby)
+			{
+				m_lobby = false;
+				m_music.Play(MusicThemes::kMenuTheme);
 			}
 		}
 		break;
@@ -614,74 +946,120 @@ void MultiplayerGameState::HandlePacket(opt::ServerPacket packet_type, sf::Packe
 			packet >> player_identifier;
 
 			GeneratePlayer(player_identifier);
-			m_players[player_identifier].m_player.reset(new Player(&m_socket, player_identifier, GetContext().keys2));
+			m_players[player_identifier].m_player.reset(new Player(m_network.get(), player_identifier, GetContext().keys2));
 			m_players[player_identifier].m_games_won = 0;
 			m_local_player_identifiers.emplace_back(player_identifier);
 			m_world.AddPlayer(player_identifier, std::to_string(player_identifier), false);
 		}
 		break;
 
-		//Player's movement or fire keyboard state changes
-		case Server::PacketType::PlayerRealtimeChange:
+		//Input frames from a player on another client
+		case Server::PacketType::PlayerInput:
 		{
 			opt::PlayerIdentifier player_identifier;
-			opt::Action action;
-			bool action_enabled;
-			packet >> player_identifier >> action >> action_enabled;
-			auto itr = m_players.find(player_identifier);
-			if (itr != m_players.end())
+			opt::InputTick newest_tick;
+			sf::Uint8 frame_count;
+			packet >> player_identifier >> newest_tick >> frame_count;
+
+			std::vector<opt::InputMask> masks(frame_count);
+			for (opt::InputMask& mask : masks)
 			{
-				itr->second.m_player->HandleNetworkRealtimeChange(static_cast<PlayerAction>(action), action_enabled);
+				packet >> mask;
 			}
-		}
-		break;
 
-		//Player event, like missile fired occurs
-		case Server::PacketType::PlayerEvent:
-		{
-			opt::PlayerIdentifier player_identifier;
-			opt::Action action;
-			packet >> player_identifier >> action;
+			sf::Int64 client_send_time;
+			sf::Int64 server_receive_time;
+			sf::Int64 server_relay_time;
+			packet >> client_send_time >> server_receive_time >> server_relay_time;
+
 			auto itr = m_players.find(player_identifier);
-			if (itr != m_players.end())
+			if (packet && itr != m_players.end() && !itr->second.m_player->IsLocal())
 			{
-				itr->second.m_player->HandleNetworkEvent(static_cast<PlayerAction>(action), m_world.GetCommandQueue());
+				itr->second.m_player->HandleNetworkInput(newest_tick, masks, m_world.GetCommandQueue());
+
+				//Both ends need a synced clock for the hops to line up
+				if (m_latency_trace && client_send_time >= 0 && m_network->IsClockSynced())
+				{
+					LatencyTrace::Stamps stamps;
+					stamps.m_player = player_identifier;
+					stamps.m_tick = newest_tick;
+					stamps.m_client_send = sf::microseconds(client_send_time);
+					stamps.m_server_receive = sf::microseconds(server_receive_time);
+					stamps.m_server_relay = sf::microseconds(server_relay_time);
+					stamps.m_remote_receive = m_network->ToServerTime(arrival_time);
+					m_latency_trace->OnReceived(stamps);
+				}
 			}
 		}
 		break;
 
-
 		case Server::PacketType::UpdateClientState:
 		{
 			if (m_lobby) break;
 
-			opt::PlayerCount player_count;
-			packet >> player_count;
+			sf::Clock update_clock;
+			sf::Uint32 sequence;
+			packet >> sequence;
 
-			for (opt::PlayerCount i = 0; i < player_count; ++i)
+			//The server sizes our snapshots from how quickly these come back
+			sf::Packet ack_packet;
+			ack_packet << static_cast<opt::ClientPacket>(Client::PacketType::SnapshotAck) << sequence;
+			SendPacket(ack_packet);
+
+			//Every later snapshot is relative to this one, reconnecting starts the baselines over
+			if (!SnapshotCodec::ReadPayload(m_snapshot_model, packet, m_snapshot_data, m_snapshot_payload) ||
+				!m_snapshot_codec.Decode(m_snapshot_payload, m_snapshot_entries))
 			{
-				sf::Vector2f player_position;
-				opt::PlayerIdentifier player_identifier;
-				packet >> player_identifier >> player_position.x >> player_position.y;
+				HandleConnectionLost("Received a corrupt snapshot");
+				break;
+			}
+
+			const sf::Time packet_age = m_network->Now() - arrival_time;
+
+			for (const SnapshotCodec::Entry& entry : m_snapshot_entries)
+			{
+				sf::Vector2f player_position = entry.m_position;
+				const opt::PlayerIdentifier player_identifier = entry.m_identifier;
+
+				const auto found = m_players.find(player_identifier);
+				if (found == m_players.end() || !found->second.m_player || found->second.m_player->IsLocal())
+				{
+					continue;
+				}
 
 				PlayerObject* player = m_world.GetPlayer(player_identifier);
-				bool is_local_plane = std::find(m_local_player_identifiers.begin(), m_local_player_identifiers.end(), player_identifier) != m_local_player_identifiers.end();
-				if (player && !is_local_plane)
+				if (player)
 				{
+					//Account for the time the state spent queued before this frame picked it up
+					player_position += player->GetVelocity() * packet_age.asSeconds();
+
 					sf::Vector2f interpolated_position = player->getPosition() + (player_position - player->getPosition()) * 0.1f;
 					player->setPosition(interpolated_position);
 				}
 			}
+
+			const sf::Time update_time = update_clock.getElapsedTime();
+			m_state_updates.m_count++;
+			m_state_updates.m_players = m_snapshot_entries.size();
+			m_state_updates.m_total_time += update_time;
+			m_state_updates.m_max_time = std::max(m_state_updates.m_max_time, update_time);
 		}
 		break;
 
 
-		case Server::PacketType::UpdateDangerTime:
+		case Server::PacketType::TileDamage:
 		{
-			float time;
-			packet >> time;
+			opt::TileCell cell_count;
+			packet >> cell_count;
 
-			DangerTrigger::Instance().Update(sf::seconds(time));
+			for (opt::TileCell i = 0; i < cell_count; ++i)
+			{
+				opt::TileCell cell;
+				if (packet >> cell)
+				{
+					m_world.DamageTile(cell);
+				}
+			}
 		}
 		break;
 
@@ -724,6 +1102,10 @@ void MultiplayerGameState::HandlePacket(opt::ServerPacket packet_type, sf::Packe
 			m_world.GetPlayer(player_identifier)->Kill();
 		}
 		break;
+
+		//Consumed by the network thread before it reaches the inbound queue
+		case Server::PacketType::ClockSync:
+			break;
 	}
 }
 
@@ -737,13 +1119,57 @@ void MultiplayerGameState::GeneratePlayer(opt::PlayerIdentifier identifier, cons
 {
 	const auto label = std::make_shared<GUI::Label>(name, m_font_holder);
 
-	label->SetCharacterSize(20);
-	label->CentreOriginText();
-	label->setPosition(960, 220 + (30 * identifier));
-	label->SetFillColor(ExtraColors::GetColor(static_cast<PlayerColors>(identifier - 1)));
+	label->SetFillColor(ExtraColors::GetPlayerColor(identifier));
 
 	m_players[identifier].m_name = label;
 	m_lobby_gui.Pack(label);
+	UpdateLobbyLayout();
+}
+
+//Spectators have no player for the camera to follow, so it follows the middle of everyone still playing
+
+void MultiplayerGameState::UpdateSpectatorCamera()
+{
+	sf::Vector2f centre;
+	std::size_t count = 0;
+	for (const auto& pair : m_players)
+	{
+		if (const PlayerObject* player = m_world.GetPlayer(pair.first))
+		{
+			centre += player->getPosition();
+			count++;
+		}
+	}
+
+	if (count > 0)
+	{
+		GetContext().camera->SetCenter(centre / static_cast<float>(count));
+	}
+}
+
+void MultiplayerGameState::UpdateLobbyLayout()
+{
+	std::vector<opt::PlayerIdentifier> identifiers;
+	identifiers.reserve(m_players.size());
+	for (const auto& pair : m_players)
+	{
+		identifiers.emplace_back(pair.first);
+	}
+	std::sort(identifiers.begin(), identifiers.end());
+
+	//Small lobbies keep the single column, larger ones wrap into more columns with smaller text
+	const std::size_t columns = std::max<std::size_t>(1, (identifiers.size() + LobbyRows - 1) / LobbyRows);
+	m_lobby_column_width = std::min(600.f, 1800.f / columns);
+	m_lobby_character_size = columns <= 2 ? 20u : columns <= 5 ? 16u : 12u;
+
+	const float first_column = 960.f - m_lobby_column_width * (columns - 1) / 2.f;
+	for (std::size_t i = 0; i < identifiers.size(); ++i)
+	{
+		GUI::Label& label = *m_players[identifiers[i]].m_name;
+		label.SetCharacterSize(m_lobby_character_size);
+		label.CentreOriginText();
+		label.setPosition(first_column + m_lobby_column_width * (i / LobbyRows), 250.f + 30.f * (i % LobbyRows));
+	}
 }
 
 void MultiplayerGameState::SaveData() const
@@ -1,15 +1,20 @@
 #pragma once
 #include <iostream>
 #include <fstream>
+#include <unordered_map>
 
 #include "Container.hpp"
 #include "Button.hpp"
+#include "ClientNetwork.hpp"
 #include "State.hpp"
 #include "World.hpp"
 #include "Player.hpp"
 #include "GameServer.hpp"
 #include "Label.hpp"
+#include "LatencyTrace.hpp"
 #include "NetworkProtocol.hpp"
+#include "RangeCoder.hpp"
+#include "SnapshotCodec.hpp"
 
 /**
  * Vilandas Morrissey - D00218436
@@ -18,10 +23,13 @@
 class MultiplayerGameState : public State
 {
 public:
-	MultiplayerGameState(StateStack& stack, Context context, bool is_host);
+	MultiplayerGameState(StateStack& stack, Context context, bool is_host, bool is_spectator = false);
 	void Draw() override;
 	bool Update(sf::Time dt) override;
 	void UpdateStatistics(sf::Time dt);
+	void UpdateConnectionStatus();
+	void HandleConnectionLost(const std::string& message);
+	void SetConnectionFailed(const std::string& message);
 	void UpdateLobby(sf::Time dt);
 	void UpdateGame(sf::Time dt);
 	void ReceivePacket();
@@ -42,11 +50,23 @@ private:
 		opt::GamesWon m_games_won;
 	};
 
+	//Time spent applying UpdateClientState packets over the last second
+	struct StateUpdateStatistics
+	{
+		StateUpdateStatistics();
+		std::size_t m_count;
+		std::size_t m_players;
+		sf::Time m_total_time;
+		sf::Time m_max_time;
+	};
+
 private:
 	void UpdateBroadcastMessage(sf::Time elapsed_time);
-	void HandlePacket(opt::ServerPacket packet_type, sf::Packet& packet);
+	void HandlePacket(opt::ServerPacket packet_type, sf::Packet& packet, sf::Time arrival_time);
 	void GeneratePlayer(opt::PlayerIdentifier identifier);
 	void GeneratePlayer(opt::PlayerIdentifier identifier, const std::string& name);
+	void UpdateLobbyLayout();
+	void UpdateSpectatorCamera();
 	void SaveData() const;
 
 private:
@@ -60,19 +80,34 @@ private:
 	GUI::Container m_lobby_gui;
 	sf::Sprite m_background_sprite;
 	sf::Text m_lobby_text;
+	float m_lobby_column_width;
+	unsigned int m_lobby_character_size;
 	sf::Text m_waiting_for_host_text;
 
 	sf::Text m_statistics_text;
 	sf::Time m_statistics_update_time;
 	sf::Uint32 m_bytes_received;
 	sf::Uint32 m_bytes_sent;
+	StateUpdateStatistics m_state_updates;
+
+	RangeModel m_snapshot_model;
+	SnapshotCodec m_snapshot_codec;
+	std::vector<SnapshotCodec::Entry> m_snapshot_entries;
+	std::vector<sf::Uint8> m_snapshot_data;
+	std::vector<sf::Uint8> m_snapshot_payload;
 
 	opt::GamesWon m_games_won;
-	std::map<opt::PlayerIdentifier, PlayerData> m_players;
+	std::unordered_map<opt::PlayerIdentifier, PlayerData> m_players;
 	std::vector<opt::PlayerIdentifier> m_local_player_identifiers;
-	sf::TcpSocket m_socket;
 	bool m_connected;
+	bool m_reconnecting;
+	opt::SessionToken m_session_token;
+	sf::IpAddress m_server_address;
+	ClientNetwork::Status m_network_status;
 	std::unique_ptr<GameServer> m_game_server;
+	std::unique_ptr<ClientNetwork> m_network;
+	//Only when enabled in trace.txt
+	std::unique_ptr<LatencyTrace> m_latency_trace;
 	sf::Clock m_tick_clock;
 
 	std::vector<std::string> m_broadcasts;
@@ -88,7 +123,7 @@ private:
 	bool m_active_state;
 	bool m_has_focus;
 	bool m_host;
+	bool m_spectator;
 	bool m_lobby;
 	sf::Time m_client_timeout;
-	sf::Time m_time_since_last_packet;
 };
\ No newline at end of file
@@ -9,9 +9,13 @@ namespace opt
 {
 	typedef sf::Uint8 ServerPacket;
 	typedef sf::Uint8 ClientPacket;
-	typedef sf::Uint8 PlayerIdentifier;
-	typedef sf::Uint8 PlayerCount;
+	typedef sf::Uint16 PlayerIdentifier;
+	typedef sf::Uint16 PlayerCount;
 	typedef sf::Uint8 LocalPlayers;
 	typedef sf::Uint8 Action;
+	typedef sf::Uint8 InputMask;
+	typedef sf::Uint32 InputTick;
 	typedef sf::Int32 GamesWon;
+	typedef sf::Uint64 SessionToken;
+	typedef sf::Uint16 TileCell;
 }
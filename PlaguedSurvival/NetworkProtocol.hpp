@@ -1,4 +1,5 @@
 #pragma once
+#include <cstddef>
 #include <SFML/System/Vector2.hpp>
 
 /**
@@ -6,6 +7,16 @@
  */
 
 const unsigned short SERVER_PORT = 50000;
+//Spectator relays listen here, so one can run next to a server on the same machine
+const unsigned short RELAY_PORT = 50001;
+//Number of input frames repeated in every PlayerInput packet so a lost packet can be recovered from the next one
+const std::size_t INPUT_REDUNDANCY = 4;
+//Upper limit for large lobbies, this includes simulated players
+const std::size_t MAX_LOBBY_PLAYERS = 250;
+//Upper limit for the server's simulated snapshot receivers, used to measure tick time against peer count
+const std::size_t MAX_SIMULATED_VIEWERS = 1000;
+//How long the server holds the players of a dropped client for it to resume with its session token
+const float SESSION_RESUME_SECONDS = 10.f;
 
 namespace Server
 {
@@ -15,17 +26,18 @@ namespace Server
 		BroadcastMessage,
 		InitialState,
 		StartGame,
-		PlayerEvent,
-		PlayerRealtimeChange,
+		PlayerInput,
 		PlayerConnect,
 		PlayerDisconnect,
 		AcceptCoopPartner,
 		SpawnSelf,
 		UpdateClientState,
-		UpdateDangerTime,
+		TileDamage,
 		GamesWonUpdated,
 		PlayerDied,
-		MissionSuccess
+		MissionSuccess,
+		SnapshotModel,
+		ClockSync
 	};
 }
 
@@ -36,13 +48,16 @@ namespace Client
 	{
 		StillHereUpdate,
 		RequestStartGame,
-		PlayerEvent,
-		PlayerRealtimeChange,
+		PlayerInput,
 		RequestCoopPartner,
 		PositionUpdate,
 		GameEvent,
 		UpdateGamesWon,
-		Quit
+		Quit,
+		Join,
+		SnapshotAck,
+		RequestWorldState,
+		ClockSync
 	};
 }
 
@@ -0,0 +1,53 @@
+#include "PacketFraming.hpp"
+
+#include <SFML/Network/Packet.hpp>
+
+/**
+ * Vilandas Morrissey - D00218436
+ */
+
+void PacketFraming::Append(const sf::Packet& packet, std::vector<char>& buffer)
+{
+	const sf::Uint32 size = static_cast<sf::Uint32>(packet.getDataSize());
+	const char header[HEADER_BYTES] =
+	{
+		static_cast<char>(size >> 24),
+		static_cast<char>(size >> 16),
+		static_cast<char>(size >> 8),
+		static_cast<char>(size)
+	};
+
+	const char* data = static_cast<const char*>(packet.getData());
+	buffer.insert(buffer.end(), header, header + HEADER_BYTES);
+	buffer.insert(buffer.end(), data, data + size);
+}
+
+/// <summary>
+/// Reads the packet starting at offset and moves offset past it. Nothing is read until the whole packet has arrived.
+/// </summary>
+PacketFraming::Result PacketFraming::Extract(const std::vector<char>& buffer, std::size_t& offset, sf::Packet& packet)
+{
+	const std::size_t available = buffer.size() - offset;
+	if (available < HEADER_BYTES)
+	{
+		return Result::kIncomplete;
+	}
+
+	const unsigned char* header = reinterpret_cast<const unsigned char*>(buffer.data() + offset);
+	const std::size_t size = (static_cast<std::size_t>(header[0]) << 24) | (header[1] << 16) | (header[2] << 8) | header[3];
+
+	if (size > MAX_FRAME_SIZE)
+	{
+		return Result::kMalformed;
+	}
+
+	if (available < HEADER_BYTES + size)
+	{
+		return Result::kIncomplete;
+	}
+
+	packet.clear();
+	packet.append(buffer.data() + offset + HEADER_BYTES, size);
+	offset += HEADER_BYTES + size;
+	return Result::kPacket;
+}
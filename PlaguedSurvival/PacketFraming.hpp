@@ -0,0 +1,35 @@
+#pragma once
+#include <vector>
+#include <SFML/Config.hpp>
+
+/**
+ * Vilandas Morrissey - D00218436
+ */
+
+namespace sf
+{
+	class Packet;
+}
+
+/// <summary>
+/// Frames packets the way sf::TcpSocket does, a big endian size followed by the data,
+/// so many packets can be sent or received with one socket call and still be read by SFML on the other end.
+/// </summary>
+class PacketFraming
+{
+public:
+	static constexpr std::size_t HEADER_BYTES = 4;
+	//Nothing in the protocol comes close to this, a larger size means the stream is corrupt
+	static constexpr std::size_t MAX_FRAME_SIZE = 1 << 16;
+
+	enum class Result
+	{
+		kPacket,
+		kIncomplete,
+		kMalformed
+	};
+
+public:
+	static void Append(const sf::Packet& packet, std::vector<char>& buffer);
+	static Result Extract(const std::vector<char>& buffer, std::size_t& offset, sf::Packet& packet);
+};
@@ -0,0 +1,73 @@
+#include "ParallelSceneUpdate.hpp"
+
+#include <algorithm>
+
+#include "SceneNode.hpp"
+
+/**
+ * Vilandas Morrissey - D00218436
+ */
+
+namespace
+{
+	//The root and its layers update first, the subtrees under the layers are the jobs
+	const std::size_t SplitDepth = 2;
+
+	//Large enough that a batch outweighs handing it to a worker
+	const std::size_t BatchSize = 128;
+}
+
+ParallelSceneUpdate::ParallelSceneUpdate(std::size_t worker_count)
+	: m_jobs(worker_count)
+{
+}
+
+std::size_t ParallelSceneUpdate::GetWorkerCount() const
+{
+	return m_jobs.GetWorkerCount();
+}
+
+void ParallelSceneUpdate::Update(SceneNode& root, sf::Time dt, CommandQueue& commands)
+{
+	m_subtrees.clear();
+	root.UpdateAbove(SplitDepth, dt, commands, m_subtrees);
+
+	const std::size_t batches = (m_subtrees.size() + BatchSize - 1) / BatchSize;
+	while (m_batch_commands.size() < batches)
+	{
+		m_batch_commands.emplace_back(new CommandQueue());
+	}
+
+	m_jobs.ParallelFor(batches, 1, [&](std::size_t batch)
+		{
+			UpdateBatch(batch, dt, true);
+		});
+
+	for (std::size_t batch = 0; batch < batches; ++batch)
+	{
+		UpdateBatch(batch, dt, false);
+
+		CommandQueue& batch_commands = *m_batch_commands[batch];
+		while (!batch_commands.IsEmpty())
+		{
+			commands.Push(batch_commands.Pop());
+		}
+	}
+}
+
+/// <summary>
+/// Updates either the nodes in the batch that can update concurrently or the rest
+/// </summary>
+void ParallelSceneUpdate::UpdateBatch(std::size_t batch, sf::Time dt, bool concurrent)
+{
+	const std::size_t end = std::min(m_subtrees.size(), (batch + 1) * BatchSize);
+
+	for (std::size_t i = batch * BatchSize; i < end; ++i)
+	{
+		SceneNode& node = *m_subtrees[i];
+		if (node.CanUpdateConcurrently() == concurrent)
+		{
+			node.Update(dt, *m_batch_commands[batch]);
+		}
+	}
+}
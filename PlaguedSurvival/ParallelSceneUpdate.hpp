@@ -0,0 +1,38 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include <SFML/System/Time.hpp>
+
+#include "CommandQueue.hpp"
+#include "JobSystem.hpp"
+
+/**
+ * Vilandas Morrissey - D00218436
+ */
+
+class SceneNode;
+
+/// <summary>
+/// Updates a scene graph with its nodes below the root and layers split into batches that run as jobs.
+/// Nodes that cannot update concurrently run afterwards on the calling thread. Every batch pushes to its
+/// own command queue and the queues are merged in tree order, so the commands come out in the same order
+/// however the batches were scheduled.
+/// A scene with fewer nodes than a batch updates entirely on the calling thread.
+/// </summary>
+class ParallelSceneUpdate
+{
+public:
+	explicit ParallelSceneUpdate(std::size_t worker_count);
+
+	std::size_t GetWorkerCount() const;
+	void Update(SceneNode& root, sf::Time dt, CommandQueue& commands);
+
+private:
+	void UpdateBatch(std::size_t batch, sf::Time dt, bool concurrent);
+
+private:
+	JobSystem m_jobs;
+	std::vector<SceneNode*> m_subtrees;
+	//One per batch, kept between frames
+	std::vector<std::unique_ptr<CommandQueue>> m_batch_commands;
+};
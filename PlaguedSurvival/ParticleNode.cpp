@@ -42,6 +42,12 @@ unsigned int ParticleNode::GetCategory() const
 	return Category::kParticleSystem;
 }
 
+//Emitters add their particles after the concurrent updates have finished
+bool ParticleNode::CanUpdateConcurrently() const
+{
+	return true;
+}
+
 void ParticleNode::UpdateCurrent(sf::Time dt, CommandQueue&)
 {
 	// Remove expired particles at beginning
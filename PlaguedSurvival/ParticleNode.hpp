@@ -1,4 +1,5 @@
 #pragma once
+#include <deque>
 #include <SFML/Graphics/Color.hpp>
 #include <SFML/Graphics/VertexArray.hpp>
 
@@ -15,6 +16,7 @@ public:
 	void AddParticle(sf::Vector2f position);
 	ParticleType GetParticleType() const;
 	virtual unsigned int GetCategory() const;
+	bool CanUpdateConcurrently() const override;
 
 private:
 	virtual void UpdateCurrent(sf::Time dt, CommandQueue& commands);
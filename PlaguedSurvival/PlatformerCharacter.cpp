@@ -7,6 +7,8 @@
 #include "DataTables.hpp"
 #include "PlatformerAnimationState.hpp"
 #include "ResourceHolder.hpp"
+#include "SpatialGrid.hpp"
+#include "TileMap.hpp"
 #include "Utility.hpp"
 
 /**
@@ -47,6 +49,8 @@ PlatformerCharacter::PlatformerCharacter(
 	, m_jumping(false)
 	, m_camera_move_constraint(false)
 	, m_is_camera_target(is_camera_target)
+	, m_collision_candidates()
+	, m_collision_boxes()
 {
 	std::unique_ptr<TextNode> name_display(new TextNode(scene_layers, fonts, ""));
 	m_name_display = name_display.get();
@@ -63,9 +67,9 @@ unsigned PlatformerCharacter::GetCategory() const
 	return Category::kPlayerCharacter;
 }
 
-sf::FloatRect PlatformerCharacter::GetBoundingRect() const
+sf::FloatRect PlatformerCharacter::GetLocalBounds() const
 {
-	return GetWorldTransform().transformRect(m_artist.GetSmallestBounds());
+	return m_artist.GetSmallestBounds();
 }
 
 void PlatformerCharacter::Attack()
@@ -123,6 +127,7 @@ void PlatformerCharacter::Kill()
 void PlatformerCharacter::Destroy()
 {
 	m_destroyed = true;
+	MarkForRemoval();
 }
 
 bool PlatformerCharacter::IsDestroyed() const
@@ -131,18 +136,32 @@ bool PlatformerCharacter::IsDestroyed() const
 }
 
 /// <summary>
-/// Handle Collisions between the Player Character and any SceneNode with a collider
+/// Sweeps the Player Character through this step's move against the tiles it passes over,
+/// so it stops on the first tile in its way however fast it is going
 /// </summary>
-void PlatformerCharacter::HandleCollisions()
+void PlatformerCharacter::Integrate(sf::Time dt)
 {
-	std::set<SceneNode*> collisions;
+	const sf::FloatRect bounds = GetBoundingRect();
+	const sf::Vector2f motion = GetVelocity() * dt.asSeconds();
 
-	PredictCollisionsWithChunks(Layers::kActivePlatforms, collisions);
+	SpatialGrid::Instance().Query(Collision::GetSweptBounds(bounds, motion), Layers::kActivePlatforms, m_collision_candidates);
 
-	for (SceneNode* node : collisions)
+	m_collision_boxes.clear();
+	for (const int cell : m_collision_candidates)
 	{
-		const CollisionLocation location = Collision::CollisionLocation(*this, *node);
-		BlockingCollision(location);
+		m_collision_boxes.emplace_back(TileMap::GetCellBounds(cell));
+	}
+
+	sf::Vector2f moved;
+	const unsigned contacts = Collision::Sweep(bounds, motion, m_collision_boxes, moved);
+	move(moved);
+
+	for (const CollisionLocation location : { CollisionLocation::kLeft, CollisionLocation::kTop, CollisionLocation::kRight, CollisionLocation::kBottom })
+	{
+		if (contacts & static_cast<unsigned>(location))
+		{
+			BlockingCollision(location);
+		}
 	}
 }
 
@@ -27,7 +27,6 @@ public:
 		bool is_camera_target = true);
 
 	unsigned GetCategory() const override;
-	sf::FloatRect GetBoundingRect() const override;
 
 	void Attack();
 	void Jump();
@@ -44,10 +43,11 @@ public:
 	bool IsDestroyed() const override;
 
 protected:
-	void HandleCollisions() override;
+	sf::FloatRect GetLocalBounds() const override;
 	void BlockingCollision(CollisionLocation location);
 
 	void ApplyGravity(sf::Time dt) override;
+	void Integrate(sf::Time dt) override;
 
 private:
 	void DrawCurrent(sf::RenderTarget& target, sf::RenderStates states) const override;
@@ -69,4 +69,6 @@ private:
 	bool m_camera_move_constraint;
 	bool m_is_camera_target;
 	bool m_destroyed;
+	std::vector<int> m_collision_candidates;
+	std::vector<sf::FloatRect> m_collision_boxes;
 };
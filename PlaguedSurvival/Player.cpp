@@ -1,6 +1,8 @@
 #include "Player.hpp"
+#include "ClientNetwork.hpp"
 #include "NetworkProtocol.hpp"
 #include <SFML/Network/Packet.hpp>
+#include <algorithm>
 
 #include "PlatformerCharacter.hpp"
 
@@ -82,11 +84,19 @@ struct PlatformerAttack
 	opt::PlayerIdentifier identifier;
 };
 
-Player::Player(sf::TcpSocket* socket, opt::PlayerIdentifier identifier, const KeyBinding* binding)
+Player::Player(ClientNetwork* network, opt::PlayerIdentifier identifier, const KeyBinding* binding)
 	: m_key_binding(binding)
 	, m_current_mission_status(MissionStatus::kMissionRunning)
 	, m_identifier(identifier)
-	, m_socket(socket)
+	, m_network(network)
+	, m_frame_mask(0)
+	, m_input_tick(0)
+	, m_input_history()
+	, m_frames_since_send(0)
+	, m_frames_since_change(0)
+	, m_remote_mask(0)
+	, m_last_input_tick(0)
+	, m_has_remote_input(false)
 {
 	// Set initial action bindings
 	InitialiseActions();
@@ -104,39 +114,15 @@ void Player::HandleEvent(const sf::Event& event, CommandQueue& commands)
 		PlayerAction action;
 		if (m_key_binding && m_key_binding->CheckAction(event.key.code, action) && !IsRealtimeAction(action))
 		{
-			// Network connected -> send event over network
-			if (m_socket)
-			{
-				sf::Packet packet;
-				packet << static_cast<opt::ClientPacket>(Client::PacketType::PlayerEvent);
-				packet << m_identifier;
-				packet << static_cast<opt::Action> (action);
-				m_socket->send(packet);
-			}
+			// Events are applied locally straight away, when networked they are also recorded in this frame's input
+			commands.Push(m_action_binding[action]);
 
-			// Network disconnected -> local event
-			else
+			if (m_network)
 			{
-				commands.Push(m_action_binding[action]);
+				m_frame_mask |= ToInputMask(action);
 			}
 		}
 	}
-
-	// Realtime change (network connected)
-	if ((event.type == sf::Event::KeyPressed || event.type == sf::Event::KeyReleased) && m_socket)
-	{
-		PlayerAction action;
-		if (m_key_binding && m_key_binding->CheckAction(event.key.code, action) && IsRealtimeAction(action))
-		{
-			// Send realtime change over network
-			sf::Packet packet;
-			packet << static_cast<opt::ClientPacket>(Client::PacketType::PlayerRealtimeChange);
-			packet << m_identifier;
-			packet << static_cast<opt::Action>(action);
-			packet << (event.type == sf::Event::KeyPressed);
-			m_socket->send(packet);
-		}
-	}
 }
 
 bool Player::IsLocal() const
@@ -145,52 +131,117 @@ bool Player::IsLocal() const
 	return m_key_binding != nullptr;
 }
 
+//Used when the client reconnects with a new connection
+void Player::SetNetwork(ClientNetwork* network)
+{
+	m_network = network;
+}
+
 void Player::DisableAllRealtimeActions()
 {
-	for (const auto& action : m_action_proxies)
-	{
-		sf::Packet packet;
-		packet << static_cast<opt::ClientPacket>(Client::PacketType::PlayerRealtimeChange);
-		packet << m_identifier;
-		packet << static_cast<opt::Action>(action.first);
-		packet << false;
-		m_socket->send(packet);
-	}
+	// The next input frame is sent empty, which releases every action on the other clients
+	m_frame_mask = 0;
 }
 
 void Player::HandleRealtimeInput(CommandQueue& commands)
 {
 	// Check if this is a networked game and local player or just a single player game
-	if ((m_socket && IsLocal()) || !m_socket)
+	if ((m_network && IsLocal()) || !m_network)
 	{
 		// Lookup all actions and push corresponding commands to queue
 		std::vector<PlayerAction> activeActions = m_key_binding->GetRealtimeActions();
 		for (PlayerAction action : activeActions)
+		{
 			commands.Push(m_action_binding[action]);
+			m_frame_mask |= ToInputMask(action);
+		}
 	}
 }
 
 void Player::HandleRealtimeNetworkInput(CommandQueue& commands)
 {
-	if (m_socket && !IsLocal())
+	if (m_network && !IsLocal())
 	{
-		// Traverse all realtime input proxies. Because this is a networked game, the input isn't handled directly
-		for (auto pair : m_action_proxies)
+		// Held actions from the latest input frame are replayed every update
+		for (int i = 0; i < static_cast<int>(PlayerAction::kActionCount); ++i)
 		{
-			if (pair.second && IsRealtimeAction(pair.first))
-				commands.Push(m_action_binding[pair.first]);
+			const PlayerAction action = static_cast<PlayerAction>(i);
+			if ((m_remote_mask & ToInputMask(action)) && IsRealtimeAction(action))
+				commands.Push(m_action_binding[action]);
 		}
 	}
 }
 
-void Player::HandleNetworkEvent(PlayerAction action, CommandQueue& commands)
+void Player::SendInputFrame()
 {
-	commands.Push(m_action_binding[action]);
+	if (!m_network || !IsLocal())
+	{
+		return;
+	}
+
+	const opt::InputMask previous_mask = m_input_history[m_input_tick % INPUT_REDUNDANCY];
+	++m_input_tick;
+	m_input_history[m_input_tick % INPUT_REDUNDANCY] = m_frame_mask;
+	m_frame_mask = 0;
+
+	const opt::InputMask mask = m_input_history[m_input_tick % INPUT_REDUNDANCY];
+	m_frames_since_change = mask != previous_mask ? 0 : m_frames_since_change + 1;
+	++m_frames_since_send;
+
+	// Send on every change. While an action is held, or shortly after a change, the frames are repeated
+	// every few ticks so a lost packet is recovered without waiting for the next change
+	const bool changed = m_frames_since_change == 0;
+	const bool refresh = m_frames_since_send >= INPUT_REDUNDANCY && (mask != 0 || m_frames_since_change <= INPUT_REDUNDANCY);
+	if (!changed && !refresh)
+	{
+		return;
+	}
+
+	const std::size_t frame_count = std::min<std::size_t>(INPUT_REDUNDANCY, m_input_tick);
+
+	sf::Packet packet;
+	packet << static_cast<opt::ClientPacket>(Client::PacketType::PlayerInput);
+	packet << m_identifier << m_input_tick << static_cast<sf::Uint8>(frame_count);
+	for (std::size_t i = 0; i < frame_count; ++i)
+	{
+		packet << m_input_history[(m_input_tick - i) % INPUT_REDUNDANCY];
+	}
+
+	//Send time on the server's clock for latency tracing, negative until the clock is synced
+	packet << (m_network->IsClockSynced() ? m_network->GetServerTime().asMicroseconds() : sf::Int64(-1));
+
+	m_network->Send(packet);
+	m_frames_since_send = 0;
 }
 
-void Player::HandleNetworkRealtimeChange(PlayerAction action, bool actionEnabled)
+void Player::HandleNetworkInput(opt::InputTick newest_tick, const std::vector<opt::InputMask>& masks, CommandQueue& commands)
 {
-	m_action_proxies[action] = actionEnabled;
+	// Apply the frames oldest first, skipping any that arrived in an earlier packet
+	for (std::size_t i = masks.size(); i-- > 0;)
+	{
+		const opt::InputTick tick = newest_tick - static_cast<opt::InputTick>(i);
+		if (m_has_remote_input && static_cast<sf::Int32>(tick - m_last_input_tick) <= 0)
+		{
+			continue;
+		}
+
+		ApplyInputFrame(masks[i], commands);
+		m_last_input_tick = tick;
+		m_has_remote_input = true;
+	}
+}
+
+void Player::ApplyInputFrame(opt::InputMask mask, CommandQueue& commands)
+{
+	m_remote_mask = mask;
+
+	// Events only fire on the frame they are recorded in
+	for (int i = 0; i < static_cast<int>(PlayerAction::kActionCount); ++i)
+	{
+		const PlayerAction action = static_cast<PlayerAction>(i);
+		if ((mask & ToInputMask(action)) && !IsRealtimeAction(action))
+			commands.Push(m_action_binding[action]);
+	}
 }
 
 void Player::SetMissionStatus(MissionStatus status)
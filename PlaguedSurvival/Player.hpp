@@ -1,44 +1,61 @@
 #pragma once
 #include "Command.hpp"
 #include "KeyBinding.hpp"
-#include <SFML/Network/TcpSocket.hpp>
 #include <SFML/Window/Event.hpp>
+#include <array>
 #include <map>
 #include <unordered_set>
 
 #include "CommandQueue.hpp"
 #include "MissionStatus.hpp"
 #include "NetworkOptimisations.hpp"
+#include "NetworkProtocol.hpp"
 #include "PlayerAction.hpp"
 
+class ClientNetwork;
+
 class Player
 {
 public:
-	Player(sf::TcpSocket* socket, opt::PlayerIdentifier identifier, const KeyBinding* binding);
+	Player(ClientNetwork* network, opt::PlayerIdentifier identifier, const KeyBinding* binding);
 	void HandleEvent(const sf::Event& event, CommandQueue& commands);
 	void HandleRealtimeInput(CommandQueue& commands);
 	void HandleRealtimeNetworkInput(CommandQueue& commands);
 
-	//React to events or realtime state changes recevied over the network
-	void HandleNetworkEvent(PlayerAction action, CommandQueue& commands);
-	void HandleNetworkRealtimeChange(PlayerAction action, bool action_enabled);
+	//Sends this frame's input bitmask (with the previous frames repeated) for a local networked player
+	void SendInputFrame();
+	//Applies input frames received over the network, masks are ordered newest first
+	void HandleNetworkInput(opt::InputTick newest_tick, const std::vector<opt::InputMask>& masks, CommandQueue& commands);
 
 	void SetMissionStatus(MissionStatus status);
 	MissionStatus GetMissionStatus() const;
 
 	void DisableAllRealtimeActions();
 	bool IsLocal() const;
+	void SetNetwork(ClientNetwork* network);
 
 private:
 	void InitialiseActions();
+	void ApplyInputFrame(opt::InputMask mask, CommandQueue& commands);
 
 private:
 	const KeyBinding* m_key_binding;
 	std::map<PlayerAction, Command> m_action_binding;
 	std::map<PlayerAction, Command> m_on_release_action_binding;
-	std::map<PlayerAction, bool> m_action_proxies;
 	std::unordered_set<PlayerAction> m_active_actions;
 	MissionStatus m_current_mission_status;
 	opt::PlayerIdentifier m_identifier;
-	sf::TcpSocket* m_socket;
+	ClientNetwork* m_network;
+
+	//Local input stream
+	opt::InputMask m_frame_mask;
+	opt::InputTick m_input_tick;
+	std::array<opt::InputMask, INPUT_REDUNDANCY> m_input_history;
+	std::size_t m_frames_since_send;
+	std::size_t m_frames_since_change;
+
+	//Remote input stream
+	opt::InputMask m_remote_mask;
+	opt::InputTick m_last_input_tick;
+	bool m_has_remote_input;
 };
\ No newline at end of file
@@ -1,4 +1,6 @@
 #pragma once
+#include "NetworkOptimisations.hpp"
+
 enum class PlayerAction
 {
 	kMoveLeft,
@@ -7,4 +9,10 @@ enum class PlayerAction
 	kAttack,
 
 	kActionCount
-};
\ No newline at end of file
+};
+
+//Each action owns one bit of a networked input frame
+inline opt::InputMask ToInputMask(PlayerAction action)
+{
+	return static_cast<opt::InputMask>(1 << static_cast<int>(action));
+}
@@ -1,6 +1,8 @@
 #pragma once
 #include <SFML/Graphics/Color.hpp>
 
+#include "NetworkOptimisations.hpp"
+
 /**
  * Vilandas Morrissey - D00218436
  */
@@ -22,6 +24,8 @@ enum class PlayerColors
 	kMint,
 	kDarkGreen,
 	kTeal,
+
+	kColorCount
 };
 
 namespace ExtraColors
@@ -54,8 +58,24 @@ namespace ExtraColors
 		case PlayerColors::kDarkGreen: return DarkGreen;
 		case PlayerColors::kBrown: return Brown;
 		case PlayerColors::kMint: return Mint;
+		case PlayerColors::kColorCount: break;
 		}
 
 		return sf::Color::White;
 	}
+
+	//Large lobbies reuse the palette, each pass around it is drawn a little darker
+	inline sf::Color GetPlayerColor(opt::PlayerIdentifier identifier)
+	{
+		const int color_count = static_cast<int>(PlayerColors::kColorCount);
+		const int index = (identifier - 1) % color_count;
+		const int pass = (identifier - 1) / color_count;
+
+		const sf::Color color = GetColor(static_cast<PlayerColors>(index));
+		const float shade = 1.f / (1.f + 0.35f * (pass % 4));
+		return sf::Color(
+			static_cast<sf::Uint8>(color.r * shade),
+			static_cast<sf::Uint8>(color.g * shade),
+			static_cast<sf::Uint8>(color.b * shade));
+	}
 }
\ No newline at end of file
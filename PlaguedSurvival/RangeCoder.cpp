@@ -0,0 +1,223 @@
+#include "RangeCoder.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <SFML/Network/Packet.hpp>
+
+/**
+ * Vilandas Morrissey - D00218436
+ */
+
+namespace
+{
+	//Bytes are shifted out once the top 8 bits of the interval are settled
+	const sf::Uint32 Top = 1u << 24;
+	const sf::Uint32 Bottom = 1u << 16;
+
+	/// <summary>
+	/// Used until a model has been trained from recorded matches. Snapshot payloads are mostly
+	/// flags and the low bytes of small varints, so small values are weighted heavily.
+	/// </summary>
+	RangeModel::Histogram CreatePriorHistogram()
+	{
+		RangeModel::Histogram counts;
+		for (int symbol = 0; symbol < RangeModel::SYMBOLS; ++symbol)
+		{
+			const int magnitude = symbol & 0x7F;
+			counts[symbol] = 1 + 1024 / (1 + magnitude) + (symbol < 0x80 ? 8 : 0);
+		}
+		return counts;
+	}
+}
+
+RangeModel::RangeModel()
+	: RangeModel(CreatePriorHistogram())
+{
+}
+
+/// <summary>
+/// Scales the counts to TOTAL, keeping every symbol codable. Whatever rounding leaves over goes to the most common symbol.
+/// </summary>
+RangeModel::RangeModel(const Histogram& counts)
+{
+	sf::Uint64 sum = 0;
+	for (sf::Uint64 count : counts)
+	{
+		sum += count;
+	}
+
+	const sf::Uint64 available = TOTAL - SYMBOLS;
+	std::array<sf::Uint16, SYMBOLS> frequencies;
+	sf::Uint32 assigned = 0;
+	int most_common = 0;
+
+	for (int symbol = 0; symbol < SYMBOLS; ++symbol)
+	{
+		const sf::Uint64 share = sum == 0 ? available / SYMBOLS : counts[symbol] * available / sum;
+		frequencies[symbol] = static_cast<sf::Uint16>(1 + share);
+		assigned += frequencies[symbol];
+
+		if (counts[symbol] > counts[most_common])
+		{
+			most_common = symbol;
+		}
+	}
+
+	frequencies[most_common] = static_cast<sf::Uint16>(frequencies[most_common] + (TOTAL - assigned));
+	SetFrequencies(frequencies);
+}
+
+sf::Uint32 RangeModel::GetFrequency(sf::Uint8 symbol) const
+{
+	return m_frequencies[symbol];
+}
+
+sf::Uint32 RangeModel::GetCumulative(sf::Uint8 symbol) const
+{
+	return m_cumulative[symbol];
+}
+
+sf::Uint8 RangeModel::FindSymbol(sf::Uint32 value) const
+{
+	return m_symbols[value];
+}
+
+void RangeModel::Write(sf::Packet& packet) const
+{
+	for (sf::Uint16 frequency : m_frequencies)
+	{
+		packet << frequency;
+	}
+}
+
+/// <summary>
+/// Reads a model sent by the server, it is only replaced if the frequencies add up to TOTAL.
+/// </summary>
+bool RangeModel::Read(sf::Packet& packet)
+{
+	std::array<sf::Uint16, SYMBOLS> frequencies;
+	sf::Uint32 sum = 0;
+
+	for (sf::Uint16& frequency : frequencies)
+	{
+		if (!(packet >> frequency) || frequency == 0)
+		{
+			return false;
+		}
+		sum += frequency;
+	}
+
+	if (sum != TOTAL)
+	{
+		return false;
+	}
+
+	SetFrequencies(frequencies);
+	return true;
+}
+
+bool RangeModel::LoadHistogram(const std::string& filename, Histogram& counts)
+{
+	std::ifstream input_file(filename);
+	for (sf::Uint64& count : counts)
+	{
+		if (!(input_file >> count))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void RangeModel::SaveHistogram(const std::string& filename, const Histogram& counts)
+{
+	std::ofstream output_file(filename);
+	for (sf::Uint64 count : counts)
+	{
+		output_file << count << "\n";
+	}
+}
+
+void RangeModel::SetFrequencies(const std::array<sf::Uint16, SYMBOLS>& frequencies)
+{
+	m_frequencies = frequencies;
+	m_cumulative[0] = 0;
+
+	for (int symbol = 0; symbol < SYMBOLS; ++symbol)
+	{
+		m_cumulative[symbol + 1] = static_cast<sf::Uint16>(m_cumulative[symbol] + m_frequencies[symbol]);
+		std::fill(m_symbols.begin() + m_cumulative[symbol], m_symbols.begin() + m_cumulative[symbol + 1], static_cast<sf::Uint8>(symbol));
+	}
+}
+
+void RangeCoder::Encode(const RangeModel& model, const sf::Uint8* data, std::size_t size, std::vector<sf::Uint8>& out)
+{
+	sf::Uint32 low = 0;
+	sf::Uint32 range = 0xFFFFFFFF;
+
+	for (std::size_t i = 0; i < size; ++i)
+	{
+		range >>= RangeModel::TOTAL_BITS;
+		low += model.GetCumulative(data[i]) * range;
+		range *= model.GetFrequency(data[i]);
+
+		//Shift out settled bytes. If the interval straddles a byte boundary while too small, it is cut down instead of carrying
+		while ((low ^ (low + range)) < Top || (range < Bottom && ((range = (0u - low) & (Bottom - 1)), true)))
+		{
+			out.emplace_back(static_cast<sf::Uint8>(low >> 24));
+			low <<= 8;
+			range <<= 8;
+		}
+	}
+
+	for (int i = 0; i < 4; ++i)
+	{
+		out.emplace_back(static_cast<sf::Uint8>(low >> 24));
+		low <<= 8;
+	}
+}
+
+/// <summary>
+/// Decodes exactly decoded_size bytes. Returns false if the input is corrupt.
+/// </summary>
+bool RangeCoder::Decode(const RangeModel& model, const sf::Uint8* data, std::size_t size, std::size_t decoded_size, std::vector<sf::Uint8>& out)
+{
+	std::size_t position = 0;
+	const auto next_byte = [&]()
+	{
+		return position < size ? data[position++] : static_cast<sf::Uint8>(0);
+	};
+
+	sf::Uint32 low = 0;
+	sf::Uint32 range = 0xFFFFFFFF;
+	sf::Uint32 code = 0;
+	for (int i = 0; i < 4; ++i)
+	{
+		code = (code << 8) | next_byte();
+	}
+
+	for (std::size_t i = 0; i < decoded_size; ++i)
+	{
+		range >>= RangeModel::TOTAL_BITS;
+		const sf::Uint32 value = (code - low) / range;
+		if (value >= RangeModel::TOTAL)
+		{
+			return false;
+		}
+
+		const sf::Uint8 symbol = model.FindSymbol(value);
+		out.emplace_back(symbol);
+
+		low += model.GetCumulative(symbol) * range;
+		range *= model.GetFrequency(symbol);
+
+		while ((low ^ (low + range)) < Top || (range < Bottom && ((range = (0u - low) & (Bottom - 1)), true)))
+		{
+			code = (code << 8) | next_byte();
+			low <<= 8;
+			range <<= 8;
+		}
+	}
+
+	return true;
+}
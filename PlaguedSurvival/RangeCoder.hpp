@@ -0,0 +1,60 @@
+#pragma once
+#include <array>
+#include <string>
+#include <vector>
+#include <SFML/Config.hpp>
+
+/**
+ * Vilandas Morrissey - D00218436
+ */
+
+namespace sf
+{
+	class Packet;
+}
+
+/// <summary>
+/// Static byte frequency table for the range coder. Every symbol keeps a frequency of at least one,
+/// so any byte can be coded even if it never appeared in the traffic the model was trained on.
+/// </summary>
+class RangeModel
+{
+public:
+	static constexpr int SYMBOLS = 256;
+	static constexpr int TOTAL_BITS = 12;
+	static constexpr sf::Uint32 TOTAL = 1u << TOTAL_BITS;
+
+	typedef std::array<sf::Uint64, SYMBOLS> Histogram;
+
+public:
+	RangeModel();
+	explicit RangeModel(const Histogram& counts);
+
+	sf::Uint32 GetFrequency(sf::Uint8 symbol) const;
+	sf::Uint32 GetCumulative(sf::Uint8 symbol) const;
+	sf::Uint8 FindSymbol(sf::Uint32 value) const;
+
+	void Write(sf::Packet& packet) const;
+	bool Read(sf::Packet& packet);
+
+	static bool LoadHistogram(const std::string& filename, Histogram& counts);
+	static void SaveHistogram(const std::string& filename, const Histogram& counts);
+
+private:
+	void SetFrequencies(const std::array<sf::Uint16, SYMBOLS>& frequencies);
+
+private:
+	std::array<sf::Uint16, SYMBOLS> m_frequencies;
+	std::array<sf::Uint16, SYMBOLS + 1> m_cumulative;
+	std::array<sf::Uint8, TOTAL> m_symbols;
+};
+
+/// <summary>
+/// Carry-less 32 bit range coder over whole bytes with a static model.
+/// </summary>
+class RangeCoder
+{
+public:
+	static void Encode(const RangeModel& model, const sf::Uint8* data, std::size_t size, std::vector<sf::Uint8>& out);
+	static bool Decode(const RangeModel& model, const sf::Uint8* data, std::size_t size, std::size_t decoded_size, std::vector<sf::Uint8>& out);
+};
@@ -18,46 +18,268 @@ SceneNode::SceneNode(
 	: m_scene_layers(scene_layers)
 	, m_children()
 	, m_parent(nullptr)
+	, m_child_index(0)
 	, m_default_category(category)
+	, m_subscribed(false)
+	, m_subscribed_category(Category::kNone)
+	, m_command_slots()
+	, m_asleep(false)
+	, m_marked_for_removal(false)
+	, m_removals()
+	, m_world_transform()
+	, m_world_bounds()
+	, m_transform_dirty(true)
+	, m_bounds_dirty(true)
 {
 }
 
+//Children are destroyed after this and unsubscribe themselves
+SceneNode::~SceneNode()
+{
+	if (m_subscribed)
+	{
+		CommandDispatcher::Instance().Unsubscribe(this, m_subscribed_category, m_command_slots);
+	}
+}
+
 void SceneNode::AttachChild(Ptr child)
 {
 	child->m_parent = this;
+	child->m_child_index = m_children.size();
+	child->MarkTransformDirty();
+
+	//Nodes marked while the child was detached were queued on the child, they move to this scene's queue
+	if (child->m_marked_for_removal || !child->m_removals.empty())
+	{
+		std::vector<SceneNode*>& removals = GetRoot().m_removals;
+		if (child->m_marked_for_removal)
+		{
+			removals.emplace_back(child.get());
+		}
+		removals.insert(removals.end(), child->m_removals.begin(), child->m_removals.end());
+		child->m_removals.clear();
+	}
+
+	if (!child->m_asleep)
+	{
+		Wake();
+	}
+
+	if (m_subscribed)
+	{
+		child->SubscribeToCommands();
+	}
+
 	m_children.emplace_back(std::move(child));
 }
 
+/// <summary>
+/// Constant time while nothing is marked, the last child takes the detached child's place so the order of the children changes.
+/// Marked nodes in the detached subtree leave the scene's queue and are queued on the detached node until it is attached again.
+/// </summary>
 SceneNode::Ptr SceneNode::DetachChild(const SceneNode& node)
 {
-	const auto found = std::find_if(m_children.begin(), m_children.end(), [&](Ptr& p) {return p.get() == &node; });
-	assert(found != m_children.end());
+	assert(node.m_parent == this);
+
+	std::vector<SceneNode*>& removals = GetRoot().m_removals;
+	Ptr result = RemoveChildAt(node.m_child_index);
+
+	if (!removals.empty())
+	{
+		const auto detached = std::partition(removals.begin(), removals.end(), [&](SceneNode* marked)
+			{
+				return !marked->IsInSubtreeOf(*result);
+			});
+
+		//The detached node itself is queued again from its flag when it is attached
+		for (auto it = detached; it != removals.end(); ++it)
+		{
+			if (*it != result.get())
+			{
+				result->m_removals.emplace_back(*it);
+			}
+		}
+		removals.erase(detached, removals.end());
+	}
 
-	Ptr result = std::move(*found);
-	result->m_parent = nullptr;
-	m_children.erase(found);
 	return result;
 }
 
+//A sleeping node and everything under it is skipped until it is woken
 void SceneNode::Update(sf::Time dt, CommandQueue& commands)
 {
+	if (m_asleep) return;
+
 	UpdateCurrent(dt, commands);
 	UpdateChildren(dt, commands);
 }
 
+/// <summary>
+/// Updates this node and those under it down to depth levels below, and collects the awake nodes at that depth
+/// in tree order instead of updating them, so their subtrees can be updated separately.
+/// The world transforms above the split are filled in here, the nodes below only read them.
+/// </summary>
+void SceneNode::UpdateAbove(std::size_t depth, sf::Time dt, CommandQueue& commands, std::vector<SceneNode*>& subtrees)
+{
+	if (m_asleep) return;
+
+	if (depth == 0)
+	{
+		subtrees.emplace_back(this);
+		return;
+	}
+
+	UpdateCurrent(dt, commands);
+	GetWorldTransform();
+
+	for (Ptr& child : m_children)
+	{
+		child->UpdateAbove(depth - 1, dt, commands, subtrees);
+	}
+}
+
+/// <summary>
+/// True if updating this node's subtree only changes the nodes in it and things nothing else touches while
+/// the scene is updated, so it can run at the same time as other subtrees
+/// </summary>
+bool SceneNode::CanUpdateConcurrently() const
+{
+	return false;
+}
+
+/// <summary>
+/// For nodes with nothing to do until something happens to them. Commands, collisions and drawing
+/// still reach a sleeping node, whatever changes it is expected to wake it.
+/// </summary>
+void SceneNode::Sleep()
+{
+	m_asleep = true;
+}
+
+//Ancestors are woken too, otherwise they would still skip this node. Only sleeping nodes are written to,
+//nodes updating concurrently share awake ancestors.
+void SceneNode::Wake()
+{
+	for (SceneNode* node = this; node != nullptr; node = node->m_parent)
+	{
+		if (node->m_asleep)
+		{
+			node->m_asleep = false;
+		}
+	}
+}
+
+bool SceneNode::IsAsleep() const
+{
+	return m_asleep;
+}
+
+void SceneNode::setPosition(float x, float y)
+{
+	Transformable::setPosition(x, y);
+	MarkTransformDirty();
+}
+
+void SceneNode::setPosition(const sf::Vector2f& position)
+{
+	Transformable::setPosition(position);
+	MarkTransformDirty();
+}
+
+void SceneNode::setRotation(float angle)
+{
+	Transformable::setRotation(angle);
+	MarkTransformDirty();
+}
+
+void SceneNode::setScale(float factor_x, float factor_y)
+{
+	Transformable::setScale(factor_x, factor_y);
+	MarkTransformDirty();
+}
+
+void SceneNode::setScale(const sf::Vector2f& factors)
+{
+	Transformable::setScale(factors);
+	MarkTransformDirty();
+}
+
+void SceneNode::setOrigin(float x, float y)
+{
+	Transformable::setOrigin(x, y);
+	MarkTransformDirty();
+}
+
+void SceneNode::setOrigin(const sf::Vector2f& origin)
+{
+	Transformable::setOrigin(origin);
+	MarkTransformDirty();
+}
+
+void SceneNode::move(float offset_x, float offset_y)
+{
+	Transformable::move(offset_x, offset_y);
+	MarkTransformDirty();
+}
+
+void SceneNode::move(const sf::Vector2f& offset)
+{
+	Transformable::move(offset);
+	MarkTransformDirty();
+}
+
+void SceneNode::rotate(float angle)
+{
+	Transformable::rotate(angle);
+	MarkTransformDirty();
+}
+
+void SceneNode::scale(float factor_x, float factor_y)
+{
+	Transformable::scale(factor_x, factor_y);
+	MarkTransformDirty();
+}
+
+void SceneNode::scale(const sf::Vector2f& factor)
+{
+	Transformable::scale(factor);
+	MarkTransformDirty();
+}
+
 sf::Vector2f SceneNode::GetWorldPosition() const
 {
 	return GetWorldTransform() * sf::Vector2f();
 }
 
-sf::Transform SceneNode::GetWorldTransform() const
+/// <summary>
+/// Only recalculated after this node or one of its ancestors has been transformed
+/// </summary>
+const sf::Transform& SceneNode::GetWorldTransform() const
 {
-	sf::Transform transform = sf::Transform::Identity;
-	for (const SceneNode* node = this; node != nullptr; node = node->m_parent)
+	if (m_transform_dirty)
 	{
-		transform = node->getTransform() * transform;
+		m_world_transform = m_parent != nullptr
+			? m_parent->GetWorldTransform() * getTransform()
+			: getTransform();
+		m_transform_dirty = false;
 	}
-	return transform;
+	return m_world_transform;
+}
+
+/// <summary>
+/// The local bounds in world space, only recalculated when the world transform changes, so GetLocalBounds must not change by itself
+/// </summary>
+const sf::FloatRect& SceneNode::GetBoundingRect() const
+{
+	if (m_bounds_dirty)
+	{
+		const sf::FloatRect local_bounds = GetLocalBounds();
+		m_world_bounds = local_bounds == sf::FloatRect()
+			? sf::FloatRect()
+			: GetWorldTransform().transformRect(local_bounds);
+		m_bounds_dirty = false;
+	}
+	return m_world_bounds;
 }
 
 const SceneNode::SceneLayers& SceneNode::GetSceneLayers() const
@@ -65,18 +287,34 @@ const SceneNode::SceneLayers& SceneNode::GetSceneLayers() const
 	return m_scene_layers;
 }
 
-void SceneNode::OnCommand(const Command& command, sf::Time dt)
+/// <summary>
+/// Subscribes this node and everything under it to the commands for their categories.
+/// Children attached later are subscribed as they are attached.
+/// </summary>
+void SceneNode::SubscribeToCommands()
 {
-	//Is this command for me?
-	if (command.category & GetCategory())
+	if (m_subscribed) return;
+
+	m_subscribed = true;
+	m_subscribed_category = GetCategory();
+	CommandDispatcher::Instance().Subscribe(this, m_subscribed_category, m_command_slots);
+
+	for (const Ptr& child : m_children)
 	{
-		command.action(*this, dt);
+		child->SubscribeToCommands();
 	}
+}
+
+void SceneNode::UnsubscribeFromCommands()
+{
+	if (!m_subscribed) return;
+
+	m_subscribed = false;
+	CommandDispatcher::Instance().Unsubscribe(this, m_subscribed_category, m_command_slots);
 
-	//Pass command on to children
 	for (const Ptr& child : m_children)
 	{
-		child->OnCommand(command, dt);
+		child->UnsubscribeFromCommands();
 	}
 }
 
@@ -85,7 +323,8 @@ unsigned int SceneNode::GetCategory() const
 	return static_cast<int>(m_default_category);
 }
 
-sf::FloatRect SceneNode::GetBoundingRect() const
+//Nodes without a collider have no bounds
+sf::FloatRect SceneNode::GetLocalBounds() const
 {
 	return {};
 }
@@ -105,9 +344,26 @@ bool SceneNode::IsDestroyed() const
 	return false;
 }
 
+/// <summary>
+/// Queues this node and everything under it to be removed from the scene at the next RemoveMarked.
+/// Not for concurrent updates, the queue is shared by the whole scene.
+/// </summary>
+void SceneNode::MarkForRemoval()
+{
+	if (m_marked_for_removal) return;
+
+	m_marked_for_removal = true;
+
+	//Queued on the root of whatever tree it is in, a node marked before it is attached is queued as it is attached
+	if (m_parent != nullptr)
+	{
+		GetRoot().m_removals.emplace_back(this);
+	}
+}
+
 bool SceneNode::IsMarkedForRemoval() const
 {
-	return IsDestroyed();
+	return m_marked_for_removal;
 }
 
 void SceneNode::PredictCollisionsWithScene(SceneNode& scene_graph, std::set<SceneNode*>& collisions)
@@ -123,11 +379,6 @@ void SceneNode::PredictCollisionsWithScene(SceneNode& scene_graph, std::set<Scen
 	}
 }
 
-void SceneNode::PredictCollisionsWithChunks(Layers layer, std::set<SceneNode*>& collisions)
-{
-	WorldChunks::Instance().CheckCollision(this, layer, collisions);
-}
-
 void SceneNode::PredictCollisionWithNode(SceneNode& scene_node, std::set<SceneNode*>& collisions)
 {
 	if (this != &scene_node && Collision::Intersects(*this, scene_node) && !IsDestroyed() && !scene_node.IsDestroyed())
@@ -136,11 +387,24 @@ void SceneNode::PredictCollisionWithNode(SceneNode& scene_node, std::set<SceneNo
 	}
 }
 
-void SceneNode::RemoveWrecks()
+/// <summary>
+/// Removes and destroys the nodes marked since the last call, to be called on the root.
+/// Costs nothing when nothing has been marked.
+/// </summary>
+void SceneNode::RemoveMarked()
 {
-	auto wreck_field_begin = std::remove_if(m_children.begin(), m_children.end(), std::mem_fn(&SceneNode::IsMarkedForRemoval));
-	m_children.erase(wreck_field_begin, m_children.end());
-	std::for_each(m_children.begin(), m_children.end(), std::mem_fn(&SceneNode::RemoveWrecks));
+	if (m_removals.empty()) return;
+
+	//Everything is detached before anything is destroyed, a marked node can be under another marked node
+	std::vector<Ptr> removed;
+	removed.reserve(m_removals.size());
+
+	for (SceneNode* node : m_removals)
+	{
+		removed.emplace_back(node->m_parent->RemoveChildAt(node->m_child_index));
+	}
+
+	m_removals.clear();
 }
 
 void SceneNode::HandleCollisions()
@@ -194,6 +458,57 @@ void SceneNode::DrawChildren(sf::RenderTarget& target, sf::RenderStates states)
 	}
 }
 
+void SceneNode::MarkTransformDirty()
+{
+	if (m_transform_dirty) return;
+
+	m_transform_dirty = true;
+	m_bounds_dirty = true;
+	for (const Ptr& child : m_children)
+	{
+		child->MarkTransformDirty();
+	}
+}
+
+SceneNode& SceneNode::GetRoot()
+{
+	SceneNode* root = this;
+	while (root->m_parent != nullptr)
+	{
+		root = root->m_parent;
+	}
+	return *root;
+}
+
+bool SceneNode::IsInSubtreeOf(const SceneNode& node) const
+{
+	for (const SceneNode* ancestor = this; ancestor != nullptr; ancestor = ancestor->m_parent)
+	{
+		if (ancestor == &node)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+SceneNode::Ptr SceneNode::RemoveChildAt(std::size_t index)
+{
+	Ptr result = std::move(m_children[index]);
+
+	if (index != m_children.size() - 1)
+	{
+		m_children[index] = std::move(m_children.back());
+		m_children[index]->m_child_index = index;
+	}
+	m_children.pop_back();
+
+	result->m_parent = nullptr;
+	result->MarkTransformDirty();
+	result->UnsubscribeFromCommands();
+	return result;
+}
+
 void SceneNode::DrawBoundingRect(sf::RenderTarget& target, sf::RenderStates states, const sf::FloatRect& rect)
 {
 	sf::RectangleShape shape;
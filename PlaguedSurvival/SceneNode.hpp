@@ -9,17 +9,20 @@
 #include <set>
 
 #include "Command.hpp"
+#include "CommandDispatcher.hpp"
 #include "CommandQueue.hpp"
 #include "Layers.hpp"
 #include "Utility.hpp"
-#include "WorldChunks.hpp"
 #include "WorldInfo.hpp"
 
 /**
  * Vilandas Morrissey - D00218436
  */
 
-class SceneNode : public sf::Transformable, public sf::Drawable, private sf::NonCopyable
+//sf::Transformable is a private base so every change to the transform goes through the setters below,
+//which invalidate the cached world transform. Its setters are not virtual, a public base would let
+//a call through sf::Transformable& skip them.
+class SceneNode : private sf::Transformable, public sf::Drawable, private sf::NonCopyable
 {
 public:
 	typedef  std::unique_ptr<SceneNode> Ptr;
@@ -30,32 +33,61 @@ public:
 	explicit SceneNode(
 		const SceneLayers& scene_layers,
 		Category::Type category = Category::kNone);
+	~SceneNode();
 
 	void AttachChild(Ptr child);
 	Ptr DetachChild(const SceneNode& node);
 
 	void Update(sf::Time dt, CommandQueue& commands);
+	void UpdateAbove(std::size_t depth, sf::Time dt, CommandQueue& commands, std::vector<SceneNode*>& subtrees);
+	virtual bool CanUpdateConcurrently() const;
+	void Sleep();
+	void Wake();
+	bool IsAsleep() const;
+
+	using sf::Transformable::getPosition;
+	using sf::Transformable::getRotation;
+	using sf::Transformable::getScale;
+	using sf::Transformable::getOrigin;
+	using sf::Transformable::getTransform;
+	using sf::Transformable::getInverseTransform;
+
+	//Wrap sf::Transformable's versions so any change to the transform invalidates the cached world transform
+	void setPosition(float x, float y);
+	void setPosition(const sf::Vector2f& position);
+	void setRotation(float angle);
+	void setScale(float factor_x, float factor_y);
+	void setScale(const sf::Vector2f& factors);
+	void setOrigin(float x, float y);
+	void setOrigin(const sf::Vector2f& origin);
+	void move(float offset_x, float offset_y);
+	void move(const sf::Vector2f& offset);
+	void rotate(float angle);
+	void scale(float factor_x, float factor_y);
+	void scale(const sf::Vector2f& factor);
 
 	sf::Vector2f GetWorldPosition() const;
-	sf::Transform GetWorldTransform() const;
+	const sf::Transform& GetWorldTransform() const;
+	const sf::FloatRect& GetBoundingRect() const;
 	const SceneLayers& GetSceneLayers() const;
 
-	void OnCommand(const Command& command, sf::Time dt);
+	void SubscribeToCommands();
+	void UnsubscribeFromCommands();
 	virtual unsigned int GetCategory() const;
-	virtual sf::FloatRect GetBoundingRect() const;
 	virtual sf::Vector2f GetVelocity() const;
 	virtual float GetDeltaTimeInSeconds() const;
 
 	virtual bool IsDestroyed() const;
-	virtual bool IsMarkedForRemoval() const;
+	void MarkForRemoval();
+	bool IsMarkedForRemoval() const;
 
 	void PredictCollisionsWithScene(SceneNode& scene_graph, std::set<SceneNode*>& collisions);
-	void PredictCollisionsWithChunks(Layers layer, std::set<SceneNode*>& collisions);
 	void PredictCollisionWithNode(SceneNode& scene_node, std::set<SceneNode*>& collisions);
-	void RemoveWrecks();
+	void RemoveMarked();
 
 protected:
 	virtual void HandleCollisions();
+	virtual sf::FloatRect GetLocalBounds() const;
 
 private:
 	virtual void UpdateCurrent(sf::Time dt, CommandQueue& commands);
@@ -68,11 +100,32 @@ private:
 
 	static void DrawBoundingRect(sf::RenderTarget& target, sf::RenderStates states, const sf::FloatRect& bounding_rect);
 
+	void MarkTransformDirty();
+	SceneNode& GetRoot();
+	bool IsInSubtreeOf(const SceneNode& node) const;
+	Ptr RemoveChildAt(std::size_t index);
+
 private:
 	const SceneLayers& m_scene_layers;
 	std::vector<Ptr> m_children;
 	SceneNode* m_parent;
+	//Where this node is in its parent's children
+	std::size_t m_child_index;
 	Category::Type m_default_category;
+	bool m_subscribed;
+	unsigned int m_subscribed_category;
+	CommandDispatcher::Slots m_command_slots;
+	bool m_asleep;
+	bool m_marked_for_removal;
+	//Only used on the root of a tree, the nodes to remove at the next RemoveMarked
+	std::vector<SceneNode*> m_removals;
+
+	//A clean node always has clean ancestors, so a dirty node always has dirty descendants.
+	//Filled in on first use, so not safe to read from several threads until it is clean
+	mutable sf::Transform m_world_transform;
+	mutable sf::FloatRect m_world_bounds;
+	mutable bool m_transform_dirty;
+	mutable bool m_bounds_dirty;
 };
 bool Collision(const SceneNode& lhs, const SceneNode& rhs);
 float Distance(const SceneNode& lhs, const SceneNode& rhs);
\ No newline at end of file
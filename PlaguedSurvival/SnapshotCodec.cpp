@@ -0,0 +1,195 @@
+#include "SnapshotCodec.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <SFML/Network/Packet.hpp>
+
+#include "RangeCoder.hpp"
+
+/**
+ * Vilandas Morrissey - D00218436
+ */
+
+namespace
+{
+	const float PositionScale = 8.f;
+
+	//Zigzag keeps small negative changes as small as positive ones
+	void WriteVarint(sf::Uint32 value, std::vector<sf::Uint8>& out)
+	{
+		while (value >= 0x80)
+		{
+			out.emplace_back(static_cast<sf::Uint8>(value | 0x80));
+			value >>= 7;
+		}
+		out.emplace_back(static_cast<sf::Uint8>(value));
+	}
+
+	void WriteSigned(sf::Int32 value, std::vector<sf::Uint8>& out)
+	{
+		WriteVarint((static_cast<sf::Uint32>(value) << 1) ^ static_cast<sf::Uint32>(value >> 31), out);
+	}
+
+	bool ReadVarint(const std::vector<sf::Uint8>& data, std::size_t& position, sf::Uint32& value)
+	{
+		value = 0;
+		for (int shift = 0; shift < 35; shift += 7)
+		{
+			if (position >= data.size())
+			{
+				return false;
+			}
+
+			const sf::Uint8 byte = data[position++];
+			value |= static_cast<sf::Uint32>(byte & 0x7F) << shift;
+			if ((byte & 0x80) == 0)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool ReadSigned(const std::vector<sf::Uint8>& data, std::size_t& position, sf::Int32& value)
+	{
+		sf::Uint32 zigzag;
+		if (!ReadVarint(data, position, zigzag))
+		{
+			return false;
+		}
+		value = static_cast<sf::Int32>(zigzag >> 1) ^ -static_cast<sf::Int32>(zigzag & 1);
+		return true;
+	}
+
+	sf::Int32 Quantize(float value)
+	{
+		return static_cast<sf::Int32>(std::lround(value * PositionScale));
+	}
+}
+
+/// <summary>
+/// Sorts the entries by identifier and writes them. The baselines move to the quantized
+/// positions, so the entries are updated to what the client will decode.
+/// </summary>
+void SnapshotCodec::Encode(std::vector<Entry>& entries, std::vector<sf::Uint8>& out)
+{
+	std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b)
+		{
+			return a.m_identifier < b.m_identifier;
+		});
+
+	WriteVarint(static_cast<sf::Uint32>(entries.size()), out);
+
+	opt::PlayerIdentifier previous = 0;
+	for (Entry& entry : entries)
+	{
+		const sf::Vector2i quantized(Quantize(entry.m_position.x), Quantize(entry.m_position.y));
+		sf::Vector2i& baseline = m_baselines[entry.m_identifier];
+
+		WriteVarint(static_cast<sf::Uint32>(entry.m_identifier - previous), out);
+		WriteSigned(quantized.x - baseline.x, out);
+		WriteSigned(quantized.y - baseline.y, out);
+
+		baseline = quantized;
+		previous = entry.m_identifier;
+		entry.m_position = sf::Vector2f(quantized) / PositionScale;
+	}
+}
+
+/// <summary>
+/// Returns false if the payload is malformed, the baselines may then be out of step and the connection should be dropped.
+/// </summary>
+bool SnapshotCodec::Decode(const std::vector<sf::Uint8>& data, std::vector<Entry>& entries)
+{
+	entries.clear();
+
+	std::size_t position = 0;
+	sf::Uint32 count;
+	if (!ReadVarint(data, position, count))
+	{
+		return false;
+	}
+
+	sf::Uint32 identifier = 0;
+	for (sf::Uint32 i = 0; i < count; ++i)
+	{
+		sf::Uint32 gap;
+		sf::Vector2i change;
+		if (!ReadVarint(data, position, gap) || !ReadSigned(data, position, change.x) || !ReadSigned(data, position, change.y))
+		{
+			return false;
+		}
+
+		identifier += gap;
+		sf::Vector2i& baseline = m_baselines[static_cast<opt::PlayerIdentifier>(identifier)];
+		baseline += change;
+
+		Entry entry;
+		entry.m_identifier = static_cast<opt::PlayerIdentifier>(identifier);
+		entry.m_position = sf::Vector2f(baseline) / PositionScale;
+		entries.emplace_back(entry);
+	}
+
+	return position == data.size();
+}
+
+void SnapshotCodec::Forget(opt::PlayerIdentifier identifier)
+{
+	m_baselines.erase(identifier);
+}
+
+void SnapshotCodec::Reset()
+{
+	m_baselines.clear();
+}
+
+/// <summary>
+/// Appends a payload to a snapshot packet, range coded with the model when one is given and it comes out smaller.
+/// Returns the number of payload bytes that went into the packet.
+/// </summary>
+std::size_t SnapshotCodec::WritePayload(const RangeModel* model, const std::vector<sf::Uint8>& payload, std::vector<sf::Uint8>& coded, sf::Packet& packet)
+{
+	coded.clear();
+	if (model)
+	{
+		RangeCoder::Encode(*model, payload.data(), payload.size(), coded);
+	}
+
+	const bool is_coded = model && coded.size() < payload.size();
+	const std::vector<sf::Uint8>& data = is_coded ? coded : payload;
+
+	packet << is_coded
+		<< static_cast<sf::Uint16>(payload.size())
+		<< static_cast<sf::Uint16>(data.size());
+	packet.append(data.data(), data.size());
+
+	return data.size();
+}
+
+bool SnapshotCodec::ReadPayload(const RangeModel& model, sf::Packet& packet, std::vector<sf::Uint8>& data, std::vector<sf::Uint8>& payload)
+{
+	bool is_coded;
+	sf::Uint16 payload_size;
+	sf::Uint16 data_size;
+	packet >> is_coded >> payload_size >> data_size;
+
+	data.resize(data_size);
+	for (sf::Uint8& byte : data)
+	{
+		packet >> byte;
+	}
+
+	if (!packet)
+	{
+		return false;
+	}
+
+	payload.clear();
+	if (is_coded)
+	{
+		return RangeCoder::Decode(model, data.data(), data.size(), payload_size, payload);
+	}
+
+	payload.swap(data);
+	return true;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <unordered_map>
+#include <vector>
+#include <SFML/Config.hpp>
+#include <SFML/System/Vector2.hpp>
+
+#include "NetworkOptimisations.hpp"
+
+/**
+ * Vilandas Morrissey - D00218436
+ */
+
+class RangeModel;
+
+namespace sf
+{
+	class Packet;
+}
+
+/// <summary>
+/// Writes the player states of a snapshot as small integers: identifiers as gaps between sorted
+/// identifiers, positions quantized to an eighth of a pixel and stored as the change from the last
+/// position sent for that player. The server keeps one codec per client and the client mirrors it,
+/// which works because snapshots arrive in order over TCP.
+/// </summary>
+class SnapshotCodec
+{
+public:
+	struct Entry
+	{
+		opt::PlayerIdentifier m_identifier;
+		sf::Vector2f m_position;
+	};
+
+public:
+	void Encode(std::vector<Entry>& entries, std::vector<sf::Uint8>& out);
+	bool Decode(const std::vector<sf::Uint8>& data, std::vector<Entry>& entries);
+	void Forget(opt::PlayerIdentifier identifier);
+	void Reset();
+
+	static std::size_t WritePayload(const RangeModel* model, const std::vector<sf::Uint8>& payload, std::vector<sf::Uint8>& coded, sf::Packet& packet);
+	static bool ReadPayload(const RangeModel& model, sf::Packet& packet, std::vector<sf::Uint8>& data, std::vector<sf::Uint8>& payload);
+
+private:
+	std::unordered_map<opt::PlayerIdentifier, sf::Vector2i> m_baselines;
+};
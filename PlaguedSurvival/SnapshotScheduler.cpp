@@ -0,0 +1,227 @@
+#include "SnapshotScheduler.hpp"
+
+#include <algorithm>
+#include <limits>
+
+#include "Utility.hpp"
+#include "WorldInfo.hpp"
+
+/**
+ * Vilandas Morrissey - D00218436
+ */
+
+namespace
+{
+	const float SnapshotsPerSecond = 20.f;
+
+	//Bytes per second
+	const float InitialBandwidth = 16384.f;
+	const float MinBandwidth = 2048.f;
+	const float MaxBandwidth = 131072.f;
+	const float BandwidthIncrease = 512.f;
+	const float BandwidthDecrease = 0.8f;
+
+	//Snapshot layout: type, sequence and player count, then identifier and position per player
+	const std::size_t HeaderBytes = sizeof(opt::ServerPacket) + sizeof(sf::Uint32) + sizeof(opt::PlayerCount);
+	const std::size_t EntryBytes = sizeof(opt::PlayerIdentifier) + 2 * sizeof(float);
+	const std::size_t MaxBudget = 1400;
+
+	//Round trips this much above the fastest seen mean the link is queueing
+	const sf::Time QueueingDelay = sf::milliseconds(10);
+	const std::size_t MaxInFlight = 32;
+
+	//Players this far from the viewer are half as relevant
+	const float RelevanceDistance = 1000.f;
+	const float NeverSentPriority = 1000.f;
+}
+
+SnapshotScheduler::PlayerPriority::PlayerPriority()
+	: m_priority(NeverSentPriority)
+	, m_sent(false)
+{
+}
+
+SnapshotScheduler::SnapshotScheduler()
+	: m_next_sequence(0)
+	, m_smoothed_rtt(sf::Time::Zero)
+	, m_min_rtt(sf::Time::Zero)
+	, m_last_decrease(sf::Time::Zero)
+	, m_bandwidth(InitialBandwidth)
+	, m_budget_limited(false)
+{
+}
+
+/// <summary>
+/// Accumulates priority for every candidate and picks the highest until the byte budget is spent.
+/// The client's own players are skipped, it simulates those itself.
+/// </summary>
+/// <param name="dt">Time since the previous snapshot</param>
+/// <param name="now">Server time, used for prediction error and round trip times</param>
+SnapshotScheduler::Decision SnapshotScheduler::Schedule(const std::vector<Candidate>& candidates,
+	const std::vector<opt::PlayerIdentifier>& own_players, sf::Time dt, sf::Time now)
+{
+	Decision decision;
+	decision.m_sequence = m_next_sequence++;
+	decision.m_budget = GetByteBudget();
+	decision.m_bytes = HeaderBytes;
+	decision.m_candidates = 0;
+	decision.m_highest_skipped = 0.f;
+
+	m_viewers.clear();
+	m_order.clear();
+
+	for (std::size_t i = 0; i < candidates.size(); ++i)
+	{
+		if (std::find(own_players.begin(), own_players.end(), candidates[i].m_identifier) != own_players.end())
+		{
+			m_viewers.emplace_back(candidates[i].m_position);
+		}
+		else
+		{
+			m_order.emplace_back(i);
+		}
+	}
+
+	decision.m_candidates = m_order.size();
+
+	for (std::size_t i : m_order)
+	{
+		const Candidate& candidate = candidates[i];
+		PlayerPriority& priority = m_priorities[candidate.m_identifier];
+
+		//Relevance falls off with the distance to the closest of the client's players
+		float distance = m_viewers.empty() ? 0.f : std::numeric_limits<float>::max();
+		for (const sf::Vector2f& viewer : m_viewers)
+		{
+			distance = std::min(distance, Utility::Length(candidate.m_position - viewer));
+		}
+		const float relevance = 1.f / (1.f + distance / RelevanceDistance);
+
+		//How far the client's extrapolation of the last state it was sent has drifted, in tiles
+		float error = 0.f;
+		if (priority.m_sent)
+		{
+			const sf::Vector2f predicted = priority.m_sent_position + priority.m_sent_velocity * (now - priority.m_sent_time).asSeconds();
+			error = Utility::Length(candidate.m_position - predicted) / WorldInfo::TILE_SIZE;
+		}
+
+		priority.m_priority += dt.asSeconds() * relevance * (1.f + error);
+	}
+
+	std::sort(m_order.begin(), m_order.end(), [&](std::size_t a, std::size_t b)
+		{
+			return m_priorities[candidates[a].m_identifier].m_priority > m_priorities[candidates[b].m_identifier].m_priority;
+		});
+
+	for (std::size_t i : m_order)
+	{
+		const Candidate& candidate = candidates[i];
+		PlayerPriority& priority = m_priorities[candidate.m_identifier];
+
+		if (decision.m_bytes + EntryBytes > decision.m_budget)
+		{
+			decision.m_highest_skipped = std::max(decision.m_highest_skipped, priority.m_priority);
+			continue;
+		}
+
+		decision.m_bytes += EntryBytes;
+		decision.m_selected.emplace_back(i);
+
+		priority.m_priority = 0.f;
+		priority.m_sent = true;
+		priority.m_sent_position = candidate.m_position;
+		priority.m_sent_velocity = candidate.m_velocity;
+		priority.m_sent_time = now;
+	}
+
+	//The estimate only grows while it is what limits the snapshot
+	m_budget_limited = decision.m_selected.size() < decision.m_candidates;
+
+	SentSnapshot sent;
+	sent.m_sequence = decision.m_sequence;
+	sent.m_sent_time = now;
+	m_in_flight.emplace_back(sent);
+
+	//No acks for this long means the client is not keeping up
+	if (m_in_flight.size() > MaxInFlight)
+	{
+		m_in_flight.pop_front();
+		Decrease(now);
+	}
+
+	return decision;
+}
+
+/// <summary>
+/// Delay based AIMD: the bandwidth grows a little with each timely ack and is cut back
+/// at most once per round trip when acks come back slower than the fastest seen.
+/// </summary>
+void SnapshotScheduler::OnAck(sf::Uint32 sequence, sf::Time now)
+{
+	//Older snapshots without an ack are not waited on any longer
+	while (!m_in_flight.empty() && m_in_flight.front().m_sequence < sequence)
+	{
+		m_in_flight.pop_front();
+	}
+
+	//Already evicted by the in-flight cap, the newer snapshots are still waiting on their own acks
+	if (m_in_flight.empty() || m_in_flight.front().m_sequence != sequence)
+	{
+		return;
+	}
+
+	const sf::Time sample = now - m_in_flight.front().m_sent_time;
+	m_in_flight.pop_front();
+
+	if (m_smoothed_rtt == sf::Time::Zero)
+	{
+		m_smoothed_rtt = sample;
+		m_min_rtt = sample;
+	}
+	else
+	{
+		m_smoothed_rtt = (m_smoothed_rtt * 7.f + sample) / 8.f;
+		m_min_rtt = std::min(m_min_rtt, sample);
+	}
+
+	if (sample > m_min_rtt * 2.f + QueueingDelay)
+	{
+		Decrease(now);
+	}
+	else if (m_budget_limited)
+	{
+		m_bandwidth = std::min(MaxBandwidth, m_bandwidth + BandwidthIncrease);
+	}
+}
+
+void SnapshotScheduler::Forget(opt::PlayerIdentifier identifier)
+{
+	m_priorities.erase(identifier);
+}
+
+float SnapshotScheduler::GetBandwidth() const
+{
+	return m_bandwidth;
+}
+
+sf::Time SnapshotScheduler::GetRoundTripTime() const
+{
+	return m_smoothed_rtt;
+}
+
+std::size_t SnapshotScheduler::GetByteBudget() const
+{
+	const std::size_t budget = static_cast<std::size_t>(m_bandwidth / SnapshotsPerSecond);
+	return std::max(HeaderBytes + EntryBytes, std::min(budget, MaxBudget));
+}
+
+void SnapshotScheduler::Decrease(sf::Time now)
+{
+	if (now - m_last_decrease < m_smoothed_rtt)
+	{
+		return;
+	}
+
+	m_bandwidth = std::max(MinBandwidth, m_bandwidth * BandwidthDecrease);
+	m_last_decrease = now;
+}
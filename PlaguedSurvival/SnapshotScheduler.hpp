@@ -0,0 +1,83 @@
+#pragma once
+#include <deque>
+#include <unordered_map>
+#include <vector>
+#include <SFML/Config.hpp>
+#include <SFML/System/Time.hpp>
+#include <SFML/System/Vector2.hpp>
+
+#include "NetworkOptimisations.hpp"
+
+/**
+ * Vilandas Morrissey - D00218436
+ */
+
+/// <summary>
+/// Chooses which player states go into each snapshot for one client.
+/// The byte budget follows a bandwidth estimate driven by snapshot acks, and players
+/// compete for it through priority accumulators that grow with relevance and prediction error.
+/// </summary>
+class SnapshotScheduler
+{
+public:
+	struct Candidate
+	{
+		opt::PlayerIdentifier m_identifier;
+		sf::Vector2f m_position;
+		sf::Vector2f m_velocity;
+	};
+
+	struct Decision
+	{
+		sf::Uint32 m_sequence;
+		std::size_t m_budget;
+		std::size_t m_bytes;
+		std::size_t m_candidates;
+		float m_highest_skipped;
+		std::vector<std::size_t> m_selected;
+	};
+
+public:
+	SnapshotScheduler();
+
+	Decision Schedule(const std::vector<Candidate>& candidates, const std::vector<opt::PlayerIdentifier>& own_players,
+		sf::Time dt, sf::Time now);
+	void OnAck(sf::Uint32 sequence, sf::Time now);
+	void Forget(opt::PlayerIdentifier identifier);
+
+	float GetBandwidth() const;
+	sf::Time GetRoundTripTime() const;
+	std::size_t GetByteBudget() const;
+
+private:
+	struct SentSnapshot
+	{
+		sf::Uint32 m_sequence;
+		sf::Time m_sent_time;
+	};
+
+	struct PlayerPriority
+	{
+		PlayerPriority();
+		float m_priority;
+		bool m_sent;
+		sf::Vector2f m_sent_position;
+		sf::Vector2f m_sent_velocity;
+		sf::Time m_sent_time;
+	};
+
+private:
+	void Decrease(sf::Time now);
+
+private:
+	sf::Uint32 m_next_sequence;
+	std::deque<SentSnapshot> m_in_flight;
+	sf::Time m_smoothed_rtt;
+	sf::Time m_min_rtt;
+	sf::Time m_last_decrease;
+	float m_bandwidth;
+	bool m_budget_limited;
+	std::unordered_map<opt::PlayerIdentifier, PlayerPriority> m_priorities;
+	std::vector<std::size_t> m_order;
+	std::vector<sf::Vector2f> m_viewers;
+};
@@ -0,0 +1,155 @@
+#include "SpatialGrid.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "TileGrid.hpp"
+#include "WorldInfo.hpp"
+
+/**
+ * Vilandas Morrissey - D00218436
+ */
+
+SpatialGrid SpatialGrid::m_instance;
+
+SpatialGrid::SpatialGrid()
+	: m_layers()
+	, m_queries(0)
+	, m_candidates(0)
+{
+	for (LayerCells& layer : m_layers)
+	{
+		layer.m_cells.resize(TileGrid::CELL_COUNT);
+	}
+}
+
+void SpatialGrid::Clear()
+{
+	for (LayerCells& layer : m_layers)
+	{
+		for (std::vector<int>& cell : layer.m_cells)
+		{
+			cell.clear();
+		}
+		layer.m_slots.clear();
+	}
+}
+
+/// <param name="id">Small and non-negative, ids index arrays. An id can only be inserted once per layer.</param>
+void SpatialGrid::Insert(int id, const sf::FloatRect& bounds, Layers layer)
+{
+	LayerCells& cells = m_layers[static_cast<int>(layer)];
+	if (static_cast<std::size_t>(id) >= cells.m_slots.size())
+	{
+		cells.m_slots.resize(id + 1);
+	}
+
+	sf::IntRect range;
+	if (!GetCellRange(bounds, range))
+	{
+		return;
+	}
+
+	std::vector<Slot>& slots = cells.m_slots[id];
+	for (int row = range.top; row < range.top + range.height; ++row)
+	{
+		for (int column = range.left; column < range.left + range.width; ++column)
+		{
+			const int cell = TileGrid::GetCell(column, row);
+			slots.push_back({ cell, cells.m_cells[cell].size() });
+			cells.m_cells[cell].emplace_back(id);
+		}
+	}
+}
+
+/// <summary>
+/// Swaps the last id of each cell into the removed id's place and points that entry at its new index
+/// </summary>
+void SpatialGrid::Remove(int id, Layers layer)
+{
+	LayerCells& cells = m_layers[static_cast<int>(layer)];
+	if (static_cast<std::size_t>(id) >= cells.m_slots.size())
+	{
+		return;
+	}
+
+	for (const Slot& slot : cells.m_slots[id])
+	{
+		std::vector<int>& cell = cells.m_cells[slot.m_cell];
+		const int moved = cell.back();
+		cell[slot.m_index] = moved;
+		cell.pop_back();
+
+		if (moved != id)
+		{
+			for (Slot& moved_slot : cells.m_slots[moved])
+			{
+				if (moved_slot.m_cell == slot.m_cell)
+				{
+					moved_slot.m_index = slot.m_index;
+					break;
+				}
+			}
+		}
+	}
+
+	cells.m_slots[id].clear();
+}
+
+/// <summary>
+/// Collects the ids overlapping the cells under the bounds, each id once and in increasing order.
+/// An entry spanning several cells is found in each of them, the duplicates are sorted out afterwards
+/// rather than marked in shared state, so queries do not write to the grid.
+/// </summary>
+void SpatialGrid::Query(const sf::FloatRect& bounds, Layers layer, std::vector<int>& candidates) const
+{
+	candidates.clear();
+	m_queries.fetch_add(1, std::memory_order_relaxed);
+
+	sf::IntRect range;
+	if (!GetCellRange(bounds, range))
+	{
+		return;
+	}
+
+	const LayerCells& cells = m_layers[static_cast<int>(layer)];
+
+	for (int row = range.top; row < range.top + range.height; ++row)
+	{
+		for (int column = range.left; column < range.left + range.width; ++column)
+		{
+			const std::vector<int>& cell = cells.m_cells[TileGrid::GetCell(column, row)];
+			candidates.insert(candidates.end(), cell.begin(), cell.end());
+		}
+	}
+
+	std::sort(candidates.begin(), candidates.end());
+	candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+	m_candidates.fetch_add(candidates.size(), std::memory_order_relaxed);
+}
+
+/// <summary>
+/// Number of queries and the candidates they returned since the last call
+/// </summary>
+void SpatialGrid::TakeQueryStatistics(std::size_t& queries, std::size_t& candidates)
+{
+	queries = m_queries.exchange(0, std::memory_order_relaxed);
+	candidates = m_candidates.exchange(0, std::memory_order_relaxed);
+}
+
+/// <summary>
+/// The cells the bounds overlap, clamped to the world. The right and bottom edges are exclusive
+/// so a tile sized box lined up with the grid covers exactly one cell.
+/// </summary>
+/// <returns>False if the bounds are entirely outside the world</returns>
+bool SpatialGrid::GetCellRange(const sf::FloatRect& bounds, sf::IntRect& range) const
+{
+	const int left = std::max(0, static_cast<int>(std::floor(bounds.left / WorldInfo::TILE_SIZE)));
+	const int top = std::max(0, static_cast<int>(std::floor(bounds.top / WorldInfo::TILE_SIZE)));
+	const int right = std::min(TileGrid::COLUMNS, static_cast<int>(std::ceil((bounds.left + bounds.width) / WorldInfo::TILE_SIZE)));
+	const int bottom = std::min(TileGrid::ROWS, static_cast<int>(std::ceil((bounds.top + bounds.height) / WorldInfo::TILE_SIZE)));
+
+	range = sf::IntRect(left, top, right - left, bottom - top);
+	return range.width > 0 && range.height > 0;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <vector>
+#include <SFML/Graphics/Rect.hpp>
+
+#include "Layers.hpp"
+
+/**
+ * Vilandas Morrissey - D00218436
+ */
+
+/// <summary>
+/// Uniform grid over the world, one cell per tile, used to find what a bounding box might collide with.
+/// Every layer has its own dense array of cells, each holding the ids of the entries that overlap it.
+/// Entries remember where they are stored, so inserting and removing never searches a cell.
+/// Queries only visit the cells under the box they are given, and can run on several threads at once
+/// as long as nothing is being inserted or removed.
+/// </summary>
+class SpatialGrid
+{
+public:
+	SpatialGrid(const SpatialGrid&) = delete;
+
+	static SpatialGrid& Instance()
+	{
+		return m_instance;
+	}
+
+	void Clear();
+	void Insert(int id, const sf::FloatRect& bounds, Layers layer);
+	void Remove(int id, Layers layer);
+
+	void Query(const sf::FloatRect& bounds, Layers layer, std::vector<int>& candidates) const;
+	void TakeQueryStatistics(std::size_t& queries, std::size_t& candidates);
+
+private:
+	//Where one of an entry's ids is stored, an entry has one per cell it overlaps
+	struct Slot
+	{
+		int m_cell;
+		std::size_t m_index;
+	};
+
+	struct LayerCells
+	{
+		std::vector<std::vector<int>> m_cells;
+		std::vector<std::vector<Slot>> m_slots;
+	};
+
+private:
+	SpatialGrid();
+	bool GetCellRange(const sf::FloatRect& bounds, sf::IntRect& range) const;
+
+private:
+	static SpatialGrid m_instance;
+
+	std::array<LayerCells, static_cast<int>(Layers::kLayerCount)> m_layers;
+	mutable std::atomic<std::size_t> m_queries;
+	mutable std::atomic<std::size_t> m_candidates;
+};
@@ -0,0 +1,459 @@
+#include "SpectatorRelay.hpp"
+
+#include <iostream>
+
+#include "PacketFraming.hpp"
+
+/**
+ * Vilandas Morrissey - D00218436
+ */
+
+namespace
+{
+	const std::size_t MaxSpectators = 256;
+
+	//Same as the clients' timeout with the server
+	const sf::Time ServerTimeout = sf::seconds(2.f);
+	const sf::Time SpectatorTimeout = sf::seconds(2.f);
+
+	//The server drops peers that are quiet for a second
+	const sf::Time StillHereRate = sf::seconds(0.5f);
+	//Spectators waiting for their InitialState are kept from timing out at the snapshot rate
+	const sf::Time KeepAliveRate = sf::seconds(1.f / 20.f);
+
+	const std::size_t ReceiveChunk = 4096;
+	const std::size_t MaxSendBuffer = 262144;
+}
+
+SpectatorRelay::Spectator::Spectator()
+	: m_joined(false)
+	, m_watching(false)
+	, m_disconnected(false)
+{
+	m_socket.setBlocking(false);
+}
+
+SpectatorRelay::SpectatorRelay(const sf::IpAddress& server_address, unsigned short server_port, unsigned short listen_port, sf::Time delay)
+	: m_delay(delay)
+	, m_listen_port(listen_port)
+	, m_server(new ClientNetwork(server_address, server_port))
+	, m_joined_server(false)
+	, m_world_state_requested(false)
+	, m_pending_spectator(new Spectator())
+{
+	m_listener.setBlocking(false);
+}
+
+/// <summary>
+/// Relays until the connection to the server is lost.
+/// </summary>
+void SpectatorRelay::Run()
+{
+	if (m_listener.listen(m_listen_port) != sf::Socket::Done)
+	{
+		std::cout << "Relay could not listen on port " << m_listen_port << std::endl;
+		return;
+	}
+
+	m_selector.add(m_listener);
+	std::cout << "Relay listening on port " << m_listen_port << " with a delay of " << m_delay.asSeconds() << "s" << std::endl;
+
+	while (HandleServer())
+	{
+		HandleIncomingConnections();
+		HandleSpectatorPackets();
+		ReleasePackets();
+		SendKeepAlive();
+		FlushSpectators();
+		RemoveDisconnected();
+
+		//Wake on spectator activity, or every millisecond for the server and the delay queue
+		m_selector.wait(sf::milliseconds(1));
+	}
+
+	std::cout << "Lost connection to the server, relay stopped" << std::endl;
+}
+
+sf::Time SpectatorRelay::Now() const
+{
+	return m_clock.getElapsedTime();
+}
+
+bool SpectatorRelay::HandleServer()
+{
+	switch (m_server->GetStatus())
+	{
+	case ClientNetwork::Status::kConnecting:
+		return true;
+
+	case ClientNetwork::Status::kFailed:
+	case ClientNetwork::Status::kDisconnected:
+		return false;
+
+	case ClientNetwork::Status::kConnected:
+		break;
+	}
+
+	if (!m_joined_server)
+	{
+		//The server answers the join with an InitialState, the same as a later request
+		sf::Packet packet;
+		packet << static_cast<opt::ClientPacket>(Client::PacketType::Join) << opt::SessionToken(0) << true;
+		SendToServer(packet);
+
+		m_joined_server = true;
+		m_world_state_requested = true;
+	}
+
+	ClientNetwork::ReceivedPacket received;
+	while (m_server->PollPacket(received))
+	{
+		if (!HandleServerPacket(received))
+		{
+			return false;
+		}
+	}
+
+	if (m_server->GetTimeSinceLastPacket() > ServerTimeout)
+	{
+		return false;
+	}
+
+	if (Now() - m_last_still_here > StillHereRate)
+	{
+		sf::Packet packet;
+		packet << static_cast<opt::ClientPacket>(Client::PacketType::StillHereUpdate);
+		SendToServer(packet);
+		m_last_still_here = Now();
+	}
+
+	return true;
+}
+
+/// <summary>
+/// Snapshots are decoded and acked as soon as they arrive, so the server's baselines and bandwidth
+/// estimate follow the relay, not the delay. Everything else is queued untouched.
+/// </summary>
+bool SpectatorRelay::HandleServerPacket(ClientNetwork::ReceivedPacket& received)
+{
+	DelayedPacket delayed;
+	delayed.m_release_time = Now() + m_delay;
+	delayed.m_type = static_cast<Server::PacketType>(received.m_type);
+	delayed.m_packet = received.m_packet;
+	delayed.m_sequence = 0;
+	delayed.m_is_snapshot = false;
+
+	switch (delayed.m_type)
+	{
+	case Server::PacketType::SnapshotModel:
+	{
+		//Not relayed, spectators are sent the model when they start watching
+		if (!m_model.Read(received.m_packet))
+		{
+			m_model = RangeModel();
+		}
+		m_codec.Reset();
+	}
+	return true;
+
+	case Server::PacketType::InitialState:
+		m_world_state_requested = false;
+		break;
+
+	case Server::PacketType::PlayerDisconnect:
+	{
+		opt::PlayerIdentifier player_identifier;
+		if (received.m_packet >> player_identifier)
+		{
+			m_codec.Forget(player_identifier);
+		}
+	}
+	break;
+
+	case Server::PacketType::UpdateClientState:
+	{
+		//Lobby keepalives are empty and are relayed as they are
+		if (!(received.m_packet >> delayed.m_sequence))
+		{
+			break;
+		}
+
+		sf::Packet ack_packet;
+		ack_packet << static_cast<opt::ClientPacket>(Client::PacketType::SnapshotAck) << delayed.m_sequence;
+		SendToServer(ack_packet);
+
+		if (!SnapshotCodec::ReadPayload(m_model, received.m_packet, m_data, m_payload) ||
+			!m_codec.Decode(m_payload, delayed.m_entries))
+		{
+			return false;
+		}
+
+		delayed.m_is_snapshot = true;
+	}
+	break;
+
+	default:
+		break;
+	}
+
+	m_delayed.emplace_back(std::move(delayed));
+	return true;
+}
+
+void SpectatorRelay::SendToServer(const sf::Packet& packet)
+{
+	m_server->Send(packet);
+}
+
+void SpectatorRelay::HandleIncomingConnections()
+{
+	if (m_spectators.size() >= MaxSpectators)
+	{
+		return;
+	}
+
+	if (m_listener.accept(m_pending_spectator->m_socket) == sf::Socket::Done)
+	{
+		m_pending_spectator->m_last_packet_time = Now();
+		m_selector.add(m_pending_spectator->m_socket);
+
+		m_spectators.emplace_back(std::move(m_pending_spectator));
+		m_pending_spectator.reset(new Spectator());
+	}
+}
+
+void SpectatorRelay::HandleSpectatorPackets()
+{
+	sf::Packet packet;
+	for (SpectatorPtr& spectator : m_spectators)
+	{
+		std::vector<char>& buffer = spectator->m_receive_buffer;
+
+		if (m_selector.isReady(spectator->m_socket))
+		{
+			const std::size_t old_size = buffer.size();
+			buffer.resize(old_size + ReceiveChunk);
+
+			std::size_t received = 0;
+			const sf::Socket::Status status = spectator->m_socket.receive(buffer.data() + old_size, ReceiveChunk, received);
+			buffer.resize(old_size + received);
+
+			if (status == sf::Socket::Disconnected || status == sf::Socket::Error)
+			{
+				spectator->m_disconnected = true;
+			}
+		}
+
+		std::size_t offset = 0;
+		PacketFraming::Result result;
+		while ((result = PacketFraming::Extract(buffer, offset, packet)) == PacketFraming::Result::kPacket)
+		{
+			spectator->m_last_packet_time = Now();
+			HandleSpectatorPacket(*spectator, packet);
+		}
+		buffer.erase(buffer.begin(), buffer.begin() + offset);
+
+		if (result == PacketFraming::Result::kMalformed || Now() - spectator->m_last_packet_time > SpectatorTimeout)
+		{
+			spectator->m_disconnected = true;
+		}
+	}
+}
+
+//Spectators are read only, anything other than joining, leaving and clock syncs is ignored
+
+void SpectatorRelay::HandleSpectatorPacket(Spectator& spectator, sf::Packet& packet)
+{
+	opt::ClientPacket packet_type;
+	if (!(packet >> packet_type))
+	{
+		return;
+	}
+
+	switch (static_cast<Client::PacketType>(packet_type))
+	{
+	case Client::PacketType::Join:
+	{
+		if (spectator.m_joined)
+		{
+			break;
+		}
+
+		spectator.m_joined = true;
+
+		//One request serves every spectator that joins before its reply comes back through the delay
+		if (!m_world_state_requested)
+		{
+			sf::Packet request_packet;
+			request_packet << static_cast<opt::ClientPacket>(Client::PacketType::RequestWorldState);
+			SendToServer(request_packet);
+			m_world_state_requested = true;
+		}
+	}
+	break;
+
+	case Client::PacketType::Quit:
+		spectator.m_disconnected = true;
+		break;
+
+	//Answered with the relay's estimate of the server clock, so spectators can trace input latency too
+	case Client::PacketType::ClockSync:
+	{
+		sf::Int64 client_time;
+		if (packet >> client_time && m_server->IsClockSynced())
+		{
+			sf::Packet reply;
+			reply << static_cast<opt::ServerPacket>(Server::PacketType::ClockSync) << client_time << m_server->GetServerTime().asMicroseconds();
+			PacketFraming::Append(reply, spectator.m_send_buffer);
+		}
+	}
+	break;
+
+	default:
+		break;
+	}
+}
+
+void SpectatorRelay::ReleasePackets()
+{
+	while (!m_delayed.empty() && m_delayed.front().m_release_time <= Now())
+	{
+		Release(m_delayed.front());
+		m_delayed.pop_front();
+	}
+}
+
+void SpectatorRelay::Release(DelayedPacket& delayed)
+{
+	switch (delayed.m_type)
+	{
+	case Server::PacketType::InitialState:
+	{
+		//Spectators waiting for a world state start watching from here
+		sf::Packet model_packet;
+		model_packet << static_cast<opt::ServerPacket>(Server::PacketType::SnapshotModel);
+		m_model.Write(model_packet);
+
+		for (SpectatorPtr& spectator : m_spectators)
+		{
+			if (spectator->m_joined && !spectator->m_watching)
+			{
+				PacketFraming::Append(model_packet, spectator->m_send_buffer);
+				PacketFraming::Append(delayed.m_packet, spectator->m_send_buffer);
+				spectator->m_codec.Reset();
+				spectator->m_watching = true;
+			}
+		}
+	}
+	return;
+
+	case Server::PacketType::UpdateClientState:
+		if (delayed.m_is_snapshot)
+		{
+			for (SpectatorPtr& spectator : m_spectators)
+			{
+				if (spectator->m_watching)
+				{
+					SendSnapshot(*spectator, delayed);
+				}
+			}
+			return;
+		}
+		break;
+
+	case Server::PacketType::PlayerDisconnect:
+	{
+		opt::PlayerIdentifier player_identifier;
+		if (delayed.m_packet >> player_identifier)
+		{
+			for (SpectatorPtr& spectator : m_spectators)
+			{
+				spectator->m_codec.Forget(player_identifier);
+			}
+		}
+	}
+	break;
+
+	default:
+		break;
+	}
+
+	for (SpectatorPtr& spectator : m_spectators)
+	{
+		if (spectator->m_watching)
+		{
+			PacketFraming::Append(delayed.m_packet, spectator->m_send_buffer);
+		}
+	}
+}
+
+void SpectatorRelay::SendSnapshot(Spectator& spectator, const DelayedPacket& delayed)
+{
+	m_entries = delayed.m_entries;
+	m_payload.clear();
+	spectator.m_codec.Encode(m_entries, m_payload);
+
+	sf::Packet packet;
+	packet << static_cast<opt::ServerPacket>(Server::PacketType::UpdateClientState) << delayed.m_sequence;
+	SnapshotCodec::WritePayload(&m_model, m_payload, m_data, packet);
+
+	PacketFraming::Append(packet, spectator.m_send_buffer);
+}
+
+void SpectatorRelay::SendKeepAlive()
+{
+	if (Now() - m_last_keep_alive < KeepAliveRate)
+	{
+		return;
+	}
+
+	sf::Packet packet;
+	packet << static_cast<opt::ServerPacket>(Server::PacketType::UpdateClientState);
+
+	for (SpectatorPtr& spectator : m_spectators)
+	{
+		if (spectator->m_joined && !spectator->m_watching)
+		{
+			PacketFraming::Append(packet, spectator->m_send_buffer);
+		}
+	}
+
+	m_last_keep_alive = Now();
+}
+
+void SpectatorRelay::FlushSpectators()
+{
+	for (SpectatorPtr& spectator : m_spectators)
+	{
+		if (spectator->m_send_buffer.empty())
+		{
+			continue;
+		}
+
+		std::size_t sent = 0;
+		const sf::Socket::Status status = spectator->m_socket.send(spectator->m_send_buffer.data(), spectator->m_send_buffer.size(), sent);
+		spectator->m_send_buffer.erase(spectator->m_send_buffer.begin(), spectator->m_send_buffer.begin() + sent);
+
+		//A spectator that cannot keep up is dropped rather than holding everyone else's memory
+		if (status == sf::Socket::Disconnected || status == sf::Socket::Error || spectator->m_send_buffer.size() > MaxSendBuffer)
+		{
+			spectator->m_disconnected = true;
+		}
+	}
+}
+
+void SpectatorRelay::RemoveDisconnected()
+{
+	for (auto itr = m_spectators.begin(); itr != m_spectators.end();)
+	{
+		if ((*itr)->m_disconnected)
+		{
+			m_selector.remove((*itr)->m_socket);
+			itr = m_spectators.erase(itr);
+		}
+		else
+		{
+			++itr;
+		}
+	}
+}
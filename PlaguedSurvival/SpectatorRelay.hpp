@@ -0,0 +1,101 @@
+#pragma once
+#include <deque>
+#include <memory>
+#include <vector>
+#include <SFML/Network/IpAddress.hpp>
+#include <SFML/Network/Packet.hpp>
+#include <SFML/Network/SocketSelector.hpp>
+#include <SFML/Network/TcpListener.hpp>
+#include <SFML/Network/TcpSocket.hpp>
+#include <SFML/System/Clock.hpp>
+
+#include "ClientNetwork.hpp"
+#include "NetworkOptimisations.hpp"
+#include "NetworkProtocol.hpp"
+#include "RangeCoder.hpp"
+#include "SnapshotCodec.hpp"
+
+/**
+ * Vilandas Morrissey - D00218436
+ */
+
+/// <summary>
+/// Joins a GameServer as a single read only spectator and re-broadcasts everything it is sent to
+/// any number of spectator clients, optionally held back by a delay. Snapshots are decoded once and
+/// coded again for each spectator, since every client keeps its own snapshot baselines.
+/// A spectator that joins mid-stream waits for a fresh InitialState, requested from the server,
+/// to come through the delay, and then sees everything after it.
+/// </summary>
+class SpectatorRelay
+{
+public:
+	SpectatorRelay(const sf::IpAddress& server_address, unsigned short server_port, unsigned short listen_port, sf::Time delay);
+	void Run();
+
+private:
+	struct Spectator
+	{
+		Spectator();
+		sf::TcpSocket m_socket;
+		std::vector<char> m_send_buffer;
+		std::vector<char> m_receive_buffer;
+		sf::Time m_last_packet_time;
+		SnapshotCodec m_codec;
+		bool m_joined;
+		bool m_watching;
+		bool m_disconnected;
+	};
+
+	//A packet from the server waiting out the delay
+	struct DelayedPacket
+	{
+		sf::Time m_release_time;
+		Server::PacketType m_type;
+		sf::Packet m_packet;
+		sf::Uint32 m_sequence;
+		bool m_is_snapshot;
+		std::vector<SnapshotCodec::Entry> m_entries;
+	};
+
+	typedef std::unique_ptr<Spectator> SpectatorPtr;
+
+private:
+	sf::Time Now() const;
+
+	bool HandleServer();
+	bool HandleServerPacket(ClientNetwork::ReceivedPacket& received);
+	void SendToServer(const sf::Packet& packet);
+
+	void HandleIncomingConnections();
+	void HandleSpectatorPackets();
+	void HandleSpectatorPacket(Spectator& spectator, sf::Packet& packet);
+	void RemoveDisconnected();
+	void ReleasePackets();
+	void Release(DelayedPacket& delayed);
+	void SendSnapshot(Spectator& spectator, const DelayedPacket& delayed);
+	void SendKeepAlive();
+	void FlushSpectators();
+
+private:
+	sf::Clock m_clock;
+	sf::Time m_delay;
+	unsigned short m_listen_port;
+	std::unique_ptr<ClientNetwork> m_server;
+	bool m_joined_server;
+	bool m_world_state_requested;
+	sf::Time m_last_still_here;
+	sf::Time m_last_keep_alive;
+
+	RangeModel m_model;
+	SnapshotCodec m_codec;
+	std::vector<sf::Uint8> m_data;
+	std::vector<sf::Uint8> m_payload;
+	std::vector<SnapshotCodec::Entry> m_entries;
+
+	std::deque<DelayedPacket> m_delayed;
+
+	sf::TcpListener m_listener;
+	sf::SocketSelector m_selector;
+	std::vector<SpectatorPtr> m_spectators;
+	SpectatorPtr m_pending_spectator;
+};
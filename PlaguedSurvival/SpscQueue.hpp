@@ -0,0 +1,44 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+/**
+ * Vilandas Morrissey - D00218436
+ */
+
+/// <summary>
+/// Bounded lock-free queue for exactly one producer thread and one consumer thread.
+/// Slots are allocated once up front and Push and Pop copy-assign into them, so they never
+/// allocate for trivially copyable T. Types that own memory, such as sf::Packet, may still
+/// allocate until a slot's buffer has grown large enough to be reused.
+/// </summary>
+template <typename T>
+class SpscQueue
+{
+public:
+	explicit SpscQueue(std::size_t capacity);
+
+	SpscQueue(const SpscQueue&) = delete;
+	SpscQueue& operator=(const SpscQueue&) = delete;
+
+	bool Push(const T& item);
+	bool Pop(T& out);
+
+	bool IsEmpty() const;
+	bool IsFull() const;
+	std::size_t Size() const;
+	std::size_t Capacity() const;
+
+private:
+	static std::size_t RoundUpToPowerOfTwo(std::size_t value);
+
+private:
+	std::vector<T> m_slots;
+	std::size_t m_mask;
+
+	//Kept on separate cache lines so producer and consumer do not false share
+	alignas(64) std::atomic<std::size_t> m_head;
+	alignas(64) std::atomic<std::size_t> m_tail;
+};
+#include "SpscQueue.inl"
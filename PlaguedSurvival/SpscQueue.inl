@@ -0,0 +1,77 @@
+template <typename T>
+SpscQueue<T>::SpscQueue(std::size_t capacity)
+	: m_slots(RoundUpToPowerOfTwo(capacity))
+	, m_mask(m_slots.size() - 1)
+	, m_head(0)
+	, m_tail(0)
+{
+}
+
+/// <summary>
+/// Producer side. Returns false without blocking if the queue is full.
+/// </summary>
+template <typename T>
+bool SpscQueue<T>::Push(const T& item)
+{
+	const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+	if (tail - m_head.load(std::memory_order_acquire) == m_slots.size())
+	{
+		return false;
+	}
+
+	m_slots[tail & m_mask] = item;
+	m_tail.store(tail + 1, std::memory_order_release);
+	return true;
+}
+
+/// <summary>
+/// Consumer side. Returns false without blocking if the queue is empty.
+/// </summary>
+template <typename T>
+bool SpscQueue<T>::Pop(T& out)
+{
+	const std::size_t head = m_head.load(std::memory_order_relaxed);
+	if (head == m_tail.load(std::memory_order_acquire))
+	{
+		return false;
+	}
+
+	out = m_slots[head & m_mask];
+	m_head.store(head + 1, std::memory_order_release);
+	return true;
+}
+
+template <typename T>
+bool SpscQueue<T>::IsEmpty() const
+{
+	return Size() == 0;
+}
+
+template <typename T>
+bool SpscQueue<T>::IsFull() const
+{
+	return Size() == m_slots.size();
+}
+
+template <typename T>
+std::size_t SpscQueue<T>::Size() const
+{
+	return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+}
+
+template <typename T>
+std::size_t SpscQueue<T>::Capacity() const
+{
+	return m_slots.size();
+}
+
+template <typename T>
+std::size_t SpscQueue<T>::RoundUpToPowerOfTwo(std::size_t value)
+{
+	std::size_t power = 1;
+	while (power < value)
+	{
+		power <<= 1;
+	}
+	return power;
+}
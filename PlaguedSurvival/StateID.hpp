@@ -12,4 +12,5 @@ enum class StateID
 	kMissionSuccess,
 	kHostGame,
 	kJoinGame,
+	kSpectateGame,
 };
\ No newline at end of file
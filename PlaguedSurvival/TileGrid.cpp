@@ -0,0 +1,217 @@
+#include "TileGrid.hpp"
+
+#include <SFML/Network/Packet.hpp>
+
+/**
+ * Vilandas Morrissey - D00218436
+ */
+
+namespace
+{
+	//The level is placed one column in from the left and sits on the bottom of the world, two rows up
+	const int LevelColumns = 50;
+	const int LevelRows = 15;
+	const int LevelFirstColumn = 1;
+	const int LevelFirstRow = TileGrid::ROWS - 17;
+
+	const sf::Uint8 Level[LevelRows][LevelColumns] =
+	{
+		{0,0,0,0,0,0,2,0,0,0,0,0,0,0,1,3,0,0,1,2,3,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0},
+		{0,0,0,0,0,0,5,0,0,0,0,0,0,0,0,0,0,0,4,5,6,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,0,0,0,0,0,0,0,0},
+		{0,0,0,0,0,0,5,0,0,0,0,0,0,0,0,0,0,1,5,5,5,2,3,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,5,0,0,0,0,0,0,0,0},
+		{0,0,2,2,2,2,2,2,2,2,2,2,2,3,0,0,1,5,5,5,5,5,6,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,5,0,0,0,0,0,0,0,0},
+		{1,2,5,5,5,5,5,5,5,5,5,5,5,6,0,0,4,5,5,5,5,5,5,3,0,0,0,0,0,0,0,0,0,0,0,0,1,2,2,2,2,5,2,2,2,2,2,2,2,3},
+		{4,5,5,5,5,5,5,5,5,5,5,5,5,6,0,0,7,8,8,8,8,8,5,5,3,0,0,0,0,0,0,0,0,0,0,1,5,5,5,5,5,5,5,5,5,5,5,5,5,6},
+		{7,8,8,8,8,8,8,8,8,8,8,8,8,9,0,0,0,0,0,0,0,0,4,5,6,0,0,0,0,0,0,0,0,1,2,5,8,8,8,8,8,8,8,8,8,8,8,8,8,6},
+		{0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,7,8,5,3,0,0,0,0,0,0,0,4,5,9,0,0,0,0,0,0,0,0,0,0,0,0,0,6},
+		{0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,8,8,2,2,2,2,2,2,2,8,8,0,0,0,0,0,0,0,0,0,0,0,0,8,8,9},
+		{0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0},
+		{0,0,0,0,0,2,0,0,0,0,2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0},
+		{0,0,0,0,0,5,3,0,0,0,5,3,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0},
+		{0,0,2,0,0,4,0,0,0,0,4,6,0,0,0,0,0,0,0,0,0,5,5,0,0,0,0,0,0,0,2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0},
+		{0,0,8,0,0,4,0,0,0,0,4,6,0,0,0,0,0,0,0,0,0,0,8,0,0,0,0,0,0,5,6,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0},
+		{0,0,0,0,0,4,0,0,0,0,4,6,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,8,8,9,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0},
+	};
+}
+
+TileGrid::TileGrid()
+	: m_tile_ids()
+	, m_hit_points()
+	, m_top_cells()
+{
+	LoadLevel();
+}
+
+int TileGrid::GetCell(int column, int row)
+{
+	return row * COLUMNS + column;
+}
+
+int TileGrid::GetColumn(int cell)
+{
+	return cell % COLUMNS;
+}
+
+int TileGrid::GetRow(int cell)
+{
+	return cell / COLUMNS;
+}
+
+sf::Uint8 TileGrid::GetTileId(int cell) const
+{
+	return m_tile_ids[cell];
+}
+
+sf::Uint8 TileGrid::GetHitPoints(int cell) const
+{
+	return m_hit_points[cell];
+}
+
+/// <summary>
+/// The top cell of a column is the highest tile that is still standing. Only top tiles can be damaged by dangers.
+/// </summary>
+int TileGrid::GetTopCell(int column) const
+{
+	return m_top_cells[column];
+}
+
+void TileGrid::GetTopCells(std::vector<int>& out) const
+{
+	out.clear();
+	for (int cell : m_top_cells)
+	{
+		if (cell != NO_CELL)
+		{
+			out.emplace_back(cell);
+		}
+	}
+}
+
+bool TileGrid::Damage(int cell)
+{
+	if (cell < 0 || cell >= CELL_COUNT || m_hit_points[cell] == 0)
+	{
+		return false;
+	}
+
+	m_hit_points[cell]--;
+
+	if (m_hit_points[cell] == 0)
+	{
+		UpdateTopCell(GetColumn(cell));
+	}
+
+	return true;
+}
+
+/// <summary>
+/// Writes the damage of every cell relative to the starting level as (run length, damage) pairs.
+/// An undamaged world is a single run, and destroyed columns compress to a few runs each.
+/// </summary>
+void TileGrid::WriteSnapshot(sf::Packet& packet) const
+{
+	std::vector<std::pair<sf::Uint16, sf::Uint8>> runs;
+
+	for (int cell = 0; cell < CELL_COUNT; ++cell)
+	{
+		const sf::Uint8 damage = m_tile_ids[cell] == 0 ? 0 : static_cast<sf::Uint8>(TILE_HIT_POINTS - m_hit_points[cell]);
+
+		if (!runs.empty() && runs.back().second == damage)
+		{
+			runs.back().first++;
+		}
+		else
+		{
+			runs.emplace_back(1, damage);
+		}
+	}
+
+	packet << static_cast<sf::Uint16>(runs.size());
+	for (const auto& run : runs)
+	{
+		packet << run.first << run.second;
+	}
+}
+
+/// <summary>
+/// Applies a snapshot written by WriteSnapshot to a freshly loaded level.
+/// Nothing is changed if the snapshot is malformed.
+/// </summary>
+bool TileGrid::ReadSnapshot(sf::Packet& packet)
+{
+	sf::Uint16 run_count;
+	if (!(packet >> run_count))
+	{
+		return false;
+	}
+
+	std::array<sf::Uint8, CELL_COUNT> hit_points = m_hit_points;
+	int cell = 0;
+
+	for (sf::Uint16 i = 0; i < run_count; ++i)
+	{
+		sf::Uint16 length;
+		sf::Uint8 damage;
+		if (!(packet >> length >> damage) || cell + length > CELL_COUNT || damage > TILE_HIT_POINTS)
+		{
+			return false;
+		}
+
+		for (const int end = cell + length; cell < end; ++cell)
+		{
+			if (m_tile_ids[cell] != 0)
+			{
+				hit_points[cell] = static_cast<sf::Uint8>(TILE_HIT_POINTS - damage);
+			}
+		}
+	}
+
+	if (cell != CELL_COUNT)
+	{
+		return false;
+	}
+
+	m_hit_points = hit_points;
+	for (int column = 0; column < COLUMNS; ++column)
+	{
+		UpdateTopCell(column);
+	}
+
+	return true;
+}
+
+void TileGrid::LoadLevel()
+{
+	m_tile_ids.fill(0);
+	m_hit_points.fill(0);
+
+	for (int i = 0; i < LevelRows; ++i)
+	{
+		for (int j = 0; j < LevelColumns; ++j)
+		{
+			const int cell = GetCell(LevelFirstColumn + j, LevelFirstRow + i);
+			m_tile_ids[cell] = Level[i][j];
+			m_hit_points[cell] = Level[i][j] == 0 ? 0 : TILE_HIT_POINTS;
+		}
+	}
+
+	for (int column = 0; column < COLUMNS; ++column)
+	{
+		UpdateTopCell(column);
+	}
+}
+
+void TileGrid::UpdateTopCell(int column)
+{
+	m_top_cells[column] = NO_CELL;
+
+	for (int row = 0; row < ROWS; ++row)
+	{
+		const int cell = GetCell(column, row);
+		if (m_hit_points[cell] > 0)
+		{
+			m_top_cells[column] = cell;
+			return;
+		}
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <array>
+#include <vector>
+#include <SFML/Config.hpp>
+
+#include "WorldInfo.hpp"
+
+/**
+ * Vilandas Morrissey - D00218436
+ */
+
+namespace sf
+{
+	class Packet;
+}
+
+/// <summary>
+/// Plain tile data for the whole world grid, shared by the server and the clients.
+/// Cells are stored row by row. The server owns the hit points and clients mirror them.
+/// </summary>
+class TileGrid
+{
+public:
+	static constexpr int COLUMNS = WorldInfo::X_TILE_COUNT;
+	static constexpr int ROWS = WorldInfo::Y_TILE_COUNt;
+	static constexpr int CELL_COUNT = COLUMNS * ROWS;
+	static constexpr int NO_CELL = -1;
+	static constexpr sf::Uint8 TILE_HIT_POINTS = 2;
+
+public:
+	TileGrid();
+
+	static int GetCell(int column, int row);
+	static int GetColumn(int cell);
+	static int GetRow(int cell);
+
+	sf::Uint8 GetTileId(int cell) const;
+	sf::Uint8 GetHitPoints(int cell) const;
+	int GetTopCell(int column) const;
+	void GetTopCells(std::vector<int>& out) const;
+
+	bool Damage(int cell);
+
+	void WriteSnapshot(sf::Packet& packet) const;
+	bool ReadSnapshot(sf::Packet& packet);
+
+private:
+	void LoadLevel();
+	void UpdateTopCell(int column);
+
+private:
+	std::array<sf::Uint8, CELL_COUNT> m_tile_ids;
+	std::array<sf::Uint8, CELL_COUNT> m_hit_points;
+	std::array<int, COLUMNS> m_top_cells;
+};
@@ -0,0 +1,281 @@
+#include "TileMap.hpp"
+
+#include <algorithm>
+#include <SFML/Graphics/RectangleShape.hpp>
+#include <SFML/Graphics/RenderTarget.hpp>
+#include <SFML/Graphics/Texture.hpp>
+
+#include "DangerTrigger.hpp"
+#include "ResourceHolder.hpp"
+#include "SpatialGrid.hpp"
+
+/**
+ * Vilandas Morrissey - D00218436
+ */
+
+namespace
+{
+	void AppendQuad(sf::VertexArray& vertices, const sf::FloatRect& bounds, const sf::Texture& texture)
+	{
+		const sf::Vector2f size(texture.getSize());
+		const float right = bounds.left + bounds.width;
+		const float bottom = bounds.top + bounds.height;
+
+		vertices.append(sf::Vertex(sf::Vector2f(bounds.left, bounds.top), sf::Vector2f(0.f, 0.f)));
+		vertices.append(sf::Vertex(sf::Vector2f(right, bounds.top), sf::Vector2f(size.x, 0.f)));
+		vertices.append(sf::Vertex(sf::Vector2f(right, bottom), sf::Vector2f(size.x, size.y)));
+		vertices.append(sf::Vertex(sf::Vector2f(bounds.left, bottom), sf::Vector2f(0.f, size.y)));
+	}
+}
+
+TileMap::TileMap(const SceneLayers& scene_layers, const TextureHolder& textures, const TileGrid& grid)
+	: SceneNode(scene_layers)
+	, m_tile_ids()
+	, m_hit_points()
+	, m_flags()
+	, m_top_cells()
+	, m_textures()
+	, m_crack_texture(textures.Get(Textures::kCrack))
+	, m_crack_vertices(sf::Quads)
+	, m_vertices_dirty(true)
+{
+	for (int i = 0; i < TILE_TEXTURES; ++i)
+	{
+		m_textures[i] = &textures.Get(static_cast<Textures>(static_cast<int>(Textures::kDirt1) + i));
+		m_vertices[i].setPrimitiveType(sf::Quads);
+	}
+
+	for (int cell = 0; cell < TileGrid::CELL_COUNT; ++cell)
+	{
+		m_tile_ids[cell] = grid.GetTileId(cell);
+		m_hit_points[cell] = grid.GetHitPoints(cell);
+	}
+
+	//Same rules as the level was always built with: the first tile down each column is the top,
+	//and a tile collides once it has air on either side of it
+	for (int row = 0; row < TileGrid::ROWS; ++row)
+	{
+		for (int column = 0; column < TileGrid::COLUMNS; ++column)
+		{
+			const int cell = TileGrid::GetCell(column, row);
+			if (m_hit_points[cell] == 0)
+			{
+				continue;
+			}
+
+			if (grid.GetTopCell(column) == cell)
+			{
+				SetIsTop(cell);
+			}
+
+			const bool air_left = column == 0 || m_hit_points[cell - 1] == 0;
+			const bool air_right = column == TileGrid::COLUMNS - 1 || m_hit_points[cell + 1] == 0;
+			if (air_left || air_right)
+			{
+				SetActiveCollision(cell);
+			}
+		}
+	}
+
+	DangerTrigger::Instance().AddDangerObject(this);
+	BuildVertices();
+	Sleep();
+}
+
+TileMap::~TileMap()
+{
+	DangerTrigger::Instance().RemoveDangerObject(this);
+}
+
+unsigned TileMap::GetCategory() const
+{
+	return Category::kPlatform;
+}
+
+//Damage and the collision grid are only changed by commands, an update only rebuilds the vertices
+bool TileMap::CanUpdateConcurrently() const
+{
+	return true;
+}
+
+sf::Uint8 TileMap::GetHitPoints(int cell) const
+{
+	return m_hit_points[cell];
+}
+
+bool TileMap::IsTop(int cell) const
+{
+	return (m_flags[cell] & kTop) != 0;
+}
+
+bool TileMap::HasActiveCollision(int cell) const
+{
+	return (m_flags[cell] & kActiveCollision) != 0;
+}
+
+sf::FloatRect TileMap::GetCellBounds(int cell)
+{
+	return {
+		TileGrid::GetColumn(cell) * WorldInfo::TILE_SIZE,
+		TileGrid::GetRow(cell) * WorldInfo::TILE_SIZE,
+		WorldInfo::TILE_SIZE,
+		WorldInfo::TILE_SIZE
+	};
+}
+
+/// <returns>False if there is no standing tile in the cell</returns>
+bool TileMap::Damage(int cell)
+{
+	if (cell < 0 || cell >= TileGrid::CELL_COUNT || m_hit_points[cell] == 0)
+	{
+		return false;
+	}
+
+	m_hit_points[cell]--;
+	m_vertices_dirty = true;
+	Wake();
+
+	if (m_hit_points[cell] == 0)
+	{
+		OnDestroyed(cell);
+	}
+
+	return true;
+}
+
+std::size_t TileMap::GetDangerCount() const
+{
+	return m_top_cells.size();
+}
+
+void TileMap::Trigger(std::size_t index)
+{
+	Damage(m_top_cells[index]);
+}
+
+void TileMap::SetIsTop(int cell)
+{
+	if (IsTop(cell)) return;
+
+	m_flags[cell] |= kTop;
+	m_top_cells.emplace_back(cell);
+	SetActiveCollision(cell);
+}
+
+void TileMap::SetActiveCollision(int cell)
+{
+	if (HasActiveCollision(cell)) return;
+
+	m_flags[cell] |= kActiveCollision;
+	SpatialGrid::Instance().Insert(cell, GetCellBounds(cell), Layers::kActivePlatforms);
+}
+
+/// <summary>
+/// The next standing tile down the column becomes the top, and the tiles either side are now exposed
+/// </summary>
+void TileMap::OnDestroyed(int cell)
+{
+	if (HasActiveCollision(cell))
+	{
+		SpatialGrid::Instance().Remove(cell, Layers::kActivePlatforms);
+	}
+
+	if (IsTop(cell))
+	{
+		m_top_cells.erase(std::find(m_top_cells.begin(), m_top_cells.end(), cell));
+	}
+
+	m_flags[cell] = 0;
+
+	const int column = TileGrid::GetColumn(cell);
+	for (int row = TileGrid::GetRow(cell) + 1; row < TileGrid::ROWS; ++row)
+	{
+		const int below = TileGrid::GetCell(column, row);
+		if (m_hit_points[below] > 0)
+		{
+			SetIsTop(below);
+			break;
+		}
+	}
+
+	if (column > 0 && m_hit_points[cell - 1] > 0)
+	{
+		SetActiveCollision(cell - 1);
+	}
+	if (column < TileGrid::COLUMNS - 1 && m_hit_points[cell + 1] > 0)
+	{
+		SetActiveCollision(cell + 1);
+	}
+}
+
+void TileMap::BuildVertices()
+{
+	for (sf::VertexArray& vertices : m_vertices)
+	{
+		vertices.clear();
+	}
+	m_crack_vertices.clear();
+
+	for (int cell = 0; cell < TileGrid::CELL_COUNT; ++cell)
+	{
+		if (m_hit_points[cell] == 0)
+		{
+			continue;
+		}
+
+		const sf::FloatRect bounds = GetCellBounds(cell);
+		const int texture = m_tile_ids[cell] - 1;
+		AppendQuad(m_vertices[texture], bounds, *m_textures[texture]);
+
+		if (m_hit_points[cell] == 1)
+		{
+			AppendQuad(m_crack_vertices, bounds, m_crack_texture);
+		}
+	}
+
+	m_vertices_dirty = false;
+}
+
+/// <summary>
+/// Only runs after a tile has been damaged, the map sleeps the rest of the time
+/// </summary>
+void TileMap::UpdateCurrent(sf::Time, CommandQueue&)
+{
+	if (m_vertices_dirty)
+	{
+		BuildVertices();
+	}
+	Sleep();
+}
+
+void TileMap::DrawCurrent(sf::RenderTarget& target, sf::RenderStates states) const
+{
+	for (int i = 0; i < TILE_TEXTURES; ++i)
+	{
+		states.texture = m_textures[i];
+		target.draw(m_vertices[i], states);
+	}
+
+	states.texture = &m_crack_texture;
+	target.draw(m_crack_vertices, states);
+
+	if (WorldInfo::Instance().ShowCollisionBounds())
+	{
+		states.texture = nullptr;
+		sf::RectangleShape shape;
+		shape.setFillColor(sf::Color::Transparent);
+		shape.setOutlineColor(sf::Color::Green);
+		shape.setOutlineThickness(1.f);
+
+		for (int cell = 0; cell < TileGrid::CELL_COUNT; ++cell)
+		{
+			if (HasActiveCollision(cell))
+			{
+				const sf::FloatRect bounds = GetCellBounds(cell);
+				shape.setPosition(bounds.left, bounds.top);
+				shape.setSize(sf::Vector2f(bounds.width, bounds.height));
+				target.draw(shape, states);
+			}
+		}
+	}
+}
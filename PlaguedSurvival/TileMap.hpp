@@ -0,0 +1,69 @@
+#pragma once
+#include <array>
+#include <vector>
+#include <SFML/Graphics/VertexArray.hpp>
+
+#include "Dangerous.hpp"
+#include "ResourceIdentifiers.hpp"
+#include "SceneNode.hpp"
+#include "TileGrid.hpp"
+
+/**
+ * Vilandas Morrissey - D00218436
+ */
+
+/// <summary>
+/// Every tile in the world as one scene node. Tiles are cells in a dense grid with their id, hit points
+/// and flags held in separate arrays, and are drawn as one vertex array per texture, so the cost of the
+/// map follows its area rather than a node per tile.
+/// A tile is a danger while it is the top of its column and only collides once it is exposed.
+/// </summary>
+class TileMap : public SceneNode, public Dangerous
+{
+public:
+	enum Flags : sf::Uint8
+	{
+		kTop = 1 << 0,
+		kActiveCollision = 1 << 1
+	};
+
+public:
+	TileMap(const SceneLayers& scene_layers, const TextureHolder& textures, const TileGrid& grid);
+	~TileMap();
+
+	unsigned GetCategory() const override;
+	bool CanUpdateConcurrently() const override;
+
+	sf::Uint8 GetHitPoints(int cell) const;
+	bool IsTop(int cell) const;
+	bool HasActiveCollision(int cell) const;
+	static sf::FloatRect GetCellBounds(int cell);
+
+	bool Damage(int cell);
+
+	std::size_t GetDangerCount() const override;
+	void Trigger(std::size_t index) override;
+
+private:
+	void SetIsTop(int cell);
+	void SetActiveCollision(int cell);
+	void OnDestroyed(int cell);
+	void BuildVertices();
+
+	void UpdateCurrent(sf::Time dt, CommandQueue& commands) override;
+	void DrawCurrent(sf::RenderTarget& target, sf::RenderStates states) const override;
+
+private:
+	static constexpr int TILE_TEXTURES = static_cast<int>(Textures::kDirt9) - static_cast<int>(Textures::kDirt1) + 1;
+
+	std::array<sf::Uint8, TileGrid::CELL_COUNT> m_tile_ids;
+	std::array<sf::Uint8, TileGrid::CELL_COUNT> m_hit_points;
+	std::array<sf::Uint8, TileGrid::CELL_COUNT> m_flags;
+	std::vector<int> m_top_cells;
+
+	std::array<const sf::Texture*, TILE_TEXTURES> m_textures;
+	const sf::Texture& m_crack_texture;
+	std::array<sf::VertexArray, TILE_TEXTURES> m_vertices;
+	sf::VertexArray m_crack_vertices;
+	bool m_vertices_dirty;
+};
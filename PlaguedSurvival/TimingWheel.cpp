@@ -0,0 +1,233 @@
+#include "TimingWheel.hpp"
+
+#include <algorithm>
+
+/**
+ * Vilandas Morrissey - D00218436
+ */
+
+/// <summary>
+/// </summary>
+/// <param name="resolution">Length of one tick, timers are rounded up to it</param>
+TimingWheel::TimingWheel(sf::Time resolution)
+	: m_resolution(std::max(resolution.asMicroseconds(), sf::Int64(1)))
+	, m_current_tick(0)
+	, m_count(0)
+{
+	m_lists.fill(NONE);
+}
+
+/// <summary>
+/// Run a callback once, at the first Advance at or after the given time. Times already past fire on the next tick.
+/// The callback may schedule and cancel timers, including rescheduling itself.
+/// </summary>
+/// <returns>Identifier for Cancel, never zero</returns>
+TimingWheel::TimerId TimingWheel::Schedule(sf::Time when, Callback callback)
+{
+	const sf::Int64 microseconds = std::max(when.asMicroseconds(), sf::Int64(0));
+	const sf::Uint64 tick = static_cast<sf::Uint64>((microseconds + m_resolution - 1) / m_resolution);
+
+	//Further out than the top wheel reaches is clamped to its last slot
+	const sf::Uint64 range = (sf::Uint64(1) << (SLOT_BITS * LEVELS)) - 1;
+	const sf::Uint64 expires = std::min(std::max(tick, m_current_tick + 1), m_current_tick + range);
+
+	sf::Uint32 index;
+	if (!m_free.empty())
+	{
+		index = m_free.back();
+		m_free.pop_back();
+	}
+	else
+	{
+		index = static_cast<sf::Uint32>(m_timers.size());
+		m_timers.emplace_back();
+		m_timers.back().m_generation = 1;
+	}
+
+	Timer& timer = m_timers[index];
+	timer.m_callback = std::move(callback);
+	timer.m_expires = expires;
+	Insert(index);
+	m_count++;
+
+	return (static_cast<TimerId>(timer.m_generation) << 32) | index;
+}
+
+/// <returns>False if the timer already fired or was cancelled</returns>
+bool TimingWheel::Cancel(TimerId id)
+{
+	const sf::Uint32 index = FindIndex(id);
+	if (index == NONE)
+	{
+		return false;
+	}
+
+	Unlink(index);
+	Release(index);
+	return true;
+}
+
+bool TimingWheel::IsScheduled(TimerId id) const
+{
+	return FindIndex(id) != NONE;
+}
+
+/// <summary>
+/// Fire every timer due by the given time, in order of their ticks
+/// </summary>
+void TimingWheel::Advance(sf::Time now)
+{
+	const sf::Int64 microseconds = std::max(now.asMicroseconds(), sf::Int64(0));
+	const sf::Uint64 target = static_cast<sf::Uint64>(microseconds / m_resolution);
+
+	while (m_current_tick < target)
+	{
+		//Nothing to fire, skip straight there
+		if (m_count == 0)
+		{
+			m_current_tick = target;
+			return;
+		}
+
+		m_current_tick++;
+
+		//When a wheel completes a turn, the next slot of the wheel above is spread down into it
+		for (std::size_t level = 1; level < LEVELS; ++level)
+		{
+			if ((m_current_tick & ((sf::Uint64(1) << (SLOT_BITS * level)) - 1)) != 0)
+			{
+				break;
+			}
+			Cascade(level);
+		}
+
+		FireSlot();
+	}
+}
+
+std::size_t TimingWheel::GetTimerCount() const
+{
+	return m_count;
+}
+
+void TimingWheel::Insert(sf::Uint32 index)
+{
+	const sf::Uint64 delta = m_timers[index].m_expires - m_current_tick;
+
+	std::size_t level = 0;
+	while (level + 1 < LEVELS && delta >= (sf::Uint64(1) << (SLOT_BITS * (level + 1))))
+	{
+		level++;
+	}
+
+	const std::size_t slot = static_cast<std::size_t>(m_timers[index].m_expires >> (SLOT_BITS * level)) & (SLOTS - 1);
+	Link(index, static_cast<sf::Uint32>(level * SLOTS + slot));
+}
+
+void TimingWheel::Link(sf::Uint32 index, sf::Uint32 list)
+{
+	Timer& timer = m_timers[index];
+	timer.m_list = list;
+	timer.m_previous = NONE;
+	timer.m_next = m_lists[list];
+
+	if (timer.m_next != NONE)
+	{
+		m_timers[timer.m_next].m_previous = index;
+	}
+	m_lists[list] = index;
+}
+
+void TimingWheel::Unlink(sf::Uint32 index)
+{
+	Timer& timer = m_timers[index];
+
+	if (timer.m_previous != NONE)
+	{
+		m_timers[timer.m_previous].m_next = timer.m_next;
+	}
+	else
+	{
+		m_lists[timer.m_list] = timer.m_next;
+	}
+
+	if (timer.m_next != NONE)
+	{
+		m_timers[timer.m_next].m_previous = timer.m_previous;
+	}
+
+	timer.m_list = NONE;
+}
+
+//Bumping the generation makes any copies of the old identifier stale
+void TimingWheel::Release(sf::Uint32 index)
+{
+	Timer& timer = m_timers[index];
+	timer.m_callback = nullptr;
+	timer.m_generation++;
+	m_free.emplace_back(index);
+	m_count--;
+}
+
+/// <summary>
+/// Only called when every wheel below has just wrapped, so the slot's timers are all due within one turn of the
+/// wheel below and land there, or in the bottom wheel's current slot if due this tick.
+/// </summary>
+void TimingWheel::Cascade(std::size_t level)
+{
+	const std::size_t slot = static_cast<std::size_t>(m_current_tick >> (SLOT_BITS * level)) & (SLOTS - 1);
+	const std::size_t list = level * SLOTS + slot;
+
+	sf::Uint32 index = m_lists[list];
+	m_lists[list] = NONE;
+
+	while (index != NONE)
+	{
+		const sf::Uint32 next = m_timers[index].m_next;
+		Insert(index);
+		index = next;
+	}
+}
+
+void TimingWheel::FireSlot()
+{
+	const std::size_t slot = static_cast<std::size_t>(m_current_tick) & (SLOTS - 1);
+
+	sf::Uint32 index = m_lists[slot];
+	m_lists[slot] = NONE;
+
+	while (index != NONE)
+	{
+		const sf::Uint32 next = m_timers[index].m_next;
+		Link(index, FIRING_LIST);
+		index = next;
+	}
+
+	//The callback is moved out first, a callback that schedules can grow m_timers
+	while (m_lists[FIRING_LIST] != NONE)
+	{
+		index = m_lists[FIRING_LIST];
+		Unlink(index);
+
+		Callback callback = std::move(m_timers[index].m_callback);
+		Release(index);
+		callback();
+	}
+}
+
+sf::Uint32 TimingWheel::FindIndex(TimerId id) const
+{
+	const sf::Uint32 index = static_cast<sf::Uint32>(id & 0xFFFFFFFF);
+	if (index >= m_timers.size())
+	{
+		return NONE;
+	}
+
+	const Timer& timer = m_timers[index];
+	if (timer.m_generation != static_cast<sf::Uint32>(id >> 32) || timer.m_list == NONE)
+	{
+		return NONE;
+	}
+
+	return index;
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <array>
+#include <functional>
+#include <vector>
+#include <SFML/Config.hpp>
+#include <SFML/System/Time.hpp>
+
+/**
+ * Vilandas Morrissey - D00218436
+ */
+
+/// <summary>
+/// Hierarchical timing wheel: four wheels of 64 slots, each slot of a wheel covering a whole turn of the one below.
+/// Scheduling and cancelling are constant time, and advancing only looks at the slot for each tick that passes,
+/// so a thousand idle timers cost nothing until they are due. Timers fire at or after their time,
+/// never before, rounded up to the resolution. Not thread safe, each thread keeps its own wheel.
+/// </summary>
+class TimingWheel
+{
+public:
+	//Zero is never handed out, so it can stand for no timer
+	typedef sf::Uint64 TimerId;
+	typedef std::function<void()> Callback;
+
+public:
+	explicit TimingWheel(sf::Time resolution);
+
+	TimerId Schedule(sf::Time when, Callback callback);
+	bool Cancel(TimerId id);
+	bool IsScheduled(TimerId id) const;
+	void Advance(sf::Time now);
+
+	std::size_t GetTimerCount() const;
+
+private:
+	static constexpr std::size_t SLOT_BITS = 6;
+	static constexpr std::size_t SLOTS = 1 << SLOT_BITS;
+	static constexpr std::size_t LEVELS = 4;
+	//Timers that are due are moved to their own list before firing, so callbacks can cancel them
+	static constexpr std::size_t FIRING_LIST = SLOTS * LEVELS;
+	static constexpr sf::Uint32 NONE = 0xFFFFFFFF;
+
+	struct Timer
+	{
+		Callback m_callback;
+		sf::Uint64 m_expires;
+		sf::Uint32 m_generation;
+		sf::Uint32 m_list;
+		sf::Uint32 m_previous;
+		sf::Uint32 m_next;
+	};
+
+private:
+	void Insert(sf::Uint32 index);
+	void Link(sf::Uint32 index, sf::Uint32 list);
+	void Unlink(sf::Uint32 index);
+	void Release(sf::Uint32 index);
+	void Cascade(std::size_t level);
+	void FireSlot();
+	sf::Uint32 FindIndex(TimerId id) const;
+
+private:
+	sf::Int64 m_resolution;
+	sf::Uint64 m_current_tick;
+	std::vector<Timer> m_timers;
+	std::vector<sf::Uint32> m_free;
+	std::array<sf::Uint32, FIRING_LIST + 1> m_lists;
+	std::size_t m_count;
+};
@@ -0,0 +1,49 @@
+#include "TokenBucket.hpp"
+
+#include <algorithm>
+
+/**
+ * Vilandas Morrissey - D00218436
+ */
+
+TokenBucket::TokenBucket()
+	: TokenBucket(0.f, 0.f)
+{
+}
+
+/// <summary>
+/// </summary>
+/// <param name="tokens_per_second">Sustained rate of tokens added</param>
+/// <param name="capacity">Largest burst allowed, the bucket starts full</param>
+TokenBucket::TokenBucket(float tokens_per_second, float capacity)
+	: m_tokens_per_second(tokens_per_second)
+	, m_capacity(capacity)
+	, m_tokens(capacity)
+	, m_last_refill(sf::Time::Zero)
+{
+}
+
+/// <summary>
+/// Take a single token if one is available
+/// </summary>
+/// <param name="now">Current time, used to refill the bucket</param>
+/// <returns>True if the token was taken</returns>
+bool TokenBucket::TryConsume(sf::Time now)
+{
+	Refill(now);
+
+	if (m_tokens < 1.f)
+	{
+		return false;
+	}
+
+	m_tokens -= 1.f;
+	return true;
+}
+
+void TokenBucket::Refill(sf::Time now)
+{
+	const float elapsed = (now - m_last_refill).asSeconds();
+	m_tokens = std::min(m_capacity, m_tokens + elapsed * m_tokens_per_second);
+	m_last_refill = now;
+}
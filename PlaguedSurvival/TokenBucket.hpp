@@ -0,0 +1,27 @@
+#pragma once
+#include <SFML/System/Time.hpp>
+
+/**
+ * Vilandas Morrissey - D00218436
+ */
+
+/// <summary>
+/// Rate limiter that allows short bursts up to a capacity while refilling at a fixed rate.
+/// </summary>
+class TokenBucket
+{
+public:
+	TokenBucket();
+	TokenBucket(float tokens_per_second, float capacity);
+
+	bool TryConsume(sf::Time now);
+
+private:
+	void Refill(sf::Time now);
+
+private:
+	float m_tokens_per_second;
+	float m_capacity;
+	float m_tokens;
+	sf::Time m_last_refill;
+};
@@ -4,18 +4,27 @@
 #include <iostream>
 #include <SFML/Graphics/RectangleShape.hpp>
 
+#include "CommandDispatcher.hpp"
+#include "DangerTrigger.hpp"
 #include "ParticleNode.hpp"
 #include "ParticleType.hpp"
 #include "PlayerColors.hpp"
 #include "PostEffect.hpp"
 #include "SoundNode.hpp"
-#include "TileNode.hpp"
+#include "SpatialGrid.hpp"
+#include "TileMap.hpp"
 #include "Utility.hpp"
 
 /**
  * Vilandas Morrissey - D00218436
  */
 
+namespace
+{
+	//Players spawn 200 units apart, this many fit across the world
+	const int SpawnColumns = 15;
+}
+
 World::World(sf::RenderWindow& render_window, TextureHolder& textures, FontHolder& fonts, SoundPlayer& sounds, Camera& camera, bool networked)
 	: m_window(render_window)
 	, m_textures(textures)
@@ -24,6 +33,8 @@ World::World(sf::RenderWindow& render_window, TextureHolder& textures, FontHolde
 	, m_camera(camera)
 	, m_scene_layers()
 	, m_scenegraph(m_scene_layers)
+	, m_scene_update(JobSystem::GetDefaultWorkerCount(1))
+	, m_tile_map(nullptr)
 	, m_world_bounds(0.f, 0.f, WorldInfo::WORLD_WIDTH, WorldInfo::WORLD_HEIGHT)
 	, m_alive_players(0)
 	, m_networked_world(networked)
@@ -38,7 +49,9 @@ World::World(sf::RenderWindow& render_window, TextureHolder& textures, FontHolde
 	m_camera.SetBoundsConstraint(m_world_bounds);
 
 	DangerTrigger::Instance().Clear();
-	WorldChunks::Instance().Clear();
+	SpatialGrid::Instance().Clear();
+	CommandDispatcher::Instance().Clear();
+	m_scenegraph.SubscribeToCommands();
 	BuildScene();
 }
 
@@ -46,24 +59,17 @@ void World::Update(sf::Time dt)
 {
 	m_elapsed_time += dt.asSeconds();
 
-	//Forward commands to the scenegraph until the command queue is empty
+	//Deliver commands to the nodes they are for until the command queue is empty
 	while (!m_command_queue.IsEmpty())
 	{
-		m_scenegraph.OnCommand(m_command_queue.Pop(), dt);
+		CommandDispatcher::Instance().Dispatch(m_command_queue.Pop(), dt);
 	}
 
-	//Remove all destroyed entities
-	//RemoveWrecks() only destroys the entities, not the pointers in m_player
-	const auto first_to_remove = std::remove_if(
-		m_player_characters.begin(),
-		m_player_characters.end(),
-		std::mem_fn(&PlayerObject::IsMarkedForRemoval));
+	//Remove the nodes destroyed since the last update, RemovePlayer has already forgotten any players among them
+	m_scenegraph.RemoveMarked();
 
-	m_player_characters.erase(first_to_remove, m_player_characters.end());
-	m_scenegraph.RemoveWrecks();
-
-	//Apply movement
-	m_scenegraph.Update(dt, m_command_queue);
+	//Apply movement, spread across the workers once the scene is large enough
+	m_scene_update.Update(m_scenegraph, dt, m_command_queue);
 
 	if (!m_networked_world)
 	{
@@ -137,14 +143,8 @@ PlayerObject* World::GetAlivePlayer() const
 
 PlayerObject* World::GetPlayer(opt::PlayerIdentifier identifier) const
 {
-	for (PlayerObject* a : m_player_characters)
-	{
-		if (a->GetIdentifier() == identifier)
-		{
-			return a;
-		}
-	}
-	return nullptr;
+	const auto found = m_player_lookup.find(identifier);
+	return found != m_player_lookup.end() ? found->second : nullptr;
 }
 
 PlayerObject* World::AddPlayer(opt::PlayerIdentifier identifier, const std::string& name, bool is_camera_target)
@@ -163,12 +163,14 @@ PlayerObject* World::AddPlayer(opt::PlayerIdentifier identifier, const std::stri
 		));
 
 	player->setScale(0.5f, 0.5f);
-	player->setPosition(200 + (200 * identifier), 64);
+	//Spawn points wrap around so large lobbies stay inside the world
+	player->setPosition(200 + (200 * (1 + (identifier - 1) % SpawnColumns)), 64);
 	player->SetIdentifier(identifier);
 	player->SetName(name);
-	player->SetColor(ExtraColors::GetColor(static_cast<PlayerColors>(identifier - 1)));
+	player->SetColor(ExtraColors::GetPlayerColor(identifier));
 
 	m_player_characters.emplace_back(player.get());
+	m_player_lookup[identifier] = player.get();
 
 	Layers layer = is_camera_target
 		? Layers::kLocalPlayer
@@ -222,6 +224,28 @@ void World::RemovePlayer(opt::PlayerIdentifier identifier)
 
 		player->Destroy();
 		m_player_characters.erase(std::find(m_player_characters.begin(), m_player_characters.end(), player));
+		m_player_lookup.erase(identifier);
+	}
+}
+
+//Damage from the server always hits the top tile of a column, so the TileMap stays in step with the server's grid
+void World::DamageTile(int cell)
+{
+	m_tile_map->Damage(cell);
+}
+
+/// <summary>
+/// Brings the tiles in line with a snapshot from the server in one pass.
+/// Rows are applied top down so tiles are only ever destroyed while they are the top of their column.
+/// </summary>
+void World::ApplyTileSnapshot(const TileGrid& snapshot)
+{
+	for (int cell = 0; cell < TileGrid::CELL_COUNT; ++cell)
+	{
+		while (m_tile_map->GetHitPoints(cell) > snapshot.GetHitPoints(cell))
+		{
+			DamageTile(cell);
+		}
 	}
 }
 
@@ -240,93 +264,9 @@ void World::BuildScene()
 		m_scenegraph.AttachChild(std::move(layer));
 	}
 
-	const int map[][50] =
-	{
-		{0,0,0,0,0,0,2,0,0,0,0,0,0,0,1,3,0,0,1,2,3,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,5,0,0,0,0,0,0,0,0,0,0,0,4,5,6,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,5,0,0,0,0,0,0,0,0,0,0,1,5,5,5,2,3,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,5,0,0,0,0,0,0,0,0},
-		{0,0,2,2,2,2,2,2,2,2,2,2,2,3,0,0,1,5,5,5,5,5,6,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,5,0,0,0,0,0,0,0,0},
-		{1,2,5,5,5,5,5,5,5,5,5,5,5,6,0,0,4,5,5,5,5,5,5,3,0,0,0,0,0,0,0,0,0,0,0,0,1,2,2,2,2,5,2,2,2,2,2,2,2,3},
-		{4,5,5,5,5,5,5,5,5,5,5,5,5,6,0,0,7,8,8,8,8,8,5,5,3,0,0,0,0,0,0,0,0,0,0,1,5,5,5,5,5,5,5,5,5,5,5,5,5,6},
-		{7,8,8,8,8,8,8,8,8,8,8,8,8,9,0,0,0,0,0,0,0,0,4,5,6,0,0,0,0,0,0,0,0,1,2,5,8,8,8,8,8,8,8,8,8,8,8,8,8,6},
-		{0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,7,8,5,3,0,0,0,0,0,0,0,4,5,9,0,0,0,0,0,0,0,0,0,0,0,0,0,6},
-		{0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,8,8,2,2,2,2,2,2,2,8,8,0,0,0,0,0,0,0,0,0,0,0,0,8,8,9},
-		{0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,2,0,0,0,0,2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,5,3,0,0,0,5,3,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0},
-		{0,0,2,0,0,4,0,0,0,0,4,6,0,0,0,0,0,0,0,0,0,5,5,0,0,0,0,0,0,0,2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0},
-		{0,0,8,0,0,4,0,0,0,0,4,6,0,0,0,0,0,0,0,0,0,0,8,0,0,0,0,0,0,5,6,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,4,0,0,0,0,4,6,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,8,8,9,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0},
-	};
-
-	std::unordered_map<int, TileNode*> top_tiles(50);
-	const sf::Texture& crack_texture = m_textures.Get(Textures::kCrack);
-
-	for (int i = 0; i < 15; i++)
-	{
-		TileNode* last_node = nullptr;
-		for (int j = 0; j < 50; j++)
-		{
-			const int id = map[i][j];
-			const bool skip = id == 0;
-
-			const Textures texture_id = skip
-				? Textures::kDefault
-				: static_cast<Textures>(static_cast<int>(Textures::kDirt1) + id - 1);
-
-			if (!skip)
-			{
-				sf::Texture& texture = m_textures.Get(texture_id);
-				std::unique_ptr<TileNode> tile(
-					new TileNode(
-						m_scene_layers,
-						texture,
-						crack_texture));
-
-				tile->setScale(0.5, 0.5);
-				tile->setPosition(
-					WorldInfo::TILE_SIZE + j * WorldInfo::TILE_SIZE,
-					(m_world_bounds.height - WorldInfo::TILE_SIZE * 17) + i * WorldInfo::TILE_SIZE
-				);
-
-				TileNode* current_node = tile.get();
-
-				const auto result = top_tiles.emplace(j, tile.get());
-				if (result.second)
-				{
-					tile->SetIsTop(true);
-					m_scene_layers[static_cast<int>(Layers::kActivePlatforms)]->AttachChild(std::move(tile));
-				}
-				else
-				{
-					top_tiles[j]->AddBelowTile(tile.get());
-					m_scene_layers[static_cast<int>(Layers::kPlatforms)]->AttachChild(std::move(tile));
-				}
-
-				if (last_node != nullptr)
-				{
-					current_node->SetLeftTile(last_node);
-					last_node->SetRightTile(current_node);
-				}
-				else //last_node was air so this node is exposed
-				{
-					current_node->SetActiveCollision();
-				}
-
-				last_node = current_node;
-			}
-			else
-			{
-				if (last_node != nullptr)
-				{
-					last_node->SetActiveCollision();
-				}
-
-				last_node = nullptr;
-			}
-
-		}
-	}
+	std::unique_ptr<TileMap> tile_map(new TileMap(m_scene_layers, m_textures, TileGrid()));
+	m_tile_map = tile_map.get();
+	m_scene_layers[static_cast<int>(Layers::kPlatforms)]->AttachChild(std::move(tile_map));
 
 	if (m_networked_world)
 	{
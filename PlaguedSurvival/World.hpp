@@ -10,6 +10,7 @@
 #include <SFML/Graphics/RenderTexture.hpp>
 
 #include <array>
+#include <unordered_map>
 
 #include "BloomEffect.hpp"
 #include "CommandQueue.hpp"
@@ -17,7 +18,9 @@
 #include "SoundPlayer.hpp"
 
 #include "NetworkProtocol.hpp"
+#include "ParallelSceneUpdate.hpp"
 #include "PlatformerCharacter.hpp"
+#include "TileGrid.hpp"
 #include "WorldInfo.hpp"
 
 /**
@@ -29,6 +32,8 @@ namespace sf
 	class RenderTarget;
 }
 
+class TileMap;
+
 typedef PlatformerCharacter PlayerObject;
 
 class World : private sf::NonCopyable
@@ -55,6 +60,8 @@ public:
 	PlayerObject* GetPlayer(opt::PlayerIdentifier identifier) const;
 	PlayerObject* AddPlayer(opt::PlayerIdentifier identifier, const std::string& name, bool is_camera_target);
 	void RemovePlayer(opt::PlayerIdentifier identifier);
+	void DamageTile(int cell);
+	void ApplyTileSnapshot(const TileGrid& snapshot);
 	bool PollGameAction(GameActions::Action& out);
 
 private:
@@ -71,9 +78,12 @@ private:
 	SceneNode::SceneLayers m_scene_layers;
 	SceneNode m_scenegraph;
 	CommandQueue m_command_queue;
+	ParallelSceneUpdate m_scene_update;
+	TileMap* m_tile_map;
 
 	sf::FloatRect m_world_bounds;
 	std::vector<PlayerObject*> m_player_characters;
+	std::unordered_map<opt::PlayerIdentifier, PlayerObject*> m_player_lookup;
 	opt::PlayerCount m_alive_players;
 
 	BloomEffect m_bloom_effect;
@@ -21,9 +21,6 @@ public:
 	static constexpr float WORLD_WIDTH = X_TILE_COUNT * TILE_SIZE;
 	static constexpr float WORLD_HEIGHT = Y_TILE_COUNt * TILE_SIZE;
 
-	static constexpr int WORLD_CHUNKS = X_TILE_COUNT;
-	static constexpr float WIDTH_PER_CHUNK = TILE_SIZE;		//= WORLD_WIDTH / WORLD_CHUNKS
-
 	bool ShowCollisionBounds() const;
 	void SetShowCollisionBounds(bool flag);
 